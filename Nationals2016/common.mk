@@ -37,6 +37,21 @@ CFLAGS:=$(CCFLAGS) -std=gnu99 -Werror=implicit-function-declaration
 CPPFLAGS:=$(CCFLAGS) -fno-exceptions -fno-rtti -felide-constructors
 LDFLAGS:=-Wall $(MCUCFLAGS) $(MCULFLAGS) -Wl,--gc-sections
 
+# Build the driver control microbenchmarks into initialize() with make BENCHMARK=1
+ifdef BENCHMARK
+CFLAGS+=-DBENCHMARK
+endif
+
+# Build the joystick to motor latency monitor into initialize() with make LATENCY=1
+ifdef LATENCY
+CFLAGS+=-DLATENCY
+endif
+
+# Compile the event trace points out with make NOTRACE=1
+ifdef NOTRACE
+CFLAGS+=-DNOTRACE
+endif
+
 # Tools used in program
 AR:=$(MCUPREFIX)ar
 AS:=$(MCUPREFIX)as
@@ -0,0 +1,656 @@
+/*
+ * @file autotune.c
+ *
+ * @brief Tunes the robot's controller parameters against the host simulation
+ *        and writes them to a gains file the robot loads at start up (see
+ *        include/gains.h). Each candidate set of parameters is scored by
+ *        running the robot program on the plant, so what is tuned is the code
+ *        that runs on the Cortex.
+ *
+ *        usage: autotune [-c group] [-j jobs] [-g points] [-i iterations]
+ *                        [-b balls] [-t ms] [-o file]
+ *
+ *          -c group      flywheel, turn or all (all)
+ *          -j jobs       simulations at once (the number of cores)
+ *          -g points     grid points per parameter of the first sweep (5)
+ *          -i iterations most Nelder-Mead iterations after the sweep (40)
+ *          -b balls      balls fired by each rapid fire test (5)
+ *          -t ms         time limit of each rapid fire test (15000)
+ *          -o file       gains file to write (gains.txt)
+ *
+ *        Parameter groups are tuned one at a time, each in two stages: a
+ *        grid sweep over the parameter ranges, then Nelder-Mead from the
+ *        best grid point. Every simulation of a stage runs at once across
+ *        the cores with sim/pool, Nelder-Mead evaluating its reflection,
+ *        expansion and both contractions of an iteration together.
+ *
+ *          flywheel  fire.slope and fire.offset, the rapid fire threshold.
+ *                    Rapid fire is held at both presets with balls in the
+ *                    intake. The score is the time to fire every ball, so it
+ *                    covers spin up and shot recovery, plus the RMS error of
+ *                    the shot speeds against a shot at the steady flywheel
+ *                    speed of the preset.
+ *          turn      turn.kP, turn.kD and turn.minOutput, with a gyro on
+ *                    analog 4. The robot turns through 90, -135 and 30
+ *                    degrees. The score is the settle time plus overshoot.
+ *
+ *        The lift gains can be set in the gains file but are not tuned, as
+ *        the robot and its plant have no lift.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <main.h>
+#include <gains.h>
+#include "sim/pool.h"
+#include "sim/session.h"
+
+int vsnprintf(char* buffer, size_t limit, const char* formatString, va_list args);	//from the C library, <stdio.h> clashes with API.h
+
+#define MAX_PARAMS   3		//most parameters in a group
+#define MAX_POINTS   1024	//most candidates evaluated at once
+#define MAX_SHOTS    32		//most balls in a rapid fire test
+
+//flywheel test
+#define PRESETS       2		//low and high preset
+#define REFERENCE_MS  20000	//time the flywheel spins up for before the reference shot
+#define SPEED_WEIGHT  0.2	//score in seconds per percent of RMS shot speed error
+#define MISS_PENALTY  5.0	//score in seconds per ball not fired
+
+//turn test
+#define GYRO_PORT        4		//analog port of the simulated gyro
+#define TURN_LIMIT       3000	//time in ms each turn gets to settle
+#define OVERSHOOT_WEIGHT 0.05	//score in seconds per degree of overshoot
+
+//tunable parameter data structure
+struct{
+	const char* name;	//name in the gains file
+	double low;			//lower end of the search range
+	double high;		//upper end of the search range
+	bool integer;		//flag for an int parameter, otherwise a double
+	int offset;			//byte offset of the parameter in Gains
+} typedef Param;
+
+//outcome of one test data structure
+struct{
+	bool valid;			//flag for the test having run
+	double score;		//lower is better
+	double settle;		//time to the first shot or to settle in s
+	double recovery;	//mean time between shots in s
+	double error;		//RMS shot speed error in percent or total overshoot in degrees
+	int count;			//balls fired or turns settled
+	double speed;		//shot speed of a reference test in m/s
+} typedef Outcome;
+
+//group of parameters tuned together data structure
+struct{
+	const char* name;					//name given to -c
+	Param params[MAX_PARAMS];			//parameters of the group
+	int count;							//parameters in the group
+	int tests;							//tests run for each candidate
+	void (*test)(int test, const double* values, Outcome* outcome);	//run a test in a forked child
+} typedef Group;
+
+static void testFlywheel(int preset, const double* values, Outcome* outcome);
+static void testTurn(int test, const double* values, Outcome* outcome);
+
+static const Group groups[] = {
+	{"flywheel", {
+		{"fire.slope", 0, 1.5, false, offsetof(Gains, flywheel.fireSlope)},
+		{"fire.offset", 0, 150, false, offsetof(Gains, flywheel.fireOffset)}
+	}, 2, PRESETS, testFlywheel},
+	{"turn", {
+		{"turn.kP", 0.5, 15, false, offsetof(Gains, turn.kP)},
+		{"turn.kD", 0, 1.0, false, offsetof(Gains, turn.kD)},
+		{"turn.minOutput", 0, 50, true, offsetof(Gains, turn.minOutput)}
+	}, 3, 1, testTurn}
+};
+
+#define GROUPS (sizeof(groups) / sizeof(Group))
+
+static const char* presetNames[PRESETS] = {"low", "high"};
+static const unsigned char presetButtons[PRESETS] = {JOY_LEFT, JOY_RIGHT};	//7L and 7R
+
+//settings
+static int workers = 0;
+static int balls = 5;
+static unsigned long fireLimit = 15000;
+static double referenceSpeed[PRESETS];	//shot speed at the steady flywheel speed of each preset
+
+//batch being evaluated, read by the forked children
+static const Group* batchGroup = NULL;
+static double (*batchPoints)[MAX_PARAMS] = NULL;
+
+/*
+ * Print a message to stderr.
+ *
+ * @param message The message.
+ */
+static void report(const char* message){
+	if(write(2, message, strlen(message)) < 0)
+		return;
+}
+
+/*
+ * Print the usage and stop.
+ *
+ * @param name The name of the program.
+ */
+static void usage(const char* name){
+	report("usage: ");
+	report(name);
+	report(" [-c flywheel|turn|all] [-j jobs] [-g points] [-i iterations] [-b balls] [-t ms] [-o file]\n");
+	_exit(1);
+}
+
+/*
+ * Print formatted text to a file descriptor.
+ */
+static void output(int fd, const char* format, ...){
+	char line[256];
+	va_list args;
+	va_start(args, format);
+	int size = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if(size > (int) sizeof(line) - 1)
+		size = sizeof(line) - 1;
+	if(write(fd, line, size) < 0)
+		_exit(1);
+}
+
+/*
+ * Start the robot disabled with a set of parameters. Only called in a
+ * forked child.
+ *
+ * @param config The plant parameters, NULL for the defaults.
+ * @param values The group's parameter values, NULL to keep the hand tuned ones.
+ * @return If initialize() finished.
+ */
+static bool startRobot(const PlantConfig* config, const double* values){
+
+	sim_init();
+	sim_setUart(stdout, -1);	//the robot's debug output is not wanted
+	if(!session_start("r1", false, config))
+		return false;
+
+	//the parameters under test
+	if(values != NULL){
+		Gains gains = gains_get();
+		for(int i = 0; i < batchGroup->count; i++){
+			const Param* p = &batchGroup->params[i];
+			if(p->integer)
+				*(int*) ((char*) &gains + p->offset) = lround(values[i]);
+			else
+				*(double*) ((char*) &gains + p->offset) = values[i];
+		}
+		gains_set(gains);
+	}
+
+	return true;
+}
+
+/*
+ * Select flywheel mode and a preset in driver control.
+ *
+ * @param preset The preset index.
+ */
+static void selectPreset(int preset){
+	sim_setJoystickDigital(1, 8, JOY_DOWN, true);
+	delay(100);
+	sim_setJoystickDigital(1, 8, JOY_DOWN, false);
+	sim_setJoystickDigital(1, 7, presetButtons[preset], true);
+	delay(100);
+	sim_setJoystickDigital(1, 7, presetButtons[preset], false);
+}
+
+/*
+ * Measure the shot speed of a preset with the flywheel at its steady
+ * speed: spin the flywheel up in manual fire, then feed one ball.
+ *
+ * @param preset The preset index.
+ * @param values Unused, the hand tuned parameters are kept.
+ * @param outcome Filled in with the shot speed.
+ */
+static void testReference(int preset, const double* values, Outcome* outcome){
+
+	if(!startRobot(NULL, NULL))
+		return;
+	plant_loadBalls(1);
+	session_runMode(false);
+	selectPreset(preset);
+
+	sim_setJoystickDigital(1, 8, JOY_LEFT, true);
+	delay(REFERENCE_MS);
+	sim_setJoystickDigital(1, 6, JOY_UP, true);
+	for(int i = 0; i < 5000 && plant_getShots() == 0; i++)
+		delay(1);
+
+	outcome->valid = plant_getShots() > 0;
+	outcome->speed = plant_getLastShotSpeed();
+}
+
+/*
+ * Hold rapid fire at a preset with balls in the intake.
+ *
+ * @param preset The preset index.
+ * @param values The flywheel parameters under test.
+ * @param outcome Filled in with the score of the test.
+ */
+static void testFlywheel(int preset, const double* values, Outcome* outcome){
+
+	if(!startRobot(NULL, values))
+		return;
+	plant_loadBalls(balls);
+	session_runMode(false);
+	selectPreset(preset);
+
+	//fire until every ball is gone or the time is up
+	double times[MAX_SHOTS], speeds[MAX_SHOTS];
+	int shots = 0;
+	sim_setJoystickDigital(1, 8, JOY_RIGHT, true);
+	unsigned long start = millis();
+	while(shots < balls && millis() - start < fireLimit){
+		delay(1);
+		if(plant_getShots() > shots){
+			times[shots] = (millis() - start) / 1000.0;
+			speeds[shots++] = plant_getLastShotSpeed();
+		}
+	}
+
+	//RMS shot speed error against the steady flywheel speed
+	double sum = 0;
+	for(int i = 0; i < shots; i++)
+		sum += pow(100 * (speeds[i] / referenceSpeed[preset] - 1), 2);
+
+	outcome->valid = true;
+	outcome->count = shots;
+	outcome->settle = shots > 0 ? times[0] : fireLimit / 1000.0;
+	outcome->recovery = shots > 1 ? (times[shots - 1] - times[0]) / (shots - 1) : 0;
+	outcome->error = shots > 0 ? sqrt(sum / shots) : 0;
+	outcome->score = (shots == balls ? times[shots - 1] : fireLimit / 1000.0) + MISS_PENALTY * (balls - shots)
+			+ SPEED_WEIGHT * outcome->error;
+}
+
+/*
+ * Turn in place through a set of angles with a gyro fitted.
+ *
+ * @param test Unused, there is one turn test.
+ * @param values The turn parameters under test.
+ * @param outcome Filled in with the score of the test.
+ */
+static void testTurn(int test, const double* values, Outcome* outcome){
+
+	static const int targets[] = {90, -45, -15};	//turns of 90, -135 and 30 degrees
+
+	PlantConfig config = plant_defaults();
+	config.gyro = GYRO_PORT;
+	if(!startRobot(&config, NULL))
+		return;
+
+	//fit the gyro the controller needs, then use the parameters under test
+	Robot.turnSensor = sensor_init(GYRO, GYRO_PORT, 0, 0);
+	turn_init();
+	if(values != NULL){
+		TurnGains gains = turn_getGains();
+		gains.kP = values[0];
+		gains.kD = values[1];
+		gains.minOutput = lround(values[2]);
+		turn_setGains(gains);
+	}
+	sim_setCompetition(true, true);
+
+	outcome->valid = true;
+	int from = turn_getHeading();
+	for(unsigned int i = 0; i < sizeof(targets) / sizeof(int); i++){
+		int direction = targets[i] > from ? 1 : -1;
+		int overshoot = 0;
+		turn_toAngle(targets[i]);
+		unsigned long start = millis();
+		while(millis() - start < TURN_LIMIT && !(millis() - start > TURN_PERIOD * TURN_SETTLE && turn_isSettled())){
+			delay(1);
+			int past = (turn_getHeading() - targets[i]) * direction;
+			overshoot = past > overshoot ? past : overshoot;
+		}
+		outcome->count += turn_isSettled();
+		outcome->settle += (millis() - start) / 1000.0;
+		outcome->error += overshoot;
+		from = targets[i];
+	}
+	turn_stop();
+
+	outcome->score = outcome->settle + OVERSHOOT_WEIGHT * outcome->error;
+}
+
+/*
+ * Run one test of one candidate. Runs in a child forked by pool_run().
+ *
+ * @param job The candidate times the group's tests plus the test.
+ * @param result Filled in with the test's outcome.
+ */
+static void runTest(int job, void* result){
+	const double* values = batchPoints[job / batchGroup->tests];
+	batchGroup->test(job % batchGroup->tests, isnan(values[0]) ? NULL : values, result);
+}
+
+/*
+ * Run the reference shots. Runs in a child forked by pool_run().
+ *
+ * @param preset The preset index.
+ * @param result Filled in with the shot speed.
+ */
+static void runReference(int preset, void* result){
+	testReference(preset, NULL, result);
+}
+
+/*
+ * Score a batch of candidates across every core.
+ *
+ * @param group The group being tuned.
+ * @param points The parameter values of each candidate, NAN first for the hand tuned ones.
+ * @param count The number of candidates.
+ * @param scores Set to each candidate's score, INFINITY if a test failed.
+ * @param outcomes Set to each candidate's test outcomes if not NULL.
+ */
+static void evaluate(const Group* group, double (*points)[MAX_PARAMS], int count, double* scores, Outcome* outcomes){
+
+	Outcome* results = calloc(count * group->tests, sizeof(Outcome));
+	batchGroup = group;
+	batchPoints = points;
+	pool_run(runTest, count * group->tests, workers, results, sizeof(Outcome));
+
+	for(int i = 0; i < count; i++){
+		scores[i] = 0;
+		for(int t = 0; t < group->tests; t++){
+			Outcome* o = &results[i * group->tests + t];
+			scores[i] += o->valid ? o->score : INFINITY;
+		}
+	}
+	if(outcomes != NULL)
+		memcpy(outcomes, results, count * group->tests * sizeof(Outcome));
+	free(results);
+}
+
+/*
+ * Map a point of the unit cube onto the group's parameter ranges.
+ *
+ * @param group The group being tuned.
+ * @param unit The point with every coordinate clamped to 0 to 1.
+ * @param values Set to the parameter values.
+ */
+static void toValues(const Group* group, const double* unit, double* values){
+	for(int i = 0; i < group->count; i++){
+		const Param* p = &group->params[i];
+		double u = fmin(fmax(unit[i], 0), 1);
+		values[i] = p->low + u * (p->high - p->low);
+		if(p->integer)
+			values[i] = round(values[i]);
+	}
+}
+
+/*
+ * Score points of the unit cube.
+ *
+ * @param group The group being tuned.
+ * @param units The points.
+ * @param count The number of points.
+ * @param scores Set to each point's score.
+ */
+static void evaluateUnits(const Group* group, double (*units)[MAX_PARAMS], int count, double* scores){
+	static double values[MAX_POINTS][MAX_PARAMS];
+	for(int i = 0; i < count; i++)
+		toValues(group, units[i], values[i]);
+	evaluate(group, values, count, scores, NULL);
+}
+
+/*
+ * Print a candidate's parameters and test outcomes.
+ *
+ * @param group The group being tuned.
+ * @param label What the candidate is.
+ * @param values The parameter values, NULL for the hand tuned ones.
+ */
+static void describe(const Group* group, const char* label, const double* values){
+
+	double points[1][MAX_PARAMS];
+	double score;
+	Outcome outcomes[PRESETS];
+	for(int i = 0; i < MAX_PARAMS; i++)
+		points[0][i] = values != NULL && i < group->count ? values[i] : NAN;
+	evaluate(group, points, 1, &score, outcomes);
+
+	output(1, "  %-10s score %7.3f  ", label, score);
+	for(int i = 0; i < group->count; i++)
+		if(values == NULL)
+			output(1, " %s hand tuned", group->params[i].name);
+		else
+			output(1, group->params[i].integer ? " %s %.0f" : " %s %.3f", group->params[i].name, values[i]);
+	output(1, "\n");
+
+	for(int t = 0; t < group->tests; t++){
+		Outcome* o = &outcomes[t];
+		if(!o->valid)
+			output(1, "    test %d did not run\n", t);
+		else if(group->test == testFlywheel)
+			output(1, "    %-4s preset: %d/%d balls, first after %.2f s, %.2f s apart, shot speed error %.1f%%\n",
+					presetNames[t], o->count, balls, o->settle, o->recovery, o->error);
+		else
+			output(1, "    turns: %d/3 settled in %.2f s, %.0f deg overshoot\n", o->count, o->settle, o->error);
+	}
+}
+
+/*
+ * Tune a group: grid sweep, then Nelder-Mead from the best grid point.
+ *
+ * @param group The group to tune.
+ * @param points Grid points per parameter.
+ * @param iterations The most Nelder-Mead iterations.
+ * @param best Set to the best parameter values found.
+ */
+static void tune(const Group* group, int points, int iterations, double* best){
+
+	int n = group->count;
+	static double units[MAX_POINTS][MAX_PARAMS];
+	static double scores[MAX_POINTS];
+
+	//grid sweep
+	int total = 1;
+	for(int i = 0; i < n; i++)
+		total *= points;
+	for(int k = 0; k < total; k++)
+		for(int i = 0, rest = k; i < n; i++, rest /= points)
+			units[k][i] = points > 1 ? (double) (rest % points) / (points - 1) : 0.5;
+	evaluateUnits(group, units, total, scores);
+
+	int first = 0;
+	for(int k = 1; k < total; k++)
+		if(scores[k] < scores[first])
+			first = k;
+	output(1, "  grid of %d: best score %.3f\n", total, scores[first]);
+
+	//simplex around the best grid point, a grid step along each axis
+	double simplex[MAX_PARAMS + 1][MAX_PARAMS];
+	double values[MAX_PARAMS + 1];
+	double step = points > 1 ? 1.0 / (points - 1) : 0.25;
+	for(int v = 0; v <= n; v++){
+		for(int i = 0; i < n; i++)
+			simplex[v][i] = units[first][i];
+		if(v > 0)
+			simplex[v][v - 1] += simplex[v][v - 1] + step <= 1 ? step : -step;
+	}
+	values[0] = scores[first];
+	evaluateUnits(group, simplex + 1, n, values + 1);
+
+	int iteration;
+	for(iteration = 0; iteration < iterations; iteration++){
+
+		//order the vertices best to worst
+		for(int a = 1; a <= n; a++)
+			for(int b = a; b > 0 && values[b] < values[b - 1]; b--){
+				double t = values[b];
+				values[b] = values[b - 1];
+				values[b - 1] = t;
+				for(int i = 0; i < n; i++){
+					t = simplex[b][i];
+					simplex[b][i] = simplex[b - 1][i];
+					simplex[b - 1][i] = t;
+				}
+			}
+
+		//stop once the simplex has shrunk below a thousandth of the ranges
+		double size = 0;
+		for(int v = 1; v <= n; v++)
+			for(int i = 0; i < n; i++)
+				size = fmax(size, fabs(simplex[v][i] - simplex[0][i]));
+		if(size < 1e-3)
+			break;
+
+		//reflection, expansion and both contractions of the worst vertex at once
+		double centroid[MAX_PARAMS] = {0};
+		for(int v = 0; v < n; v++)
+			for(int i = 0; i < n; i++)
+				centroid[i] += simplex[v][i] / n;
+		static const double coefficients[4] = {1, 2, 0.5, -0.5};	//reflect, expand, outside, inside
+		double trial[4][MAX_PARAMS];
+		double trialValues[4];
+		for(int c = 0; c < 4; c++)
+			for(int i = 0; i < n; i++)
+				trial[c][i] = fmin(fmax(centroid[i] + coefficients[c] * (centroid[i] - simplex[n][i]), 0), 1);
+		evaluateUnits(group, trial, 4, trialValues);
+
+		int chosen = -1;
+		if(trialValues[0] < values[0])
+			chosen = trialValues[1] < trialValues[0] ? 1 : 0;
+		else if(trialValues[0] < values[n - 1])
+			chosen = 0;
+		else if(trialValues[0] < values[n])
+			chosen = trialValues[2] <= trialValues[0] ? 2 : -1;
+		else
+			chosen = trialValues[3] < values[n] ? 3 : -1;
+
+		if(chosen >= 0){
+			for(int i = 0; i < n; i++)
+				simplex[n][i] = trial[chosen][i];
+			values[n] = trialValues[chosen];
+		}
+
+		//shrink towards the best vertex
+		else{
+			for(int v = 1; v <= n; v++)
+				for(int i = 0; i < n; i++)
+					simplex[v][i] = simplex[0][i] + 0.5 * (simplex[v][i] - simplex[0][i]);
+			evaluateUnits(group, simplex + 1, n, values + 1);
+		}
+	}
+
+	int winner = 0;
+	for(int v = 1; v <= n; v++)
+		if(values[v] < values[winner])
+			winner = v;
+	output(1, "  Nelder-Mead: %d iterations, best score %.3f\n", iteration, values[winner]);
+	toValues(group, simplex[winner], best);
+}
+
+int main(int argc, char** argv){
+
+	const char* choice = "all";			//groups to tune
+	const char* name = GAINS_FILE;		//gains file to write
+	int points = 5;						//grid points per parameter
+	int iterations = 40;				//most Nelder-Mead iterations
+	int option;
+
+	workers = pool_cores();
+	while((option = getopt(argc, argv, "c:j:g:i:b:t:o:")) != -1)
+		switch(option){
+		case 'c':
+			choice = optarg;
+			break;
+		case 'j':
+			workers = strtol(optarg, NULL, 10);
+			break;
+		case 'g':
+			points = strtol(optarg, NULL, 10);
+			break;
+		case 'i':
+			iterations = strtol(optarg, NULL, 10);
+			break;
+		case 'b':
+			balls = strtol(optarg, NULL, 10);
+			break;
+		case 't':
+			fireLimit = strtoul(optarg, NULL, 10);
+			break;
+		case 'o':
+			name = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+
+	bool all = strcmp(choice, "all") == 0;
+	bool known = all;
+	for(unsigned int g = 0; g < GROUPS; g++)
+		known |= strcmp(choice, groups[g].name) == 0;
+	if(!known || points < 1 || iterations < 0 || balls < 1 || balls > MAX_SHOTS)
+		usage(argv[0]);
+	for(unsigned int g = 0; g < GROUPS; g++){
+		int total = 1;
+		for(int i = 0; i < groups[g].count; i++)
+			total *= points;
+		if(total * groups[g].tests > MAX_POINTS)
+			usage(argv[0]);
+	}
+
+	//shot speed at the steady flywheel speed of each preset
+	Outcome references[PRESETS];
+	pool_run(runReference, PRESETS, workers, references, sizeof(Outcome));
+	for(int p = 0; p < PRESETS; p++){
+		if(!references[p].valid){
+			report("autotune: the reference shot was not fired\n");
+			return 1;
+		}
+		referenceSpeed[p] = references[p].speed;
+	}
+
+	int fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0){
+		report("autotune: cannot write the gains file\n");
+		return 1;
+	}
+	output(fd, "# written by autotune, loaded by the robot at start up\n");
+
+	for(unsigned int g = 0; g < GROUPS; g++){
+		const Group* group = &groups[g];
+		if(!all && strcmp(choice, group->name) != 0)
+			continue;
+
+		output(1, "%s\n", group->name);
+		double best[MAX_PARAMS];
+		describe(group, "before", NULL);
+		tune(group, points, iterations, best);
+		describe(group, "after", best);
+
+		for(int i = 0; i < group->count; i++)
+			output(fd, group->params[i].integer ? "%s %.0f\n" : "%s %.4f\n", group->params[i].name, best[i]);
+	}
+
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,338 @@
+/*
+ * @file bench.c
+ *
+ * @brief Runs the driver control microbenchmarks in include/bench.h against
+ *        the host simulation and reports, for each benchmark, the virtual
+ *        time per call (what the API calls it makes cost, including any
+ *        delays), the host time per call, the PROS API calls it makes and
+ *        the robot functions it calls, then how much of the driver control
+ *        loop userControl() takes. The robot program is built with
+ *        -finstrument-functions for this tool, which is how the robot
+ *        function calls are counted.
+ *
+ *        usage: bench [-v] [-w file] [-c file] [-t percent]
+ *
+ *          -v          list the API and robot function calls of every benchmark
+ *          -w file     write the results as a new baseline
+ *          -c file     compare the results to a baseline and fail on a regression
+ *          -t percent  growth over the baseline that counts as a regression (10)
+ *
+ *        A baseline holds one benchmark per line: its name, virtual us per
+ *        call, API calls per call and robot function calls per call. Only
+ *        the virtual time and call counts are compared, as they are the same
+ *        on every workstation. `make benchmark` checks against bench.txt.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <main.h>
+#include <bench.h>
+#include "sim/session.h"
+
+int vsnprintf(char* buffer, size_t limit, const char* formatString, va_list args);	//from the C library, <stdio.h> clashes with API.h
+
+#define MAX_BENCHMARKS 32	//most benchmarks
+#define MAX_CALLS      64	//most API calls listed per benchmark
+#define FUNCTIONS      256	//slots of the robot function call table
+#define BASELINE_SIZE  4096	//largest baseline file in bytes
+
+//results of one benchmark data structure
+struct{
+	const char* name;		//benchmark name
+	double virtualUs;		//virtual us per call
+	double hostNs;			//host ns per call
+	double apiCalls;		//PROS API calls per call
+	double robotCalls;		//robot function calls per call
+} typedef Result;
+
+//robot function call counts, filled in by the instrumentation hook
+static void* functions[FUNCTIONS];			//function addresses, open addressing
+static unsigned long functionCounts[FUNCTIONS];
+static __thread bool counting = false;		//only the host thread running a benchmark counts
+
+/*
+ * Called on entry to every robot function.
+ */
+__attribute__((no_instrument_function))
+void __cyg_profile_func_enter(void* function, void* site){
+
+	if(!counting)
+		return;
+
+	unsigned int i = ((unsigned long) function >> 4) % FUNCTIONS;
+	for(int probes = 0; probes < FUNCTIONS; probes++, i = (i + 1) % FUNCTIONS)
+		if(functions[i] == function || functions[i] == NULL){
+			functions[i] = function;
+			functionCounts[i]++;
+			return;
+		}
+}
+
+/*
+ * Called on exit from every robot function.
+ */
+__attribute__((no_instrument_function))
+void __cyg_profile_func_exit(void* function, void* site){
+}
+
+/*
+ * Print a message to stderr.
+ *
+ * @param message The message.
+ */
+static void report(const char* message){
+	if(write(2, message, strlen(message)) < 0)
+		return;
+}
+
+/*
+ * Print the usage and stop.
+ *
+ * @param name The name of the program.
+ */
+static void usage(const char* name){
+	report("usage: ");
+	report(name);
+	report(" [-v] [-w file] [-c file] [-t percent]\n");
+	_exit(1);
+}
+
+/*
+ * Print formatted text to a file descriptor.
+ */
+static void output(int fd, const char* format, ...){
+	char line[256];
+	va_list args;
+	va_start(args, format);
+	int size = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if(size > (int) sizeof(line) - 1)
+		size = sizeof(line) - 1;
+	if(write(fd, line, size) < 0)
+		_exit(1);
+}
+
+/*
+ * Retrieve the host time.
+ *
+ * @return The monotonic time in ns.
+ */
+static double hostNow(){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/*
+ * Print the API and robot function calls counted, per call of a benchmark.
+ *
+ * @param iterations The calls of the benchmark.
+ */
+static void listCalls(int iterations){
+
+	const char* names[MAX_CALLS];
+	unsigned long counts[MAX_CALLS];
+	int n = sim_getCalls(names, counts, MAX_CALLS);
+	for(int i = 0; i < n; i++)
+		if(strcmp(names[i], "micros") != 0)
+			output(1, "    api    %-24s %8.2f\n", names[i], (double) counts[i] / iterations);
+
+	for(int i = 0; i < FUNCTIONS; i++)
+		if(functions[i] != NULL && functionCounts[i] > 0){
+			Dl_info info;
+			const char* name = dladdr(functions[i], &info) && info.dli_sname != NULL ? info.dli_sname : "(static)";
+			output(1, "    robot  %-24s %8.2f\n", name, (double) functionCounts[i] / iterations);
+		}
+}
+
+/*
+ * Run one benchmark with the counters on.
+ *
+ * @param b The benchmark.
+ * @param verbose If every call should be listed.
+ * @return The results.
+ */
+static Result measure(const Benchmark* b, bool verbose){
+
+	//set up outside of the counts
+	if(b->setup != NULL)
+		b->setup();
+	Benchmark timed = *b;
+	timed.setup = NULL;
+
+	sim_resetCalls();
+	memset(functions, 0, sizeof(functions));
+	memset(functionCounts, 0, sizeof(functionCounts));
+
+	counting = true;
+	double start = hostNow();
+	unsigned long us = bench_time(&timed);
+	double ns = hostNow() - start;
+	counting = false;
+
+	//the two micros() calls timing the benchmark are not part of it
+	Result r = {b->name, (double) us / b->iterations, ns / b->iterations, 0, 0};
+	const char* names[MAX_CALLS];
+	unsigned long counts[MAX_CALLS];
+	int n = sim_getCalls(names, counts, MAX_CALLS);
+	for(int i = 0; i < n; i++)
+		if(strcmp(names[i], "micros") != 0)
+			r.apiCalls += (double) counts[i] / b->iterations;
+	for(int i = 0; i < FUNCTIONS; i++)
+		if(functions[i] != NULL && functions[i] != (void*) b->run && functions[i] != (void*) bench_time)
+			r.robotCalls += (double) functionCounts[i] / b->iterations;
+
+	output(1, "%-26s %12.2f %12.1f %10.2f %10.2f\n", r.name, r.virtualUs, r.hostNs, r.apiCalls, r.robotCalls);
+	if(verbose || b->run == bench_get(0)->run)
+		listCalls(b->iterations);
+
+	return r;
+}
+
+/*
+ * Compare results to a baseline.
+ *
+ * @param name The baseline file.
+ * @param results The results.
+ * @param count The number of results.
+ * @param tolerance The growth that counts as a regression, as a share.
+ * @return If nothing regressed.
+ */
+static bool compare(const char* name, Result* results, int count, double tolerance){
+
+	static char text[BASELINE_SIZE];
+	int fd = open(name, O_RDONLY);
+	if(fd < 0){
+		report("bench: cannot read the baseline\n");
+		return false;
+	}
+	int size = read(fd, text, BASELINE_SIZE - 1);
+	close(fd);
+	text[size < 0 ? 0 : size] = '\0';
+
+	bool passed = true;
+	output(1, "\nagainst %s:\n", name);
+	for(char* line = strtok(text, "\n"); line != NULL; line = strtok(NULL, "\n")){
+		if(line[0] == '#')
+			continue;
+
+		//name, virtual us, API calls and robot calls
+		char* end = line;
+		while(*end != '\0' && *end != ' ' && *end != '\t')
+			end++;
+		int length = end - line;
+		double base[3];
+		for(int i = 0; i < 3; i++)
+			base[i] = strtod(end, &end);
+
+		Result* r = NULL;
+		for(int i = 0; i < count && r == NULL; i++)
+			if((int) strlen(results[i].name) == length && strncmp(results[i].name, line, length) == 0)
+				r = &results[i];
+		if(r == NULL){
+			output(1, "  %-26s missing\n", line);
+			passed = false;
+			continue;
+		}
+
+		double now[3] = {r->virtualUs, r->apiCalls, r->robotCalls};
+		static const char* metrics[3] = {"us/call", "api calls", "robot calls"};
+		bool regressed = false;
+		for(int i = 0; i < 3; i++)
+			if(now[i] > base[i] * (1 + tolerance) + 0.01){
+				output(1, "  %-26s REGRESSION %s %.2f -> %.2f\n", r->name, metrics[i], base[i], now[i]);
+				regressed = true;
+			}
+		if(!regressed)
+			output(1, "  %-26s ok\n", r->name);
+		passed &= !regressed;
+	}
+
+	return passed;
+}
+
+int main(int argc, char** argv){
+
+	const char* baseline = NULL;	//baseline to compare to
+	const char* save = NULL;		//baseline to write
+	double tolerance = 10;			//regression threshold in percent
+	bool verbose = false;
+	int option;
+
+	while((option = getopt(argc, argv, "vw:c:t:")) != -1)
+		switch(option){
+		case 'v':
+			verbose = true;
+			break;
+		case 'w':
+			save = optarg;
+			break;
+		case 'c':
+			baseline = optarg;
+			break;
+		case 't':
+			tolerance = strtod(optarg, NULL);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	if(bench_count() > MAX_BENCHMARKS)
+		usage(argv[0]);
+
+	//driver control with the robot enabled and nothing touched
+	sim_init();
+	sim_setUart(stdout, -1);	//the robot's debug output is not wanted
+	if(!session_start("r1", false, NULL)){
+		report("bench: initialize() did not finish the start up menu\n");
+		return 1;
+	}
+	sim_setCompetition(true, false);
+
+	Result results[MAX_BENCHMARKS];
+	output(1, "%-26s %12s %12s %10s %10s\n", "benchmark", "virtual us", "host ns", "api calls", "robot calls");
+	for(int i = 0; i < bench_count(); i++)
+		results[i] = measure(bench_get(i), verbose);
+
+	//userControl() is the first benchmark
+	double loop = results[0].virtualUs;
+	double tick = loop + BENCH_LOOP_PERIOD * 1000;
+	output(1, "\ndriver loop: userControl() takes %.0f us of a %.0f us tick (%.0f%%), the loop runs at %.1f Hz\n",
+			loop, tick, 100 * loop / tick, 1e6 / tick);
+
+	if(save != NULL){
+		int fd = open(save, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(fd < 0){
+			report("bench: cannot write the baseline\n");
+			return 1;
+		}
+		output(fd, "# benchmark  virtual us/call  api calls/call  robot calls/call\n");
+		for(int i = 0; i < bench_count(); i++)
+			output(fd, "%s %.2f %.2f %.2f\n", results[i].name, results[i].virtualUs, results[i].apiCalls,
+					results[i].robotCalls);
+		close(fd);
+	}
+
+	if(baseline != NULL && !compare(baseline, results, bench_count(), tolerance / 100))
+		return 1;
+
+	return 0;
+}
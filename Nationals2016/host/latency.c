@@ -0,0 +1,270 @@
+/*
+ * @file latency.c
+ *
+ * @brief Measures the joystick to motor latency of driver control in the
+ *        host simulation. The robot program is built with the latency
+ *        monitor in include/latency.h, driver control is started, then the
+ *        joystick inputs of each control path are stepped on and off while
+ *        the monitor times how long the motors take to follow. The steps
+ *        are spread over the phase of the driver control loop, so the
+ *        percentiles cover a stick moved at any point in it.
+ *
+ *        usage: latency [-d dir] [-s slot] [-n steps] [-w file] [-c file]
+ *                       [-t percent]
+ *
+ *          -d dir      directory standing in for the flash file system (.)
+ *          -s slot     sk, r1, r2, b1 or b2 (r1)
+ *          -n steps    steps on and off per control path (40)
+ *          -w file     write the results as a new baseline
+ *          -c file     compare the results to a baseline and fail on a regression
+ *          -t percent  growth over the baseline that counts as a regression (10)
+ *
+ *        A baseline holds one control path per line: its name and the 50th,
+ *        90th and 99th percentile latencies in us. `make benchmark` checks
+ *        against latency.txt.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <main.h>
+#include <latency.h>
+#include "sim/session.h"
+
+int vsnprintf(char* buffer, size_t limit, const char* formatString, va_list args);	//from the C library, <stdio.h> clashes with API.h
+
+#define SETTLE_TIME   1000	//time in ms driver control runs before the first step
+#define STEP_GAP      250	//shortest time in ms between steps
+#define STEP_HOLD     200	//time in ms each step is held
+#define PHASE_STEP    7		//shift in ms of each step against the driver control loop
+#define PHASE_SPAN    50	//span in ms the steps are spread over, at least one loop
+#define BASELINE_SIZE 1024	//largest baseline file in bytes
+
+static const int percents[3] = {50, 90, 99};	//percentiles kept in a baseline
+
+/*
+ * Print a message to stderr.
+ *
+ * @param message The message.
+ */
+static void report(const char* message){
+	if(write(2, message, strlen(message)) < 0)
+		return;
+}
+
+/*
+ * Print the usage and stop.
+ *
+ * @param name The name of the program.
+ */
+static void usage(const char* name){
+	report("usage: ");
+	report(name);
+	report(" [-d dir] [-s slot] [-n steps] [-w file] [-c file] [-t percent]\n");
+	_exit(1);
+}
+
+/*
+ * Print formatted text to a file descriptor.
+ */
+static void output(int fd, const char* format, ...){
+	char line[256];
+	va_list args;
+	va_start(args, format);
+	int size = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if(size > (int) sizeof(line) - 1)
+		size = sizeof(line) - 1;
+	if(write(fd, line, size) < 0)
+		_exit(1);
+}
+
+/*
+ * Move the joystick inputs of a control path.
+ *
+ * @param path The control path.
+ * @param on If the inputs are stepped on or back off.
+ */
+static void step(int path, bool on){
+
+	switch(path){
+	case LATENCY_DRIVE:
+		sim_setJoystickAnalog(1, 2, on ? 100 : 0);
+		sim_setJoystickAnalog(1, 3, on ? 100 : 0);
+		break;
+	case LATENCY_INTAKE:
+		sim_setJoystickDigital(1, 6, JOY_UP, on);
+		break;
+	default:
+		sim_setJoystickDigital(1, 8, JOY_LEFT, on);	//flywheel mode runs the PTO while held
+		break;
+	}
+}
+
+/*
+ * Compare the percentiles to a baseline.
+ *
+ * @param name The baseline file.
+ * @param tolerance The growth that counts as a regression, as a share.
+ * @return If nothing regressed.
+ */
+static bool compare(const char* name, double tolerance){
+
+	static char text[BASELINE_SIZE];
+	int fd = open(name, O_RDONLY);
+	if(fd < 0){
+		report("latency: cannot read the baseline\n");
+		return false;
+	}
+	int size = read(fd, text, BASELINE_SIZE - 1);
+	close(fd);
+	text[size < 0 ? 0 : size] = '\0';
+
+	bool passed = true;
+	output(1, "\nagainst %s:\n", name);
+	for(char* line = strtok(text, "\n"); line != NULL; line = strtok(NULL, "\n")){
+		if(line[0] == '#')
+			continue;
+
+		//name and percentiles
+		char* end = line;
+		while(*end != '\0' && *end != ' ' && *end != '\t')
+			end++;
+		int length = end - line;
+		int path = 0;
+		while(path < LATENCY_PATHS && ((int) strlen(latency_getName(path)) != length ||
+				strncmp(latency_getName(path), line, length) != 0))
+			path++;
+		if(path == LATENCY_PATHS){
+			output(1, "  %-8s unknown\n", line);
+			passed = false;
+			continue;
+		}
+
+		//a path whose motors never answered has nothing to compare
+		if(latency_getCount(path) == 0){
+			output(1, "  %-8s REGRESSION no latencies measured\n", latency_getName(path));
+			passed = false;
+			continue;
+		}
+
+		//the monitor checks every LATENCY_PERIOD, so allow one period more
+		bool regressed = false;
+		for(int i = 0; i < 3; i++){
+			unsigned long base = strtoul(end, &end, 10);
+			unsigned long now = latency_getPercentile(path, percents[i]);
+			if(now > base * (1 + tolerance) + LATENCY_PERIOD * 1000){
+				output(1, "  %-8s REGRESSION p%d %lu us -> %lu us\n", latency_getName(path), percents[i], base, now);
+				regressed = true;
+			}
+		}
+		if(!regressed)
+			output(1, "  %-8s ok\n", latency_getName(path));
+		passed &= !regressed;
+	}
+
+	return passed;
+}
+
+int main(int argc, char** argv){
+
+	const char* slot = "r1";	//alliance and position
+	const char* baseline = NULL;	//baseline to compare to
+	const char* save = NULL;		//baseline to write
+	double tolerance = 10;			//regression threshold in percent
+	int steps = 40;					//steps per control path
+	int option;
+
+	sim_setFileRoot(".");
+	while((option = getopt(argc, argv, "d:s:n:w:c:t:")) != -1)
+		switch(option){
+		case 'd':
+			sim_setFileRoot(optarg);
+			break;
+		case 's':
+			slot = optarg;
+			break;
+		case 'n':
+			steps = strtol(optarg, NULL, 10);
+			break;
+		case 'w':
+			save = optarg;
+			break;
+		case 'c':
+			baseline = optarg;
+			break;
+		case 't':
+			tolerance = strtod(optarg, NULL);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	if(!session_isSlot(slot) || steps < 1)
+		usage(argv[0]);
+
+	sim_init();
+	sim_setUart(stdout, -1);	//the monitor's own reports are not wanted
+	if(!session_start(slot, false, NULL)){
+		report("latency: initialize() did not finish the start up menu\n");
+		return 1;
+	}
+	session_runMode(false);
+
+	//flywheel mode, the puncher cycles on its own
+	sim_setJoystickDigital(1, 8, JOY_DOWN, true);
+	delay(STEP_HOLD);
+	sim_setJoystickDigital(1, 8, JOY_DOWN, false);
+	delay(SETTLE_TIME);
+	latency_reset();
+
+	//step each path on and off, later steps landing later in the loop
+	for(int path = 0; path < LATENCY_PATHS; path++)
+		for(int i = 0; i < steps; i++){
+			delay(STEP_GAP + i * PHASE_STEP % PHASE_SPAN);
+			step(path, true);
+			delay(STEP_HOLD);
+			step(path, false);
+		}
+	delay(LATENCY_TIMEOUT);
+	sim_setCompetition(false, false);
+
+	output(1, "%-8s %5s %7s %9s %9s %9s %9s\n", "path", "n", "missed", "p50 ms", "p90 ms", "p99 ms", "max ms");
+	for(int path = 0; path < LATENCY_PATHS; path++)
+		output(1, "%-8s %5d %7d %9.2f %9.2f %9.2f %9.2f\n", latency_getName(path), latency_getCount(path),
+				latency_getMissed(path), latency_getPercentile(path, 50) / 1000.0,
+				latency_getPercentile(path, 90) / 1000.0, latency_getPercentile(path, 99) / 1000.0,
+				latency_getPercentile(path, 100) / 1000.0);
+
+	if(save != NULL){
+		int fd = open(save, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(fd < 0){
+			report("latency: cannot write the baseline\n");
+			return 1;
+		}
+		output(fd, "# path  p50 us  p90 us  p99 us\n");
+		for(int path = 0; path < LATENCY_PATHS; path++)
+			output(fd, "%s %lu %lu %lu\n", latency_getName(path), latency_getPercentile(path, percents[0]),
+					latency_getPercentile(path, percents[1]), latency_getPercentile(path, percents[2]));
+		close(fd);
+	}
+
+	if(baseline != NULL && !compare(baseline, tolerance / 100))
+		return 1;
+
+	return 0;
+}
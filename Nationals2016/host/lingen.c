@@ -0,0 +1,238 @@
+/*
+ * @file lingen.c
+ *
+ * @brief Generates a motor linearization table (include/linear.h) from a
+ *        characterization sweep, as C source to paste into src/linear.c.
+ *        The sweep is either read from a capture of the robot's debug
+ *        terminal holding the output of linear_characterize(), the last
+ *        complete sweep being used, or run on the simulated flywheel.
+ *
+ *        usage: lingen [-s] [-n name] [file] > table.c
+ *
+ *          -s       sweep the simulated flywheel instead of reading a capture
+ *          -n name  name of the table (linear_mc29)
+ *          file     capture holding the sweep, stdin if not given
+ *
+ *        The speeds are first made to never fall as the command rises.
+ *        Entry n of the table is then the command, interpolated between
+ *        the sweep's points, whose speed is n / 127 of the top speed.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <main.h>
+#include <linear.h>
+#include <wiring.h>
+#include "sim/session.h"
+
+int vsnprintf(char* buffer, size_t limit, const char* formatString, va_list args);	//from the C library, <stdio.h> clashes with API.h
+
+#define CAPTURE_SIZE (4 << 20)	//largest capture in bytes
+#define SHIFT_TIME   1000		//time in ms the simulated PTO is given to shift to the flywheel
+
+/*
+ * Print a message to stderr.
+ *
+ * @param message The message.
+ */
+static void report(const char* message){
+	if(write(2, message, strlen(message)) < 0)
+		return;
+}
+
+/*
+ * Print formatted text to stdout.
+ */
+static void output(const char* format, ...){
+	char line[512];
+	va_list args;
+	va_start(args, format);
+	int size = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if(size > (int) sizeof(line) - 1)
+		size = sizeof(line) - 1;
+	if(write(1, line, size) < 0)
+		_exit(1);
+}
+
+/*
+ * Print the usage and exit.
+ *
+ * @param name The name the tool was run as.
+ */
+static void usage(const char* name){
+	report("usage: ");
+	report(name);
+	report(" [-s] [-n name] [file] > table.c\n");
+	exit(1);
+}
+
+/*
+ * Run a sweep on the simulated flywheel.
+ *
+ * @param commands The command of each point, LINEAR_POINTS of them.
+ * @param speeds The speed of each point, LINEAR_POINTS of them.
+ * @return The number of points, 0 if the robot did not start.
+ */
+static int sweepSim(int* commands, int* speeds){
+
+	sim_init();
+	sim_setUart(stdout, -1);	//the robot's debug output is not wanted
+	if(!session_start("r1", false, NULL))
+		return 0;
+
+	//flywheel engaged and the robot enabled, with no mode running
+	digitalWrite(WIRING_PTO_SOLENOID, HIGH);
+	sim_setCompetition(true, false);
+	delay(SHIFT_TIME);
+
+	int count = linear_characterize(&Robot.PTO, &Robot.wheelEncoder, speeds, NULL);
+	for(int i = 0; i < count; i++)
+		commands[i] = i * LINEAR_STEP > 127 ? 127 : i * LINEAR_STEP;
+
+	return count;
+}
+
+/*
+ * Read the last complete sweep from a capture.
+ *
+ * @param in The capture being read.
+ * @param commands The command of each point, LINEAR_POINTS of them.
+ * @param speeds The speed of each point, LINEAR_POINTS of them.
+ * @return The number of points, 0 if there is no complete sweep.
+ */
+static int readCapture(int in, int* commands, int* speeds){
+
+	char* text = malloc(CAPTURE_SIZE);
+	int size = 0;
+	int n;
+	while(size < CAPTURE_SIZE - 1 && (n = read(in, text + size, CAPTURE_SIZE - 1 - size)) > 0)
+		size += n;
+	text[size] = '\0';
+
+	//last sweep with an end
+	char* sweep = NULL;
+	for(char* p = strstr(text, "linear begin"); p != NULL; p = strstr(p + 1, "linear begin"))
+		if(strstr(p, "linear end") != NULL)
+			sweep = p;
+	if(sweep == NULL)
+		return 0;
+
+	int count = 0;
+	for(char* line = strchr(sweep, '\n'); line != NULL && count < LINEAR_POINTS; line = strchr(line, '\n')){
+		line++;
+		if(strncmp(line, "linear end", 10) == 0)
+			break;
+		if(strncmp(line, "linear ", 7) != 0)
+			continue;
+
+		char* end;
+		commands[count] = strtol(line + 7, &end, 10);
+		speeds[count] = strtol(end, NULL, 10);
+		count++;
+	}
+
+	return count;
+}
+
+/*
+ * Build a table from a sweep.
+ *
+ * @param commands The command of each point, rising.
+ * @param speeds The speed of each point.
+ * @param count The number of points, at least 2.
+ * @param table The table, LINEAR_SIZE entries.
+ */
+static void buildTable(const int* commands, const int* speeds, int count, int* table){
+
+	//speeds that never fall as the command rises
+	int top[LINEAR_POINTS];
+	top[0] = speeds[0];
+	for(int i = 1; i < count; i++)
+		top[i] = speeds[i] > top[i - 1] ? speeds[i] : top[i - 1];
+
+	table[0] = 0;
+	int i = 1;	//first point at or above the speed
+	for(int n = 1; n < LINEAR_SIZE; n++){
+		double target = (double) n * top[count - 1] / (LINEAR_SIZE - 1);	//speed wanted
+		while(i < count - 1 && top[i] < target)
+			i++;
+
+		double share = top[i] == top[i - 1] ? 1 : (target - top[i - 1]) / (top[i] - top[i - 1]);
+		share = share < 0 ? 0 : share > 1 ? 1 : share;
+		table[n] = lround(commands[i - 1] + share * (commands[i] - commands[i - 1]));
+		if(table[n] < table[n - 1])
+			table[n] = table[n - 1];
+	}
+}
+
+int main(int argc, char** argv){
+
+	const char* name = "linear_mc29";	//name of the table
+	bool sim = false;					//flag for sweeping the simulated flywheel
+	int option;
+
+	while((option = getopt(argc, argv, "sn:")) != -1)
+		switch(option){
+		case 's':
+			sim = true;
+			break;
+		case 'n':
+			name = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	if(optind < argc - 1 || (sim && optind < argc))
+		usage(argv[0]);
+
+	int commands[LINEAR_POINTS];
+	int speeds[LINEAR_POINTS];
+	int count;
+	if(sim)
+		count = sweepSim(commands, speeds);
+	else{
+		int in = 0;	//capture being read
+		if(optind < argc && (in = open(argv[optind], O_RDONLY)) < 0){
+			report("lingen: cannot read the capture\n");
+			return 1;
+		}
+		count = readCapture(in, commands, speeds);
+	}
+
+	if(count < 2 || speeds[count - 1] <= 0){
+		report("lingen: no complete sweep found\n");
+		return 1;
+	}
+
+	int table[LINEAR_SIZE];
+	buildTable(commands, speeds, count, table);
+
+	output("//generated by host/lingen from %s, do not edit\n", sim ? "the simulated flywheel" : "a capture");
+	output("const unsigned char %s[LINEAR_SIZE] = {\n", name);
+	for(int n = 0; n < LINEAR_SIZE; n++)
+		output("%s%3d%s", n % 16 == 0 ? "\t" : " ", table[n], n == LINEAR_SIZE - 1 ? "\n" : n % 16 == 15 ? ",\n" : ",");
+	output("};\n");
+
+	char summary[128];
+	snprintf(summary, sizeof(summary), "lingen: %d points, top speed %d ticks/s\n", count, speeds[count - 1]);
+	report(summary);
+	return 0;
+}
@@ -0,0 +1,385 @@
+/*
+ * @file montecarlo.c
+ *
+ * @brief Checks how robust the autonomous routines are by running the robot
+ *        program's autonomous() against the host simulation many times with
+ *        the battery voltage, floor friction and starting pose randomized,
+ *        then reporting where the robot ends up and how often it ends up
+ *        where it does with nothing randomized.
+ *
+ *        usage: montecarlo [-d dir] [-s slot] [-n runs] [-j jobs] [-r seed]
+ *                          [-t ms] [-b balls] [-V volts] [-f share] [-p mm]
+ *                          [-a deg] [-e mm] [-h deg]
+ *
+ *          -d dir    directory holding the slot files (.)
+ *          -s slot   sk, r1, r2, b1 or b2, every slot with a recorded (.txt)
+ *                    or scripted (.aut) routine if not given
+ *          -n runs   randomized runs per slot (1000)
+ *          -j jobs   runs at once (the number of cores)
+ *          -r seed   random seed, the same seed gives the same report (1)
+ *          -t ms     time limit of each run (15000, 60000 for sk)
+ *          -b balls  balls loaded in the intake at the start (0)
+ *          -V volts  standard deviation of the battery voltage (0.3)
+ *          -f share  friction and traction vary by up to this share (0.2)
+ *          -p mm     standard deviation of the starting position (10)
+ *          -a deg    standard deviation of the starting heading (1.5)
+ *          -e mm     largest position error a run succeeds with (100)
+ *          -h deg    largest heading error a run succeeds with (10)
+ *
+ *        Each slot first runs once with nothing randomized, and that run's
+ *        end point is what the randomized runs are measured against. Like in
+ *        a match, a run is stopped at the time limit if autonomous() has not
+ *        returned by then, and it succeeds when the robot ends up inside both
+ *        tolerances having launched as many balls.
+ *
+ *        Runs are spread over every core with sim/pool. Each run seeds its
+ *        own random numbers from the seed, slot and run number, so the report
+ *        does not depend on which worker ran what.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <main.h>
+#include "sim/pool.h"
+#include "sim/session.h"
+
+int vsnprintf(char* buffer, size_t limit, const char* formatString, va_list args);	//from the C library, <stdio.h> clashes with API.h
+
+#define SLOTS       5	//sk, r1, r2, b1 and b2
+#define POLL_PERIOD 10	//ms between checks for the end of autonomous
+
+//end point of one run data structure
+struct{
+	bool started;			//flag for initialize() finishing the menu
+	bool finished;			//flag for autonomous() returning in time
+	double x;				//x position in mm
+	double y;				//y position in mm
+	double heading;			//heading in degrees
+	int shots;				//balls launched
+	unsigned long time;		//ms autonomous() ran for
+} typedef RunResult;
+
+//randomization and success settings
+static const char* slotNames[SLOTS] = {"sk", "r1", "r2", "b1", "b2"};
+static const char* slots[SLOTS];	//slots being checked
+static int slotCount = 0;
+static int runs = 1000;				//randomized runs per slot
+static unsigned long long seed = 1;
+static unsigned long timeLimit = 0;	//0 for the slot's match time
+static int balls = 0;
+static double voltageSpread = 0.3;
+static double frictionSpread = 0.2;
+static double poseSpread = 10;
+static double headingSpread = 1.5;
+static double positionTolerance = 100;
+static double headingTolerance = 10;
+
+static RunResult* results;			//one per run, nominal run first in each slot
+
+/*
+ * Print a message to stderr.
+ *
+ * @param message The message.
+ */
+static void report(const char* message){
+	if(write(2, message, strlen(message)) < 0)
+		return;
+}
+
+/*
+ * Print the usage and stop.
+ *
+ * @param name The name of the program.
+ */
+static void usage(const char* name){
+	report("usage: ");
+	report(name);
+	report(" [-d dir] [-s sk|r1|r2|b1|b2] [-n runs] [-j jobs] [-r seed] [-t ms] [-b balls] [-V volts] [-f share]"
+			" [-p mm] [-a deg] [-e mm] [-h deg]\n");
+	_exit(1);
+}
+
+/*
+ * Print formatted text to stdout.
+ */
+static void output(const char* format, ...){
+	char line[256];
+	va_list args;
+	va_start(args, format);
+	int size = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if(size > (int) sizeof(line) - 1)
+		size = sizeof(line) - 1;
+	if(write(1, line, size) < 0)
+		_exit(1);
+}
+
+/*
+ * Step a splitmix64 generator.
+ *
+ * @param state The generator state.
+ * @return The next 64 random bits.
+ */
+static unsigned long long nextRandom(unsigned long long* state){
+	unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/*
+ * Draw a uniform random number.
+ *
+ * @param state The generator state.
+ * @return A number in (0, 1).
+ */
+static double uniform(unsigned long long* state){
+	return ((nextRandom(state) >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/*
+ * Draw a normal random number with the Box-Muller transform.
+ *
+ * @param state The generator state.
+ * @param sigma The standard deviation.
+ * @return A number with mean 0.
+ */
+static double gaussian(unsigned long long* state, double sigma){
+	double u = uniform(state);
+	double v = uniform(state);
+	return sigma * sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+/*
+ * Wrap an angle to -180 to 180 degrees.
+ *
+ * @param degrees The angle.
+ * @return The wrapped angle.
+ */
+static double wrap(double degrees){
+	degrees = fmod(degrees + 180, 360);
+	return (degrees < 0 ? degrees + 360 : degrees) - 180;
+}
+
+/*
+ * Run autonomous once. Runs in a child forked by pool_run().
+ *
+ * @param job The run number: slot * (runs + 1) + run, run 0 being nominal.
+ * @param end Filled in with the end point of the run.
+ */
+static void runAutonomous(int job, void* end){
+
+	const char* slot = slots[job / (runs + 1)];
+	int run = job % (runs + 1);
+	unsigned long long state = seed ^ ((unsigned long long) job * 0xD1B54A32D192ED03ULL);
+	RunResult* result = end;
+
+	//randomize everything but the nominal run
+	PlantConfig config = plant_defaults();
+	double x = 0, y = 0, heading = 0;
+	if(run > 0){
+		config.batteryVoltage += gaussian(&state, voltageSpread);
+		double friction = 1 + frictionSpread * (2 * uniform(&state) - 1);
+		config.rollingFriction *= friction;
+		config.turnFriction *= friction;
+		config.traction *= 1 + frictionSpread * (2 * uniform(&state) - 1);
+		x = gaussian(&state, poseSpread);
+		y = gaussian(&state, poseSpread);
+		heading = gaussian(&state, headingSpread);
+	}
+
+	sim_init();
+	sim_setUart(stdout, -1);	//the robot's debug output is not wanted
+
+	result->started = session_start(slot, false, &config);
+	if(result->started){
+		unsigned long limit = timeLimit > 0 ? timeLimit : strcmp(slot, "sk") == 0 ? 60000 : 15000;
+		plant_setPose(x, y, heading);
+		plant_loadBalls(balls);
+		TaskHandle task = session_runMode(true);
+		unsigned long start = millis();
+		while(taskGetState(task) != TASK_DEAD && millis() - start < limit)
+			delay(POLL_PERIOD);
+		result->time = millis() - start;
+		result->finished = taskGetState(task) == TASK_DEAD;
+		plant_getPose(&result->x, &result->y, &result->heading);
+		result->shots = plant_getShots();
+	}
+}
+
+/*
+ * Compare two doubles for qsort.
+ */
+static int compareDouble(const void* a, const void* b){
+	double x = *(const double*) a, y = *(const double*) b;
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Print the end point distribution and success rate of a slot.
+ *
+ * @param index The slot's index in slots.
+ */
+static void summarize(int index){
+
+	RunResult* nominal = &results[index * (runs + 1)];
+	RunResult* sample = nominal + 1;
+	output("%s  nominal: ", slots[index]);
+	if(!nominal->started){
+		output("start up menu not finished, skipped\n");
+		return;
+	}
+	output("x %.0f y %.0f heading %.1f shots %d %s %lu ms\n", nominal->x, nominal->y, nominal->heading,
+			nominal->shots, nominal->finished ? "finished in" : "still running at", nominal->time);
+
+	double* errors = malloc(runs * sizeof(double));
+	int count = 0, started = 0, finished = 0, succeeded = 0, shotMin = 0, shotMax = 0;
+	double sx = 0, sy = 0, sh = 0, sxx = 0, syy = 0, shh = 0, se = 0, see = 0, shots = 0;
+
+	for(int i = 0; i < runs; i++){
+		RunResult* r = &sample[i];
+		if(!r->started)
+			continue;
+		started++;
+		finished += r->finished;
+
+		double error = hypot(r->x - nominal->x, r->y - nominal->y);
+		double turn = wrap(r->heading - nominal->heading);
+		if(error <= positionTolerance && fabs(turn) <= headingTolerance && r->shots >= nominal->shots)
+			succeeded++;
+
+		errors[count++] = error;
+		sx += r->x;
+		sy += r->y;
+		sh += turn;
+		sxx += r->x * r->x;
+		syy += r->y * r->y;
+		shh += turn * turn;
+		se += error;
+		see += error * error;
+		shots += r->shots;
+		shotMin = count == 1 || r->shots < shotMin ? r->shots : shotMin;
+		shotMax = count == 1 || r->shots > shotMax ? r->shots : shotMax;
+	}
+
+	if(count == 0){
+		output("    no randomized run finished the start up menu\n");
+		free(errors);
+		return;
+	}
+
+	qsort(errors, count, sizeof(double), compareDouble);
+	double n = count;
+	output("    runs %d  started %d  finished %d  succeeded %d (%.1f%%)\n", runs, started, finished, succeeded,
+			100.0 * succeeded / runs);
+	output("    x        mean %8.1f  std %7.1f mm\n", sx / n, sqrt(fmax(sxx / n - sx * sx / n / n, 0)));
+	output("    y        mean %8.1f  std %7.1f mm\n", sy / n, sqrt(fmax(syy / n - sy * sy / n / n, 0)));
+	output("    heading  bias %8.1f  std %7.1f deg from nominal\n", sh / n, sqrt(fmax(shh / n - sh * sh / n / n, 0)));
+	output("    error    mean %8.1f  std %7.1f  p5 %.1f  p50 %.1f  p95 %.1f  max %.1f mm\n", se / n,
+			sqrt(fmax(see / n - se * se / n / n, 0)), errors[(int) (0.05 * (count - 1))],
+			errors[(int) (0.5 * (count - 1))], errors[(int) (0.95 * (count - 1))], errors[count - 1]);
+	output("    shots    mean %8.2f  min %d  max %d\n", shots / n, shotMin, shotMax);
+	free(errors);
+}
+
+int main(int argc, char** argv){
+
+	const char* directory = ".";	//directory holding the slot files
+	const char* only = NULL;		//single slot to check
+	int workers = pool_cores();		//runs at once
+	int option;
+
+	while((option = getopt(argc, argv, "d:s:n:j:r:t:b:V:f:p:a:e:h:")) != -1)
+		switch(option){
+		case 'd':
+			directory = optarg;
+			break;
+		case 's':
+			only = optarg;
+			break;
+		case 'n':
+			runs = strtol(optarg, NULL, 10);
+			break;
+		case 'j':
+			workers = strtol(optarg, NULL, 10);
+			break;
+		case 'r':
+			seed = strtoull(optarg, NULL, 10);
+			break;
+		case 't':
+			timeLimit = strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			balls = strtol(optarg, NULL, 10);
+			break;
+		case 'V':
+			voltageSpread = strtod(optarg, NULL);
+			break;
+		case 'f':
+			frictionSpread = strtod(optarg, NULL);
+			break;
+		case 'p':
+			poseSpread = strtod(optarg, NULL);
+			break;
+		case 'a':
+			headingSpread = strtod(optarg, NULL);
+			break;
+		case 'e':
+			positionTolerance = strtod(optarg, NULL);
+			break;
+		case 'h':
+			headingTolerance = strtod(optarg, NULL);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	if(runs < 1 || (only != NULL && !session_isSlot(only)))
+		usage(argv[0]);
+
+	//the slots with a recorded or scripted routine
+	sim_setFileRoot(directory);
+	for(int i = 0; i < SLOTS; i++){
+		char name[512];
+		bool found = false;
+		snprintf(name, sizeof(name), "%s/%s.txt", directory, slotNames[i]);
+		found |= access(name, R_OK) == 0;
+		snprintf(name, sizeof(name), "%s/%s.aut", directory, slotNames[i]);
+		found |= access(name, R_OK) == 0;
+		if(only != NULL ? strcmp(only, slotNames[i]) == 0 : found)
+			slots[slotCount++] = slotNames[i];
+	}
+	if(slotCount == 0){
+		report("montecarlo: no slot files found\n");
+		return 1;
+	}
+
+	//every run of every slot, each nominal run first
+	int jobs = slotCount * (runs + 1);
+	workers = workers < 1 ? 1 : workers > POOL_WORKERS ? POOL_WORKERS : workers > jobs ? jobs : workers;
+	results = calloc(jobs, sizeof(RunResult));
+	pool_run(runAutonomous, jobs, workers, results, sizeof(RunResult));
+
+	output("%d runs per slot on %d workers, seed %llu, battery sd %.2f V, friction +-%.0f%%, pose sd %.0f mm"
+			" %.1f deg, success within %.0f mm %.0f deg\n", runs, workers, seed, voltageSpread, 100 * frictionSpread,
+			poseSpread, headingSpread, positionTolerance, headingTolerance);
+	for(int i = 0; i < slotCount; i++)
+		summarize(i);
+
+	return 0;
+}
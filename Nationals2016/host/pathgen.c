@@ -0,0 +1,218 @@
+/*
+ * @file pathgen.c
+ *
+ * @brief Host tool that turns a list of waypoints into a pure pursuit path
+ *        table for the robot. The waypoints are densified, smoothed and
+ *        given a velocity for every point from the path curvature and an
+ *        acceleration limit, then printed as C source for src/.
+ *
+ *        usage: pathgen <name> <waypoints> [max velocity]
+ *
+ *        The waypoint file holds one "x y" pair in mm per line, x forward
+ *        and y left of the starting tile. Lines starting with '#' are
+ *        ignored.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define SPACING      25.0	//distance in mm between points after densifying
+#define SMOOTH_DATA  0.25	//weight pulling points back to the waypoints
+#define SMOOTH_PATH  0.75	//weight pulling points towards their neighbours
+#define SMOOTH_TOL   0.001	//smoothing stops once a pass moves the path less than this in mm
+#define TURN_K       0.25	//velocity per mm of turn radius
+#define ACCEL        0.4	//largest change in velocity per mm travelled
+#define MIN_VELOCITY 25.0	//slowest velocity scheduled for a curve, anything less stalls the drive
+#define END_VELOCITY 20.0	//velocity kept at the end so the robot reaches the last point
+#define MAX_POINTS   4096	//largest path that can be generated
+
+//path point data structure
+struct{
+	double x;			//distance forward in mm
+	double y;			//distance left in mm
+	double velocity;	//scheduled drive output
+} typedef Point;
+
+static Point raw[MAX_POINTS];	//points read from the waypoint file
+static Point path[MAX_POINTS];	//densified and smoothed path
+
+/*
+ * Read waypoints from a file.
+ *
+ * @param name The waypoint file name.
+ * @return The number of waypoints, or -1 if the file could not be read.
+ */
+static int readWaypoints(const char* name){
+
+	FILE* file = fopen(name, "r");	//waypoint file
+	if(file == NULL)
+		return -1;
+
+	char line[128];	//current line of the file
+	int size = 0;	//number of waypoints read
+
+	//read one waypoint per line
+	while(size < MAX_POINTS && fgets(line, sizeof(line), file) != NULL){
+		if(line[0] == '#')
+			continue;
+		if(sscanf(line, "%lf %lf", &raw[size].x, &raw[size].y) == 2)
+			size++;
+	}
+
+	fclose(file);
+	return size;
+}
+
+/*
+ * Inject points between the waypoints so they are no more than
+ * SPACING apart.
+ *
+ * @param size The number of waypoints.
+ * @return The number of points in the path.
+ */
+static int densify(int size){
+
+	int count = 0;	//number of points in the path
+
+	//fill every segment with evenly spaced points
+	for(int i = 0; i < size - 1; i++){
+		double dx = raw[i + 1].x - raw[i].x;
+		double dy = raw[i + 1].y - raw[i].y;
+		int steps = (int)ceil(hypot(dx, dy) / SPACING);
+
+		for(int j = 0; j < steps && count < MAX_POINTS - 1; j++){
+			path[count].x = raw[i].x + dx * j / steps;
+			path[count].y = raw[i].y + dy * j / steps;
+			count++;
+		}
+	}
+
+	path[count++] = raw[size - 1];
+	return count;
+}
+
+/*
+ * Smooth the path by pulling every inner point towards its
+ * neighbours while keeping it near where it started.
+ *
+ * @param size The number of points in the path.
+ */
+static void smooth(int size){
+
+	static Point start[MAX_POINTS];	//points before smoothing
+	double change = SMOOTH_TOL;		//total movement of the last pass
+
+	for(int i = 0; i < size; i++)
+		start[i] = path[i];
+
+	//repeat until a pass barely moves the path
+	while(change >= SMOOTH_TOL){
+		change = 0;
+		for(int i = 1; i < size - 1; i++){
+			double x = path[i].x;
+			double y = path[i].y;
+			path[i].x += SMOOTH_DATA * (start[i].x - path[i].x) + SMOOTH_PATH * (path[i - 1].x + path[i + 1].x - 2 * path[i].x);
+			path[i].y += SMOOTH_DATA * (start[i].y - path[i].y) + SMOOTH_PATH * (path[i - 1].y + path[i + 1].y - 2 * path[i].y);
+			change += fabs(x - path[i].x) + fabs(y - path[i].y);
+		}
+	}
+}
+
+/*
+ * Retrieve the curvature of the circle through a point and its
+ * neighbours.
+ *
+ * @param i The index of the point.
+ * @param size The number of points in the path.
+ * @return The curvature in 1/mm, zero at the ends and on straight lines.
+ */
+static double curvature(int i, int size){
+
+	//the ends have no circle
+	if(i == 0 || i == size - 1)
+		return 0;
+
+	double a = hypot(path[i].x - path[i - 1].x, path[i].y - path[i - 1].y);
+	double b = hypot(path[i + 1].x - path[i].x, path[i + 1].y - path[i].y);
+	double c = hypot(path[i + 1].x - path[i - 1].x, path[i + 1].y - path[i - 1].y);
+	double cross = (path[i].x - path[i - 1].x) * (path[i + 1].y - path[i - 1].y)
+				 - (path[i].y - path[i - 1].y) * (path[i + 1].x - path[i - 1].x);
+
+	//points are on top of each other
+	if(a * b * c == 0)
+		return 0;
+
+	return 2 * fabs(cross) / (a * b * c);
+}
+
+/*
+ * Schedule a velocity for every point from the curvature, then
+ * limit deceleration by walking back from the end of the path.
+ *
+ * @param size The number of points in the path.
+ * @param maxVelocity The largest drive output.
+ */
+static void schedule(int size, double maxVelocity){
+
+	//slow down for tight curves
+	for(int i = 0; i < size; i++){
+		double k = curvature(i, size);
+		path[i].velocity = k == 0 ? maxVelocity : fmax(MIN_VELOCITY, fmin(maxVelocity, TURN_K / k));
+	}
+
+	//brake in time for slow points further along the path
+	path[size - 1].velocity = END_VELOCITY;
+	for(int i = size - 2; i >= 0; i--){
+		double d = hypot(path[i + 1].x - path[i].x, path[i + 1].y - path[i].y);
+		path[i].velocity = fmin(path[i].velocity, path[i + 1].velocity + ACCEL * d);
+	}
+}
+
+int main(int argc, char** argv){
+
+	//wrong usage
+	if(argc < 3){
+		fprintf(stderr, "usage: %s <name> <waypoints> [max velocity]\n", argv[0]);
+		return 1;
+	}
+
+	double maxVelocity = argc > 3 ? atof(argv[3]) : 127;	//largest drive output
+	int size = readWaypoints(argv[2]);						//number of waypoints
+
+	//not enough waypoints for a path
+	if(size < 2){
+		fprintf(stderr, "%s: need at least two waypoints\n", argv[2]);
+		return 1;
+	}
+
+	size = densify(size);
+	smooth(size);
+	schedule(size, maxVelocity);
+
+	//print the path as C source
+	printf("/* generated by host/pathgen from %s, do not edit */\n\n", argv[2]);
+	printf("#include <pursuit.h>\n\n");
+	printf("static const PathPoint %sPoints[] = {\n", argv[1]);
+	for(int i = 0; i < size; i++)
+		printf("\t{%d, %d, %d},\n", (int)lround(path[i].x), (int)lround(path[i].y), (int)lround(path[i].velocity));
+	printf("};\n\n");
+	printf("const Path %s = {%sPoints, %d};\n", argv[1], argv[1], size);
+
+	return 0;
+}
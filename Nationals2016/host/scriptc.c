@@ -0,0 +1,283 @@
+/*
+ * @file scriptc.c
+ *
+ * @brief Host compiler for autonomous scripts. Turns a text routine into the
+ *        bytecode run by src/script.c.
+ *
+ *        usage: scriptc <script> <output.aut>
+ *               scriptc -c <name> <script>
+ *
+ *        The first form writes a file to upload to the robot's flash file
+ *        system (sk.aut, r1.aut, r2.aut, b1.aut or b2.aut). The second
+ *        prints the bytecode as a C array so it can be built into the
+ *        program instead.
+ *
+ *        One command per line, '#' starts a comment:
+ *
+ *          drive <mm> <velocity>          drive straight for a distance
+ *          turn <degrees>                 turn in place to an absolute heading
+ *          lift <position>                move the lift and wait for it
+ *          intake <velocity>              set the intake
+ *          pto <velocity>                 set the PTO
+ *          wait <ms>                      pause
+ *          until <sensor> <op> <value>    wait for a sensor, op is <, > or =
+ *          output <pin> <value>           set a digital output
+ *          parallel ... and ... end       run the blocks side by side
+ *
+ *        Sensors are wheelEncoder, puncherEncoder, wheelDetector,
+ *        puncherDetector, lift, leftDrive, rightDrive and gyro.
+ *
+ *        A script must fit in SCRIPT_SIZE bytes and run no more than
+ *        SCRIPT_THREADS branches at once, nested parallel blocks included,
+ *        or the robot will not load it.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "../include/scriptops.h"
+
+#define MAX_CODE     SCRIPT_SIZE			//largest block of bytecode, the most the robot loads
+#define MAX_BRANCHES (SCRIPT_THREADS - 1)	//most branches in one parallel block, the main branch takes a thread
+
+//bytecode buffer data structure
+struct{
+	unsigned char bytes[MAX_CODE];	//bytecode
+	int size;						//number of bytes used
+	int threads;					//most branches the block runs at once, its own included
+} typedef Buffer;
+
+static FILE* source;			//script being compiled
+static const char* sourceName;	//name of the script
+static int lineNumber = 0;		//line being compiled
+
+//sensor names in SENSOR_ order
+static const char* sensorNames[SENSOR_COUNT] = {
+	"wheelEncoder", "puncherEncoder", "wheelDetector", "puncherDetector",
+	"lift", "leftDrive", "rightDrive", "gyro"
+};
+
+/*
+ * Print an error for the current line and stop.
+ *
+ * @param message The error message.
+ */
+static void fail(const char* message){
+	fprintf(stderr, "%s:%d: %s\n", sourceName, lineNumber, message);
+	exit(1);
+}
+
+/*
+ * Add a byte to a buffer.
+ *
+ * @param out The buffer being written.
+ * @param value The byte.
+ */
+static void emit8(Buffer* out, int value){
+	if(out->size >= MAX_CODE)
+		fail("script too large");
+	out->bytes[out->size++] = (unsigned char)value;
+}
+
+/*
+ * Add a 16 bit little endian value to a buffer.
+ *
+ * @param out The buffer being written.
+ * @param value The value.
+ */
+static void emit16(Buffer* out, int value){
+	if(value < -32768 || value > 32767)
+		fail("value out of range");
+	emit8(out, value & 0xFF);
+	emit8(out, (value >> 8) & 0xFF);
+}
+
+/*
+ * Compile lines into a buffer until the end of the file or a
+ * line that closes the block. Branches of nested parallel blocks
+ * all hold a thread on the robot, so the branches running at once
+ * are counted across the nesting.
+ *
+ * @param out The buffer being written.
+ * @param held The threads held by the blocks this one is nested in.
+ * @return The word that closed the block, "" at the end of the file.
+ */
+static const char* compileBlock(Buffer* out, int held){
+
+	static char line[256];	//current line
+	char word[32];			//command
+	char name[32];			//sensor name or comparison
+	char cmp[8];			//comparison
+	int a, b;				//numeric arguments
+
+	out->threads = 1;
+
+	while(fgets(line, sizeof(line), source) != NULL){
+		lineNumber++;
+
+		//drop comments and blank lines
+		char* comment = strchr(line, '#');
+		if(comment != NULL)
+			*comment = '\0';
+		if(sscanf(line, "%31s", word) != 1)
+			continue;
+
+		//block terminators are handled by the parallel block
+		if(strcmp(word, "and") == 0)
+			return "and";
+		else if(strcmp(word, "end") == 0)
+			return "end";
+
+		else if(strcmp(word, "drive") == 0){
+			if(sscanf(line, "%*s %d %d", &a, &b) != 2)
+				fail("usage: drive <mm> <velocity>");
+			emit8(out, OP_DRIVE);
+			emit16(out, a);
+			emit16(out, b);
+		}
+
+		else if(strcmp(word, "turn") == 0 || strcmp(word, "lift") == 0 || strcmp(word, "intake") == 0
+				|| strcmp(word, "pto") == 0 || strcmp(word, "wait") == 0){
+			if(sscanf(line, "%*s %d", &a) != 1)
+				fail("missing value");
+			emit8(out, word[0] == 't' ? OP_TURN : word[0] == 'l' ? OP_LIFT : word[0] == 'i' ? OP_INTAKE : word[0] == 'p' ? OP_PTO : OP_WAIT);
+			emit16(out, a);
+		}
+
+		else if(strcmp(word, "until") == 0){
+			if(sscanf(line, "%*s %31s %7s %d", name, cmp, &a) != 3)
+				fail("usage: until <sensor> <op> <value>");
+			int sensor = 0;
+			while(sensor < SENSOR_COUNT && strcmp(sensorNames[sensor], name) != 0)
+				sensor++;
+			if(sensor == SENSOR_COUNT)
+				fail("unknown sensor");
+			emit8(out, OP_UNTIL);
+			emit8(out, sensor);
+			if(strcmp(cmp, "<") == 0)
+				emit8(out, CMP_LESS);
+			else if(strcmp(cmp, ">") == 0)
+				emit8(out, CMP_GREATER);
+			else if(strcmp(cmp, "=") == 0)
+				emit8(out, CMP_EQUAL);
+			else
+				fail("comparison must be <, > or =");
+			emit16(out, a);
+		}
+
+		else if(strcmp(word, "output") == 0){
+			if(sscanf(line, "%*s %d %d", &a, &b) != 2 || a < 1 || a > 12)
+				fail("usage: output <pin 1-12> <value>");
+			emit8(out, OP_OUTPUT);
+			emit8(out, a);
+			emit8(out, b != 0);
+		}
+
+		//compile each branch on its own, then lay them out after the lengths
+		else if(strcmp(word, "parallel") == 0){
+			Buffer* branches = malloc(sizeof(Buffer) * MAX_BRANCHES);	//nested blocks need their own buffers
+			int count = 0;
+			const char* close;
+
+			do{
+				if(count == MAX_BRANCHES)
+					fail("too many branches");
+				branches[count].size = 0;
+				close = compileBlock(&branches[count], held + 1);
+				emit8(&branches[count], OP_END);
+				count++;
+			}while(strcmp(close, "and") == 0);
+
+			if(strcmp(close, "end") != 0)
+				fail("parallel without end");
+
+			//this block's thread and every branch of the parallel block run at once
+			int threads = 1;
+			for(int i = 0; i < count; i++)
+				threads += branches[i].threads;
+			if(held + threads > SCRIPT_THREADS)
+				fail("too many branches running at once");
+			if(threads > out->threads)
+				out->threads = threads;
+
+			emit8(out, OP_PARALLEL);
+			emit8(out, count);
+			for(int i = 0; i < count; i++)
+				emit16(out, branches[i].size);
+			for(int i = 0; i < count; i++)
+				for(int j = 0; j < branches[i].size; j++)
+					emit8(out, branches[i].bytes[j]);
+			free(branches);
+		}
+
+		else
+			fail("unknown command");
+	}
+
+	return "";
+}
+
+int main(int argc, char** argv){
+
+	bool asArray = argc == 4 && strcmp(argv[1], "-c") == 0;	//print a C array instead of a file
+
+	//wrong usage
+	if(argc != 3 && !asArray){
+		fprintf(stderr, "usage: %s <script> <output.aut>\n       %s -c <name> <script>\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	sourceName = asArray ? argv[3] : argv[1];
+	source = fopen(sourceName, "r");
+	if(source == NULL){
+		perror(sourceName);
+		return 1;
+	}
+
+	static Buffer out;	//compiled script
+	emit8(&out, SCRIPT_MAGIC0);
+	emit8(&out, SCRIPT_MAGIC1);
+	emit8(&out, SCRIPT_VERSION);
+	if(strcmp(compileBlock(&out, 0), "") != 0)
+		fail("and/end outside of a parallel block");
+	emit8(&out, OP_END);
+	fclose(source);
+
+	//print as C source
+	if(asArray){
+		printf("/* generated by host/scriptc from %s, do not edit */\n\n", sourceName);
+		printf("const unsigned char %s[%d] = {", argv[2], out.size);
+		for(int i = 0; i < out.size; i++)
+			printf("%s0x%02X,", i % 12 == 0 ? "\n\t" : " ", out.bytes[i]);
+		printf("\n};\n");
+	}
+
+	//write the file to upload
+	else{
+		FILE* file = fopen(argv[2], "wb");
+		if(file == NULL || fwrite(out.bytes, 1, out.size, file) != (size_t)out.size){
+			perror(argv[2]);
+			return 1;
+		}
+		fclose(file);
+		printf("%s: %d bytes\n", argv[2], out.size);
+	}
+
+	return 0;
+}
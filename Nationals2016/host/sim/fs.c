@@ -0,0 +1,383 @@
+/*
+ * @file fs.c
+ *
+ * @brief Simulated file system, serial ports and standard I/O calls of the
+ *        PROS API. Files live in a directory on the host and are buffered
+ *        whole in memory while open, the way the Cortex keeps them in flash.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim.h"
+
+int vsnprintf(char* buffer, size_t limit, const char* formatString, va_list args);	//from the C library, <stdio.h> clashes with API.h
+
+#define FILE_HANDLES 8		//most files open at once
+#define FILE_FIRST   4		//first handle number, 1 to 3 are the serial ports
+#define FILE_SIZE    65536	//largest file, the Cortex has far less flash than this
+#define PATH_SIZE    256	//longest host path to a file
+
+//open file data structure
+struct{
+	bool open;				//flag for a handle in use
+	bool writing;			//opened with "w" or "a"
+	char path[PATH_SIZE];	//host path of the file
+	unsigned char* data;	//contents of the file
+	int size;				//bytes in the file
+	int position;			//next byte to read or write
+} typedef SimFile;
+
+static SimFile files[FILE_HANDLES];
+static char root[PATH_SIZE] = ".";	//directory standing in for flash
+static int uartFd[3] = {-1, -1, 1};	//host descriptors of uart1, uart2 and stdout
+
+/*
+ * Retrieve the open file behind a handle.
+ *
+ * @param stream The handle from fopen().
+ * @return The file, or NULL if the handle is not an open file.
+ */
+static SimFile* fileFor(FILE* stream){
+	intptr_t index = (intptr_t)stream - FILE_FIRST;
+	if(index < 0 || index >= FILE_HANDLES || !files[index].open)
+		return NULL;
+	return &files[index];
+}
+
+/*
+ * Retrieve the host descriptor behind a serial port.
+ *
+ * @param stream uart1, uart2 or stdout.
+ * @return The descriptor, or -1 if the stream is not a port or is dropped.
+ */
+static int portFd(FILE* stream){
+	intptr_t port = (intptr_t)stream;
+	return port >= 1 && port <= 3 ? uartFd[port - 1] : -1;
+}
+
+/*
+ * Write a whole buffer to a host descriptor.
+ *
+ * @param fd The descriptor.
+ * @param buffer The bytes to write.
+ * @param size The number of bytes.
+ * @return If every byte was written.
+ */
+static bool writeAll(int fd, const void* buffer, size_t size){
+	const char* bytes = buffer;
+	while(size > 0){
+		ssize_t n = write(fd, bytes, size);
+		if(n <= 0)
+			return false;
+		bytes += n;
+		size -= n;
+	}
+	return true;
+}
+
+void sim_setFileRoot(const char* directory){
+	strncpy(root, directory, PATH_SIZE - 1);
+}
+
+void sim_setUart(FILE* port, int fd){
+	intptr_t index = (intptr_t)port;
+	if(index >= 1 && index <= 3)
+		uartFd[index - 1] = fd;
+}
+
+// ---------------------------------- Serial ports ---------------------------------------------
+
+void usartInit(FILE *usart, unsigned int baud, unsigned int flags){
+}
+
+void usartShutdown(FILE *usart){
+}
+
+// -------------------------------------- Files ------------------------------------------------
+
+FILE * fopen(const char *file, const char *mode){
+
+	//find a free handle
+	int index = 0;
+	while(index < FILE_HANDLES && files[index].open)
+		index++;
+	if(index == FILE_HANDLES || file == NULL || mode == NULL)
+		return NULL;
+
+	SimFile* f = &files[index];
+	f->writing = mode[0] == 'w' || mode[0] == 'a';
+	f->size = 0;
+	f->position = 0;
+	f->data = malloc(FILE_SIZE);
+	if(f->data == NULL)
+		return NULL;
+	if(strlen(root) + strlen(file) + 2 > PATH_SIZE){
+		free(f->data);
+		return NULL;
+	}
+	strcpy(f->path, root);
+	strcat(f->path, "/");
+	strcat(f->path, file);
+
+	//load what is already saved, reads of a missing file fail
+	if(!f->writing || mode[0] == 'a'){
+		int fd = open(f->path, O_RDONLY);
+		if(fd < 0 && !f->writing){
+			free(f->data);
+			return NULL;
+		}
+		if(fd >= 0){
+			ssize_t n;
+			while(f->size < FILE_SIZE && (n = read(fd, f->data + f->size, FILE_SIZE - f->size)) > 0)
+				f->size += n;
+			close(fd);
+		}
+		if(mode[0] == 'a')
+			f->position = f->size;
+	}
+
+	f->open = true;
+	return (FILE*)(intptr_t)(index + FILE_FIRST);
+}
+
+int fflush(FILE *stream){
+
+	SimFile* f = fileFor(stream);	//file being flushed
+
+	//ports are unbuffered
+	if(f == NULL || !f->writing)
+		return 0;
+
+	int fd = open(f->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+		return EOF;
+	bool ok = writeAll(fd, f->data, f->size);
+	close(fd);
+	return ok ? 0 : EOF;
+}
+
+void fclose(FILE *stream){
+
+	SimFile* f = fileFor(stream);	//file being closed
+	if(f == NULL)
+		return;
+
+	fflush(stream);
+	free(f->data);
+	f->data = NULL;
+	f->open = false;
+}
+
+int fcount(FILE *stream){
+	SimFile* f = fileFor(stream);
+	return f == NULL || f->writing ? 0 : f->size - f->position;
+}
+
+int fdelete(const char *file){
+	char path[PATH_SIZE];
+	if(strlen(root) + strlen(file) + 2 > PATH_SIZE)
+		return 1;
+	strcpy(path, root);
+	strcat(path, "/");
+	strcat(path, file);
+	return unlink(path) == 0 ? 0 : 1;
+}
+
+int feof(FILE *stream){
+	SimFile* f = fileFor(stream);
+	return f == NULL || f->position >= f->size;
+}
+
+int fseek(FILE *stream, long int offset, int origin){
+
+	SimFile* f = fileFor(stream);	//file being moved in
+	if(f == NULL || f->writing)
+		return EOF;
+
+	long int position = origin == SEEK_SET ? offset : origin == SEEK_CUR ? f->position + offset : f->size + offset;
+	if(position < 0 || position > f->size)
+		return EOF;
+
+	f->position = position;
+	return 0;
+}
+
+long int ftell(FILE *stream){
+	SimFile* f = fileFor(stream);
+	return f == NULL ? -1 : f->position;
+}
+
+// ------------------------------- Character input and output ----------------------------------
+
+int fgetc(FILE *stream){
+	sim_call(__func__);
+
+	SimFile* f = fileFor(stream);	//file being read
+
+	//read from a port
+	if(f == NULL){
+		unsigned char c;
+		int fd = (intptr_t)stream == 3 ? 0 : -1;	//only the debug terminal has an input
+		return fd >= 0 && read(fd, &c, 1) == 1 ? c : EOF;
+	}
+
+	if(f->writing || f->position >= f->size)
+		return EOF;
+	return f->data[f->position++];
+}
+
+int fputc(int value, FILE *stream){
+	sim_call(__func__);
+
+	unsigned char c = value;		//byte being written
+	SimFile* f = fileFor(stream);	//file being written
+
+	//write to a port
+	if(f == NULL){
+		int fd = portFd(stream);
+		if(fd >= 0 && !writeAll(fd, &c, 1))
+			return EOF;
+		return c;
+	}
+
+	if(!f->writing || f->position >= FILE_SIZE)
+		return EOF;
+	f->data[f->position++] = c;
+	if(f->position > f->size)
+		f->size = f->position;
+	return c;
+}
+
+size_t fread(void *ptr, size_t size, size_t count, FILE *stream){
+	unsigned char* bytes = ptr;
+	size_t n = 0;
+	for(; n < size * count; n++){
+		int c = fgetc(stream);
+		if(c == EOF)
+			break;
+		bytes[n] = c;
+	}
+	return size == 0 ? 0 : n / size;
+}
+
+size_t fwrite(const void *ptr, size_t size, size_t count, FILE *stream){
+	sim_call(__func__);
+
+	SimFile* f = fileFor(stream);	//file being written
+
+	//write to a port in one piece
+	if(f == NULL){
+		int fd = portFd(stream);
+		if(fd >= 0 && !writeAll(fd, ptr, size * count))
+			return 0;
+		return count;
+	}
+
+	const unsigned char* bytes = ptr;
+	size_t n = 0;
+	for(; n < size * count; n++)
+		if(fputc(bytes[n], stream) == EOF)
+			break;
+	return size == 0 ? 0 : n / size;
+}
+
+char* fgets(char *str, int num, FILE *stream){
+	int n = 0;
+	while(n < num - 1){
+		int c = fgetc(stream);
+		if(c == EOF)
+			break;
+		str[n++] = c;
+		if(c == '\n')
+			break;
+	}
+	if(n == 0)
+		return NULL;
+	str[n] = '\0';
+	return str;
+}
+
+int fputs(const char *string, FILE *stream){
+	size_t length = strlen(string);
+	return fwrite(string, 1, length, stream) == length ? (int)length : EOF;
+}
+
+void fprint(const char *string, FILE *stream){
+	fputs(string, stream);
+}
+
+int getchar(){
+	return fgetc(stdin);
+}
+
+int putchar(int value){
+	return fputc(value, stdout);
+}
+
+void print(const char *string){
+	fputs(string, stdout);
+}
+
+int puts(const char *string){
+	if(fputs(string, stdout) == EOF)
+		return EOF;
+	return fputc('\n', stdout) == EOF ? EOF : 1;
+}
+
+// ----------------------------------- Formatted output ----------------------------------------
+
+int fprintf(FILE *stream, const char *formatString, ...){
+	char buffer[256];	//formatted text, the Cortex limits it far more
+	va_list args;
+	va_start(args, formatString);
+	int length = vsnprintf(buffer, sizeof(buffer), formatString, args);
+	va_end(args);
+	if(length >= (int)sizeof(buffer))
+		length = sizeof(buffer) - 1;
+	return length < 0 ? length : (int)fwrite(buffer, 1, length, stream);
+}
+
+int printf(const char *formatString, ...){
+	char buffer[256];	//formatted text
+	va_list args;
+	va_start(args, formatString);
+	int length = vsnprintf(buffer, sizeof(buffer), formatString, args);
+	va_end(args);
+	if(length >= (int)sizeof(buffer))
+		length = sizeof(buffer) - 1;
+	return length < 0 ? length : (int)fwrite(buffer, 1, length, stdout);
+}
+
+int snprintf(char *buffer, size_t limit, const char *formatString, ...){
+	va_list args;
+	va_start(args, formatString);
+	int length = vsnprintf(buffer, limit, formatString, args);
+	va_end(args);
+	return length;
+}
+
+int sprintf(char *buffer, const char *formatString, ...){
+	va_list args;
+	va_start(args, formatString);
+	int length = vsnprintf(buffer, 4096, formatString, args);
+	va_end(args);
+	return length;
+}
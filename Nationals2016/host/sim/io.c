@@ -0,0 +1,550 @@
+/*
+ * @file io.c
+ *
+ * @brief Simulated competition, joystick, motor, sensor and LCD calls of the
+ *        PROS API.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include "sim.h"
+
+int vsnprintf(char* buffer, size_t limit, const char* formatString, va_list args);	//from the C library, <stdio.h> clashes with API.h
+
+#define LCD_QUEUE 64	//most LCD presses that can be queued
+
+//encoder data structure
+struct{
+	unsigned char top;		//top port, zero when free
+	unsigned char bottom;	//bottom port
+	bool reverse;			//flag for counting backwards
+	int zero;				//raw count at the last reset
+} typedef SimEncoder;
+
+//gyro data structure
+struct{
+	unsigned char port;	//analog port, zero when free
+	int zero;			//raw angle at the last reset
+} typedef SimGyro;
+
+//ultrasonic data structure
+struct{
+	unsigned char echo;	//echo port, zero when free
+	unsigned char ping;	//ping port
+} typedef SimUltrasonic;
+
+//queued lcd press
+struct{
+	unsigned int buttons;	//buttons held
+	int reads;				//reads the buttons stay held for
+} typedef LcdPress;
+
+//field control
+static volatile bool enabled = true;
+static volatile bool autonomous = false;
+static volatile unsigned int batteryMain = 8000;
+static volatile unsigned int batteryBackup = 9000;
+
+//joystick
+static volatile int joyAnalog[2][7];				//axes by joystick then axis
+static volatile unsigned char joyDigital[2][9];		//buttons pressed by joystick then group
+
+//ports, index 0 is unused so port numbers can be used directly
+static volatile int motors[SIM_MOTORS + 1];
+static volatile unsigned char pinModes[SIM_DIGITAL + 1];
+static volatile bool digital[SIM_DIGITAL + 1];
+static volatile int analog[SIM_ANALOG + 1];
+static volatile int encoderCounts[SIM_DIGITAL + 1];		//raw counts by top port
+static volatile int gyroAngles[SIM_ANALOG + 1];			//raw angles by port
+static volatile int ultrasonicCm[SIM_DIGITAL + 1];		//distances by echo port
+static volatile int imeCounts[SIM_IMES];
+static int imeZero[SIM_IMES];
+static InterruptHandler interrupts[SIM_DIGITAL + 1];
+
+static SimEncoder encoders[SIM_DIGITAL / 2];
+static SimGyro gyros[SIM_ANALOG];
+static SimUltrasonic ultrasonics[SIM_DIGITAL / 2];
+
+//lcd
+static char lcdText[2][2][17];		//text by port then line
+static bool lcdBacklight[2];		//backlight by port
+static LcdPress lcdQueue[LCD_QUEUE];	//queued presses
+static volatile int lcdHead = 0;	//next press to read
+static volatile int lcdTail = 0;	//next free queue slot
+static volatile int lcdReads = 0;	//reads of the current press so far
+static bool lcdEcho = false;		//flag for printing lcd changes
+
+// ----------------------------------- Competition ---------------------------------------------
+
+void sim_setCompetition(bool isEnabled, bool isAutonomous){
+	enabled = isEnabled;
+	autonomous = isAutonomous;
+}
+
+void sim_setBattery(unsigned int main, unsigned int backup){
+	batteryMain = main;
+	batteryBackup = backup;
+}
+
+bool isAutonomous(){
+	sim_call(__func__);
+	return autonomous;
+}
+
+bool isEnabled(){
+	sim_call(__func__);
+	return enabled;
+}
+
+bool isJoystickConnected(unsigned char joystick){
+	return joystick == 1 || joystick == 2;
+}
+
+bool isOnline(){
+	return false;
+}
+
+unsigned int powerLevelBackup(){
+	sim_call(__func__);
+	return batteryBackup;
+}
+
+unsigned int powerLevelMain(){
+	sim_call(__func__);
+	return batteryMain;
+}
+
+void setTeamName(const char *name){
+}
+
+// ------------------------------------ Joystick -----------------------------------------------
+
+void sim_setJoystickAnalog(unsigned char joystick, unsigned char axis, int value){
+	if(joystick >= 1 && joystick <= 2 && axis >= 1 && axis <= 6)
+		joyAnalog[joystick - 1][axis] = value < -127 ? -127 : value > 127 ? 127 : value;
+}
+
+void sim_setJoystickDigital(unsigned char joystick, unsigned char group, unsigned char button, bool pressed){
+	if(joystick < 1 || joystick > 2 || group < 5 || group > 8)
+		return;
+	if(pressed)
+		joyDigital[joystick - 1][group] |= button;
+	else
+		joyDigital[joystick - 1][group] &= ~button;
+}
+
+void sim_clearJoystick(){
+	memset((void*)joyAnalog, 0, sizeof(joyAnalog));
+	memset((void*)joyDigital, 0, sizeof(joyDigital));
+}
+
+int joystickGetAnalog(unsigned char joystick, unsigned char axis){
+	sim_call(__func__);
+	if(joystick < 1 || joystick > 2 || axis < 1 || axis > 6)
+		return 0;
+	return joyAnalog[joystick - 1][axis];
+}
+
+bool joystickGetDigital(unsigned char joystick, unsigned char buttonGroup, unsigned char button){
+	sim_call(__func__);
+	if(joystick < 1 || joystick > 2 || buttonGroup < 5 || buttonGroup > 8)
+		return false;
+	return (joyDigital[joystick - 1][buttonGroup] & button) != 0;
+}
+
+// ------------------------------------- Motors ------------------------------------------------
+
+int sim_getMotor(unsigned char channel){
+	return channel >= 1 && channel <= SIM_MOTORS ? motors[channel] : 0;
+}
+
+int motorGet(unsigned char channel){
+	sim_call(__func__);
+	return sim_getMotor(channel);
+}
+
+void motorSet(unsigned char channel, int speed){
+	sim_call(__func__);
+	if(channel >= 1 && channel <= SIM_MOTORS)
+		motors[channel] = speed < -127 ? -127 : speed > 127 ? 127 : speed;
+}
+
+void motorStop(unsigned char channel){
+	motorSet(channel, 0);
+}
+
+void motorStopAll(){
+	for(int i = 1; i <= SIM_MOTORS; i++)
+		motors[i] = 0;
+}
+
+// ----------------------------------- Digital IO ----------------------------------------------
+
+unsigned char sim_getPinMode(unsigned char pin){
+	return pin >= 1 && pin <= SIM_DIGITAL ? pinModes[pin] : INPUT;
+}
+
+bool sim_getDigital(unsigned char pin){
+	return pin >= 1 && pin <= SIM_DIGITAL && digital[pin];
+}
+
+void sim_setDigital(unsigned char pin, bool value){
+
+	//no such pin
+	if(pin < 1 || pin > SIM_DIGITAL)
+		return;
+
+	bool old = digital[pin];
+	digital[pin] = value;
+
+	//run the interrupt handler like the pin change ISR would
+	if(old != value && interrupts[pin] != NULL)
+		interrupts[pin](pin);
+}
+
+bool digitalRead(unsigned char pin){
+	sim_call(__func__);
+	return sim_getDigital(pin);
+}
+
+void digitalWrite(unsigned char pin, bool value){
+	sim_call(__func__);
+
+	//only outputs can be driven by the robot
+	if(pin >= 1 && pin <= SIM_DIGITAL && (pinModes[pin] == OUTPUT || pinModes[pin] == OUTPUT_OD))
+		digital[pin] = value;
+}
+
+void pinMode(unsigned char pin, unsigned char mode){
+	if(pin >= 1 && pin <= SIM_DIGITAL)
+		pinModes[pin] = mode;
+}
+
+void ioClearInterrupt(unsigned char pin){
+	if(pin >= 1 && pin <= SIM_DIGITAL)
+		interrupts[pin] = NULL;
+}
+
+void ioSetInterrupt(unsigned char pin, unsigned char edges, InterruptHandler handler){
+	if(pin >= 1 && pin <= SIM_DIGITAL)
+		interrupts[pin] = handler;
+}
+
+// ----------------------------------- Analog IO -----------------------------------------------
+
+void sim_setAnalog(unsigned char channel, int value){
+	if(channel >= 1 && channel <= SIM_ANALOG)
+		analog[channel] = value < 0 ? 0 : value > 4095 ? 4095 : value;
+}
+
+int analogRead(unsigned char channel){
+	sim_call(__func__);
+	return channel >= 1 && channel <= SIM_ANALOG ? analog[channel] : 0;
+}
+
+int analogCalibrate(unsigned char channel){
+	return analogRead(channel);
+}
+
+int analogReadCalibrated(unsigned char channel){
+	return analogRead(channel);
+}
+
+int analogReadCalibratedHR(unsigned char channel){
+	return analogRead(channel) * 16;
+}
+
+// ------------------------------------- Speaker -----------------------------------------------
+
+void speakerInit(){
+}
+
+void speakerPlayArray(const char * * songs){
+}
+
+void speakerPlayRtttl(const char *song){
+}
+
+void speakerShutdown(){
+}
+
+// ------------------------------------ Encoders -----------------------------------------------
+
+void sim_setEncoder(unsigned char portTop, int count){
+	if(portTop >= 1 && portTop <= SIM_DIGITAL)
+		encoderCounts[portTop] = count;
+}
+
+Encoder encoderInit(unsigned char portTop, unsigned char portBottom, bool reverse){
+
+	//reuse the encoder already on the port or take a free one
+	for(int i = 0; i < SIM_DIGITAL / 2; i++)
+		if(encoders[i].top == portTop || encoders[i].top == 0){
+			encoders[i].top = portTop;
+			encoders[i].bottom = portBottom;
+			encoders[i].reverse = reverse;
+			encoders[i].zero = encoderCounts[portTop];
+			pinMode(portTop, INPUT);
+			pinMode(portBottom, INPUT);
+			return &encoders[i];
+		}
+
+	return NULL;
+}
+
+int encoderGet(Encoder enc){
+	sim_call(__func__);
+	SimEncoder* e = enc;
+	if(e == NULL)
+		return 0;
+	int count = encoderCounts[e->top] - e->zero;
+	return e->reverse ? -count : count;
+}
+
+void encoderReset(Encoder enc){
+	SimEncoder* e = enc;
+	if(e != NULL)
+		e->zero = encoderCounts[e->top];
+}
+
+void encoderShutdown(Encoder enc){
+	SimEncoder* e = enc;
+	if(e != NULL)
+		e->top = 0;
+}
+
+// -------------------------------------- Gyros ------------------------------------------------
+
+void sim_setGyro(unsigned char port, int degrees){
+	if(port >= 1 && port <= SIM_ANALOG)
+		gyroAngles[port] = degrees;
+}
+
+Gyro gyroInit(unsigned char port, unsigned short multiplier){
+
+	//reuse the gyro already on the port or take a free one
+	for(int i = 0; i < SIM_ANALOG; i++)
+		if(gyros[i].port == port || gyros[i].port == 0){
+			gyros[i].port = port;
+			gyros[i].zero = gyroAngles[port];
+			return &gyros[i];
+		}
+
+	return NULL;
+}
+
+int gyroGet(Gyro gyro){
+	sim_call(__func__);
+	SimGyro* g = gyro;
+	return g == NULL ? 0 : gyroAngles[g->port] - g->zero;
+}
+
+void gyroReset(Gyro gyro){
+	SimGyro* g = gyro;
+	if(g != NULL)
+		g->zero = gyroAngles[g->port];
+}
+
+void gyroShutdown(Gyro gyro){
+	SimGyro* g = gyro;
+	if(g != NULL)
+		g->port = 0;
+}
+
+// ----------------------------------- Ultrasonics ---------------------------------------------
+
+void sim_setUltrasonic(unsigned char portEcho, int cm){
+	if(portEcho >= 1 && portEcho <= SIM_DIGITAL)
+		ultrasonicCm[portEcho] = cm;
+}
+
+Ultrasonic ultrasonicInit(unsigned char portEcho, unsigned char portPing){
+
+	//reuse the ultrasonic already on the port or take a free one
+	for(int i = 0; i < SIM_DIGITAL / 2; i++)
+		if(ultrasonics[i].echo == portEcho || ultrasonics[i].echo == 0){
+			ultrasonics[i].echo = portEcho;
+			ultrasonics[i].ping = portPing;
+			pinMode(portEcho, INPUT);
+			pinMode(portPing, OUTPUT);
+			return &ultrasonics[i];
+		}
+
+	return NULL;
+}
+
+int ultrasonicGet(Ultrasonic ult){
+	sim_call(__func__);
+	SimUltrasonic* u = ult;
+	return u == NULL ? 0 : ultrasonicCm[u->echo];
+}
+
+void ultrasonicShutdown(Ultrasonic ult){
+	SimUltrasonic* u = ult;
+	if(u != NULL)
+		u->echo = 0;
+}
+
+// -------------------------------- Integrated encoders ----------------------------------------
+
+void sim_setIme(unsigned char address, int count){
+	if(address < SIM_IMES)
+		imeCounts[address] = count;
+}
+
+unsigned int imeInitializeAll(){
+	return SIM_IMES;
+}
+
+bool imeGet(unsigned char address, int *value){
+	sim_call(__func__);
+	if(address >= SIM_IMES)
+		return false;
+	*value = imeCounts[address] - imeZero[address];
+	return true;
+}
+
+bool imeGetVelocity(unsigned char address, int *value){
+	if(address >= SIM_IMES)
+		return false;
+	*value = 0;
+	return true;
+}
+
+bool imeReset(unsigned char address){
+	if(address >= SIM_IMES)
+		return false;
+	imeZero[address] = imeCounts[address];
+	return true;
+}
+
+void imeShutdown(){
+}
+
+// --------------------------------------- LCD -------------------------------------------------
+
+/*
+ * Retrieve the index of an LCD port.
+ *
+ * @param port uart1 or uart2.
+ * @return 0 or 1, or -1 for any other stream.
+ */
+static int lcdIndex(FILE* port){
+	return port == uart1 ? 0 : port == uart2 ? 1 : -1;
+}
+
+void sim_pressLcd(unsigned int buttons, int reads){
+
+	//queue is full
+	if((lcdTail + 1) % LCD_QUEUE == lcdHead)
+		return;
+
+	lcdQueue[lcdTail].buttons = buttons;
+	lcdQueue[lcdTail].reads = reads;
+	lcdTail = (lcdTail + 1) % LCD_QUEUE;
+}
+
+bool sim_lcdIdle(){
+	return lcdHead == lcdTail;
+}
+
+const char* sim_getLcdLine(FILE* port, unsigned char line){
+	int index = lcdIndex(port);
+	return index < 0 || line < 1 || line > 2 ? "" : lcdText[index][line - 1];
+}
+
+void sim_echoLcd(bool echo){
+	lcdEcho = echo;
+}
+
+void lcdInit(FILE *lcdPort){
+}
+
+void lcdShutdown(FILE *lcdPort){
+}
+
+void lcdClear(FILE *lcdPort){
+	lcdSetText(lcdPort, 1, "");
+	lcdSetText(lcdPort, 2, "");
+}
+
+void lcdSetText(FILE *lcdPort, unsigned char line, const char *buffer){
+	sim_call(__func__);
+
+	int index = lcdIndex(lcdPort);	//port being written
+	if(index < 0 || line < 1 || line > 2)
+		return;
+
+	char text[17];	//new line, padded like the 16 character display
+	int i = 0;
+	for(; i < 16 && buffer[i] != '\0'; i++)
+		text[i] = buffer[i];
+	for(; i < 16; i++)
+		text[i] = ' ';
+	text[16] = '\0';
+
+	//print lines that changed
+	if(lcdEcho && strcmp(text, lcdText[index][line - 1]) != 0){
+		char echo[32];
+		int size = 0;
+		echo[size++] = '0' + line;
+		echo[size++] = '|';
+		memcpy(&echo[size], text, 16);
+		size += 16;
+		echo[size++] = '|';
+		echo[size++] = '\n';
+		if(write(2, echo, size) < 0)
+			lcdEcho = false;
+	}
+
+	memcpy(lcdText[index][line - 1], text, 17);
+}
+
+void lcdPrint(FILE *lcdPort, unsigned char line, const char *formatString, ...){
+	sim_count(__func__);
+	char buffer[64];	//formatted line
+	va_list args;
+	va_start(args, formatString);
+	vsnprintf(buffer, sizeof(buffer), formatString, args);
+	va_end(args);
+	lcdSetText(lcdPort, line, buffer);
+}
+
+unsigned int lcdReadButtons(FILE *lcdPort){
+	sim_call(__func__);
+
+	//nothing pressed
+	if(lcdHead == lcdTail)
+		return 0;
+
+	//hold the press for its reads, then release it for one read
+	if(lcdReads < lcdQueue[lcdHead].reads){
+		lcdReads++;
+		return lcdQueue[lcdHead].buttons;
+	}
+
+	lcdReads = 0;
+	lcdHead = (lcdHead + 1) % LCD_QUEUE;
+	return 0;
+}
+
+void lcdSetBacklight(FILE *lcdPort, bool backlight){
+	int index = lcdIndex(lcdPort);
+	if(index >= 0)
+		lcdBacklight[index] = backlight;
+}
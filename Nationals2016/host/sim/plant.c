@@ -0,0 +1,469 @@
+/*
+ * @file plant.c
+ *
+ * @brief Implementation of the robot physics for the host simulation.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "plant.h"
+
+#define DT         0.001	//integration step in s, one tick
+#define GRAVITY    9.81		//m/s^2
+#define V_NOMINAL  7.2		//voltage the motor curves are given at
+#define DEADBAND   10		//smallest command a Motor Controller 29 responds to
+#define DETECT_AT  0.85		//path position the wheel detector sees a ball from
+#define SMOOTHING  0.02		//speed in m/s or rad/s friction reaches full strength at
+
+//393 motor curve data structure, at the output shaft
+struct{
+	double stallTorque;		//N m
+	double freeSpeed;		//rad/s
+	double stallCurrent;	//A
+	double freeCurrent;		//A
+} typedef MotorCurve;
+
+static const MotorCurve curves[3] = {
+	{1.67, 10.47, 4.8, 0.37},	//torque
+	{1.04, 16.76, 4.8, 0.37},	//speed
+	{0.70, 25.13, 4.8, 0.37}	//turbo
+};
+
+//speed share of a Motor Controller 29 at every 16 counts of command
+static const double mc29Curve[9] = {0, 0.10, 0.32, 0.56, 0.74, 0.86, 0.94, 0.98, 1.0};
+
+static PlantConfig p;					//parameters
+static double current[SIM_MOTORS + 1];	//current of each port
+static double battery;					//loaded battery voltage
+
+//drivetrain
+static double x, y, heading;		//pose in m and rad
+static double v, omega;				//forward speed and yaw rate
+static double wheelSpeed[2];		//rim speed of the left and right wheels
+static double wheelAngle[2];		//angle turned by the left and right wheels
+
+//PTO
+static bool flywheelEngaged;		//flag for the PTO driving the flywheel
+static double shiftLeft;			//time left in a shift
+static double flywheelSpeed;		//rad/s
+static double flywheelAngle;		//rad
+static double puncherSpeed;			//rad/s
+static double puncherAngle;			//rad, counting every turn
+
+//balls
+static int ballsWaiting;			//balls queued at the intake
+static bool ballInPath;				//flag for a ball between the intake and the launchers
+static double ballPosition;			//0 at the intake, 1 at the launchers
+static int shots;					//balls launched
+static double lastShotSpeed;		//m/s
+
+/*
+ * Retrieve the voltage share a motor port applies for its command.
+ *
+ * @param port The motor port.
+ * @return The signed share of the battery voltage.
+ */
+static double drive(int port){
+
+	int command = sim_getMotor(port);
+	double share;
+
+	//2-wire ports are driven straight from the Cortex
+	if(!p.mc29[port])
+		share = abs(command) / 127.0;
+
+	else if(abs(command) < DEADBAND)
+		share = 0;
+
+	else{
+		int index = abs(command) / 16;
+		double t = (abs(command) % 16) / 16.0;
+		share = index >= 8 ? 1.0 : mc29Curve[index] + (mc29Curve[index + 1] - mc29Curve[index]) * t;
+	}
+
+	return command < 0 ? -share : share;
+}
+
+/*
+ * Model a DC motor as a resistance, back EMF and torque constant.
+ *
+ * @param port The motor port.
+ * @param speed The output shaft speed in rad/s, positive in the
+ *              direction of a positive command.
+ * @return The output torque in N m.
+ */
+static double motorTorque(int port, double speed){
+	const MotorCurve* c = &curves[p.cartridge[port]];
+	double resistance = V_NOMINAL / c->stallCurrent;
+	double backEmf = (V_NOMINAL - c->freeCurrent * resistance) / c->freeSpeed;
+	double kT = c->stallTorque / c->stallCurrent;
+
+	current[port] = (drive(port) * battery - backEmf * speed) / resistance;
+	return kT * (current[port] - c->freeCurrent * tanh(speed / SMOOTHING));
+}
+
+/*
+ * Total the torque of a mechanism's motors.
+ *
+ * @param ports The signed ports, 0 ends the list.
+ * @param speed The mechanism's motor shaft speed in rad/s.
+ * @return The torque in N m, positive forward.
+ */
+static double mechanismTorque(const int* ports, double speed){
+	double torque = 0;
+	for(int i = 0; i < PLANT_MOTORS && ports[i] != 0; i++){
+		int sign = ports[i] < 0 ? -1 : 1;
+		torque += sign * motorTorque(abs(ports[i]), sign * speed);
+	}
+	return torque;
+}
+
+/*
+ * Smoothed sign for friction, so it does not chatter around zero speed.
+ *
+ * @param speed The speed being resisted.
+ * @return -1 to 1.
+ */
+static double direction(double speed){
+	return tanh(speed / SMOOTHING);
+}
+
+/*
+ * Launch the ball at the end of the path.
+ *
+ * @param speed The exit speed in m/s.
+ */
+static void launch(double speed){
+	ballInPath = false;
+	shots++;
+	lastShotSpeed = speed;
+}
+
+PlantConfig plant_defaults(){
+
+	PlantConfig c;
+	memset(&c, 0, sizeof(PlantConfig));
+
+	//ports 1 and 10 are 2-wire ports, the rest use a Motor Controller 29
+	for(int i = 1; i <= SIM_MOTORS; i++){
+		c.cartridge[i] = CARTRIDGE_SPEED;
+		c.mc29[i] = i != 1 && i != 10;
+	}
+	c.cartridge[1] = CARTRIDGE_TURBO;
+	c.cartridge[10] = CARTRIDGE_TURBO;
+	c.batteryVoltage = 8.0;
+	c.batteryResistance = 0.1;
+
+	//drive on ports 2 and 3 and, mirrored, 6 and 7
+	c.leftDrive[0] = 2;
+	c.leftDrive[1] = 3;
+	c.rightDrive[0] = -6;
+	c.rightDrive[1] = -7;
+	c.mass = 6.8;
+	c.inertia = 0.25;
+	c.trackWidth = 0.38;
+	c.wheelRadius = 0.0508;
+	c.driveRatio = 1;
+	c.wheelMass = 1.0;
+	c.traction = 0.9;
+	c.slipStiffness = 400;
+	c.rollingFriction = 0.03;
+	c.turnFriction = 2.0;
+
+	//PTO on ports 4, 5, 8 and 9, shifted by the solenoid on digital 12
+	c.pto[0] = -4;
+	c.pto[1] = 5;
+	c.pto[2] = 8;
+	c.pto[3] = -9;
+	c.shiftPin = 12;
+	c.shiftTime = 0.15;
+	c.flywheelRatio = 18;
+	c.flywheelInertia = 0.002;
+	c.flywheelRadius = 0.064;
+	c.flywheelDrag = 0.00017;
+	c.flywheelFriction = 0.01;
+	c.flywheelEncoderRatio = 0.311;
+	c.puncherRatio = 1.0 / 7;
+	c.puncherInertia = 0.05;
+	c.puncherSpring = 3.0;
+	c.puncherRelease = 5.24;
+
+	//intake on ports 1 and 10
+	c.intake[0] = -1;
+	c.intake[1] = -10;
+	c.intakeSpeed = 1.5;
+	c.launchLoss = 0.12;
+	c.launchEfficiency = 0.42;
+	c.punchSpeed = 7.0;
+
+	//sensors set up in initialize()
+	c.flywheelEncoder = 1;
+	c.puncherEncoder = 3;
+	c.wheelDetector = 2;
+	c.puncherDetector = 3;
+	c.lineLight = 2800;
+	c.lineDark = 300;
+
+	return c;
+}
+
+void plant_init(const PlantConfig* config){
+
+	p = config == NULL ? plant_defaults() : *config;
+
+	memset(current, 0, sizeof(current));
+	battery = p.batteryVoltage;
+	x = y = heading = v = omega = 0;
+	wheelSpeed[0] = wheelSpeed[1] = wheelAngle[0] = wheelAngle[1] = 0;
+	flywheelEngaged = p.shiftPin != 0 && sim_getDigital(p.shiftPin);
+	shiftLeft = 0;
+	flywheelSpeed = flywheelAngle = puncherSpeed = puncherAngle = 0;
+	ballsWaiting = 0;
+	ballInPath = false;
+	ballPosition = 0;
+	shots = 0;
+	lastShotSpeed = 0;
+
+	sim_setBattery(battery * 1000, 9000);
+	if(p.wheelDetector != 0)
+		sim_setAnalog(p.wheelDetector, p.lineLight);
+	if(p.puncherDetector != 0)
+		sim_setAnalog(p.puncherDetector, p.lineLight);
+	sim_setTickHook(plant_step);
+}
+
+void plant_setPose(double xMm, double yMm, double degrees){
+	x = xMm / 1000;
+	y = yMm / 1000;
+	heading = degrees * M_PI / 180;
+}
+
+void plant_getPose(double* xMm, double* yMm, double* degrees){
+	*xMm = x * 1000;
+	*yMm = y * 1000;
+	*degrees = heading * 180 / M_PI;
+}
+
+double plant_getSpeed(){
+	return v * 1000;
+}
+
+double plant_getFlywheelRpm(){
+	return flywheelSpeed * 60 / (2 * M_PI);
+}
+
+double plant_getPuncherAngle(){
+	return puncherAngle * 180 / M_PI;
+}
+
+void plant_loadBalls(int count){
+	ballsWaiting += count;
+}
+
+int plant_getBalls(){
+	return ballsWaiting + ballInPath;
+}
+
+int plant_getShots(){
+	return shots;
+}
+
+double plant_getLastShotSpeed(){
+	return lastShotSpeed;
+}
+
+double plant_getCurrent(unsigned char port){
+	return port >= 1 && port <= SIM_MOTORS ? current[port] : 0;
+}
+
+double plant_getBattery(){
+	return battery;
+}
+
+/*
+ * Advance the drivetrain by one step. The wheels of each side are one mass
+ * pushed by the motors and held back by the traction force, which follows
+ * the slip between the wheel rims and the floor up to the friction limit.
+ */
+static void stepDrive(){
+
+	double halfTrack = p.trackWidth / 2;
+	double sideSpeed[2] = {v - omega * halfTrack, v + omega * halfTrack};	//floor speed under each side
+	double traction[2];
+	const int* ports[2] = {p.leftDrive, p.rightDrive};
+
+	for(int side = 0; side < 2; side++){
+		double motorSpeed = wheelSpeed[side] / p.wheelRadius * p.driveRatio;
+		double push = mechanismTorque(ports[side], motorSpeed) * p.driveRatio / p.wheelRadius;
+		double limit = p.traction * p.mass * GRAVITY / 2;
+
+		traction[side] = p.slipStiffness * (wheelSpeed[side] - sideSpeed[side]);
+		if(traction[side] > limit)
+			traction[side] = limit;
+		else if(traction[side] < -limit)
+			traction[side] = -limit;
+
+		wheelSpeed[side] += DT * (push - traction[side]) / p.wheelMass;
+		wheelAngle[side] += DT * wheelSpeed[side] / p.wheelRadius;
+	}
+
+	double force = traction[0] + traction[1] - p.rollingFriction * p.mass * GRAVITY * direction(v);
+	double torque = (traction[1] - traction[0]) * halfTrack - p.turnFriction * direction(omega);
+
+	v += DT * force / p.mass;
+	omega += DT * torque / p.inertia;
+	heading += DT * omega;
+	x += DT * v * cos(heading);
+	y += DT * v * sin(heading);
+}
+
+/*
+ * Advance the PTO by one step. The solenoid picks the launcher the motors
+ * drive, with neither engaged while the PTO shifts.
+ */
+static void stepPto(){
+
+	bool wantFlywheel = p.shiftPin != 0 && sim_getDigital(p.shiftPin);	//launcher the solenoid selects
+
+	//start or finish a shift
+	if(wantFlywheel != flywheelEngaged && shiftLeft <= 0)
+		shiftLeft = p.shiftTime;
+	else if(shiftLeft > 0){
+		shiftLeft -= DT;
+		if(shiftLeft <= 0)
+			flywheelEngaged = wantFlywheel;
+	}
+
+	bool shifting = shiftLeft > 0;
+	double flywheelTorque = 0;
+	double puncherTorque = 0;
+
+	//motors spin free mid shift
+	if(shifting)
+		for(int i = 0; i < PLANT_MOTORS && p.pto[i] != 0; i++)
+			current[abs(p.pto[i])] = fabs(drive(abs(p.pto[i]))) * curves[p.cartridge[abs(p.pto[i])]].freeCurrent;
+	else if(flywheelEngaged)
+		flywheelTorque = mechanismTorque(p.pto, flywheelSpeed / p.flywheelRatio) / p.flywheelRatio;
+	else
+		puncherTorque = mechanismTorque(p.pto, puncherSpeed / p.puncherRatio) / p.puncherRatio;
+
+	//flywheel
+	flywheelTorque -= p.flywheelDrag * flywheelSpeed + p.flywheelFriction * direction(flywheelSpeed);
+	flywheelSpeed += DT * flywheelTorque / p.flywheelInertia;
+	flywheelAngle += DT * flywheelSpeed;
+
+	//puncher winds its spring until the release, the ratchet stops it turning back
+	double cam = fmod(puncherAngle, 2 * M_PI);
+	if(cam < p.puncherRelease)
+		puncherTorque -= p.puncherSpring * cam;
+	puncherSpeed += DT * puncherTorque / p.puncherInertia;
+	if(puncherSpeed < 0)
+		puncherSpeed = 0;
+	puncherAngle += DT * puncherSpeed;
+
+	//punch a seated ball
+	double newCam = fmod(puncherAngle, 2 * M_PI);
+	bool released = cam < p.puncherRelease && (newCam >= p.puncherRelease || newCam < cam);
+	if(released && ballInPath && ballPosition >= 1 && !flywheelEngaged && !shifting)
+		launch(p.punchSpeed);
+}
+
+/*
+ * Advance the balls by one step. The intake moves a ball along the path to
+ * the launchers, where the flywheel takes it right away and the puncher
+ * holds it until it fires.
+ */
+static void stepBalls(){
+
+	//intake speed from the applied voltage, the balls barely load it
+	double feed = 0;
+	int count = 0;
+	for(int i = 0; i < PLANT_MOTORS && p.intake[i] != 0; i++, count++){
+		int sign = p.intake[i] < 0 ? -1 : 1;
+		feed += sign * drive(abs(p.intake[i]));
+		current[abs(p.intake[i])] = fabs(drive(abs(p.intake[i]))) * curves[p.cartridge[abs(p.intake[i])]].freeCurrent;
+	}
+	if(count > 0)
+		feed = feed / count * battery / V_NOMINAL * p.intakeSpeed;
+
+	//take the next ball in
+	if(!ballInPath && ballsWaiting > 0 && feed > 0){
+		ballsWaiting--;
+		ballInPath = true;
+		ballPosition = 0;
+	}
+
+	if(ballInPath){
+		ballPosition += DT * feed;
+
+		//pushed back out of the intake
+		if(ballPosition < 0){
+			ballInPath = false;
+			ballsWaiting++;
+		}
+
+		//reached the launchers
+		else if(ballPosition >= 1){
+			ballPosition = 1;
+			if(flywheelEngaged && shiftLeft <= 0){
+				launch(p.launchEfficiency * flywheelSpeed * p.flywheelRadius);
+				flywheelSpeed *= 1 - p.launchLoss;
+			}
+		}
+	}
+}
+
+/*
+ * Write the sensor ports from the plant's state.
+ */
+static void updateSensors(){
+
+	if(p.flywheelEncoder != 0)
+		sim_setEncoder(p.flywheelEncoder, lround(flywheelAngle * p.flywheelEncoderRatio * 180 / M_PI));
+	if(p.puncherEncoder != 0)
+		sim_setEncoder(p.puncherEncoder, lround(puncherAngle * 180 / M_PI));
+	if(p.leftEncoder != 0)
+		sim_setEncoder(p.leftEncoder, lround(wheelAngle[0] * 180 / M_PI));
+	if(p.rightEncoder != 0)
+		sim_setEncoder(p.rightEncoder, lround(wheelAngle[1] * 180 / M_PI));
+	if(p.gyro != 0)
+		sim_setGyro(p.gyro, lround(heading * 180 / M_PI));
+
+	bool atWheel = ballInPath && ballPosition >= DETECT_AT;
+	bool seated = ballInPath && ballPosition >= 1 && !flywheelEngaged;
+	if(p.wheelDetector != 0)
+		sim_setAnalog(p.wheelDetector, atWheel ? p.lineDark : p.lineLight);
+	if(p.puncherDetector != 0)
+		sim_setAnalog(p.puncherDetector, seated ? p.lineDark : p.lineLight);
+}
+
+void plant_step(){
+
+	stepDrive();
+	stepPto();
+	stepBalls();
+
+	//sag the battery under the current drawn this step
+	double total = 0;
+	for(int i = 1; i <= SIM_MOTORS; i++)
+		total += fabs(current[i]);
+	battery = p.batteryVoltage - p.batteryResistance * total;
+	sim_setBattery(battery * 1000, 9000);
+
+	updateSensors();
+}
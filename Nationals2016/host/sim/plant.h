@@ -0,0 +1,120 @@
+/*
+ * @file plant.h
+ *
+ * @brief Physics of the robot for the host simulation. Steps at every 1 ms
+ *        tick of the virtual clock with a fixed step semi-implicit Euler
+ *        integrator, reading the motor ports and writing the sensor ports
+ *        wired in src/init.c:
+ *
+ *          - skid steer drivetrain with a DC motor curve per port, mass,
+ *            rolling and turning friction and traction limited wheel slip
+ *          - PTO shifted by the solenoid on digital 12 between a flywheel
+ *            with inertia and drag and a spring loaded puncher
+ *          - intake feeding balls to whichever launcher is engaged, with the
+ *            flywheel losing speed to each ball it launches
+ *          - flywheel and puncher encoders and the two line sensors
+ *          - battery sag from the total motor current
+ *
+ *        Motor lists hold signed port numbers, negative for a motor mounted
+ *        backwards, so that positive is forward for the mechanism.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLANT_H_
+#define PLANT_H_
+
+#include "sim.h"
+
+#define PLANT_MOTORS 4	//most motors on one mechanism
+
+//motor cartridges of the 393 motor
+#define CARTRIDGE_TORQUE 0	//100 rpm
+#define CARTRIDGE_SPEED  1	//160 rpm
+#define CARTRIDGE_TURBO  2	//240 rpm
+
+//plant parameter data structure, SI units
+struct{
+	//motors
+	int cartridge[SIM_MOTORS + 1];	//CARTRIDGE_ of each port
+	bool mc29[SIM_MOTORS + 1];		//flag for a port driven through a Motor Controller 29
+	double batteryVoltage;			//open circuit battery voltage
+	double batteryResistance;		//battery and wiring resistance in ohms
+
+	//drivetrain
+	int leftDrive[PLANT_MOTORS];	//signed ports, 0 ends the list
+	int rightDrive[PLANT_MOTORS];	//signed ports, 0 ends the list
+	double mass;					//robot mass in kg
+	double inertia;					//yaw moment of inertia in kg m^2
+	double trackWidth;				//distance between the wheel sides in m
+	double wheelRadius;				//wheel radius in m
+	double driveRatio;				//motor turns per wheel turn
+	double wheelMass;				//reflected mass of each wheel side in kg
+	double traction;				//wheel to floor friction coefficient
+	double slipStiffness;			//traction force per slip speed in N s/m
+	double rollingFriction;			//rolling resistance coefficient
+	double turnFriction;			//scrub torque of turning in N m
+
+	//PTO
+	int pto[PLANT_MOTORS];			//signed ports, 0 ends the list
+	unsigned char shiftPin;			//solenoid port, high for the flywheel
+	double shiftTime;				//time the PTO takes to shift in s
+	double flywheelRatio;			//flywheel turns per motor turn
+	double flywheelInertia;			//flywheel inertia in kg m^2
+	double flywheelRadius;			//flywheel radius in m
+	double flywheelDrag;			//flywheel viscous drag in N m s
+	double flywheelFriction;		//flywheel bearing friction in N m
+	double flywheelEncoderRatio;	//flywheel encoder turns per flywheel turn
+	double puncherRatio;			//puncher cam turns per motor turn
+	double puncherInertia;			//puncher inertia in kg m^2
+	double puncherSpring;			//spring torque per radian of wind up in N m
+	double puncherRelease;			//cam angle the puncher fires at in rad
+
+	//balls
+	int intake[PLANT_MOTORS];		//signed ports, 0 ends the list
+	double intakeSpeed;				//path lengths per second at full intake speed
+	double launchLoss;				//share of the flywheel speed each launch takes
+	double launchEfficiency;		//share of the flywheel rim speed a ball leaves with
+	double punchSpeed;				//speed a punched ball leaves with in m/s
+
+	//sensors
+	unsigned char flywheelEncoder;	//top port of the flywheel encoder, 0 for none
+	unsigned char puncherEncoder;	//top port of the puncher encoder, 0 for none
+	unsigned char leftEncoder;		//top port of a left wheel encoder, 0 for none
+	unsigned char rightEncoder;		//top port of a right wheel encoder, 0 for none
+	unsigned char gyro;				//analog port of a gyro, 0 for none
+	unsigned char wheelDetector;	//analog port of the flywheel line sensor, 0 for none
+	unsigned char puncherDetector;	//analog port of the puncher line sensor, 0 for none
+	int lineLight;					//line sensor reading with no ball
+	int lineDark;					//line sensor reading with a ball in front
+} typedef PlantConfig;
+
+PlantConfig plant_defaults();					//retrieve the parameters of the robot in src/init.c
+void plant_init(const PlantConfig* config);		//start the plant at rest, NULL for the defaults
+void plant_setPose(double x, double y, double heading);	//place the robot in mm and degrees
+void plant_getPose(double* x, double* y, double* heading);	//retrieve the robot's position in mm and degrees
+double plant_getSpeed();						//retrieve the robot's forward speed in mm/s
+double plant_getFlywheelRpm();					//retrieve the flywheel speed
+double plant_getPuncherAngle();					//retrieve the puncher cam angle in degrees
+void plant_loadBalls(int count);				//queue balls at the intake
+int plant_getBalls();							//retrieve the balls waiting or in the intake
+int plant_getShots();							//retrieve the balls launched so far
+double plant_getLastShotSpeed();				//retrieve the exit speed of the last ball in m/s
+double plant_getCurrent(unsigned char port);	//retrieve the current of a motor port in A
+double plant_getBattery();						//retrieve the loaded battery voltage
+void plant_step();								//advance the plant by one tick
+
+#endif /* PLANT_H_ */
@@ -0,0 +1,183 @@
+/*
+ * @file pool.c
+ *
+ * @brief Implementation of the work stealing pool of forked simulations.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include "pool.h"
+
+pid_t waitpid(pid_t pid, int* status, int options);	//from the C library, <sys/wait.h> clashes with API.h's wait()
+
+//job queue of one worker data structure
+struct{
+	pthread_mutex_t lock;	//guards top and bottom
+	int* jobs;				//job indices
+	int top;				//next job to steal
+	int bottom;				//one past the next job to take
+} typedef JobQueue;
+
+//batch being run
+static JobQueue queues[POOL_WORKERS];
+static int workers = 0;
+static PoolJob job = NULL;
+static char* results = NULL;
+static size_t size = 0;
+
+/*
+ * Run one job in a forked child and collect its result.
+ *
+ * @param index The job's index.
+ */
+static void runJob(int index){
+
+	char* result = results + index * size;
+	memset(result, 0, size);
+
+	int fds[2];
+	if(pipe(fds) < 0)
+		return;
+	pid_t pid = fork();
+
+	//child: run the job and send its result back
+	if(pid == 0){
+		close(fds[0]);
+		alarm(POOL_TIMEOUT);
+		job(index, result);
+		_exit(write(fds[1], result, size) == (ssize_t) size ? 0 : 1);
+	}
+	close(fds[1]);
+
+	//a child that dies leaves the result zeroed
+	if(pid > 0){
+		size_t received = 0;
+		ssize_t n;
+		while(received < size && (n = read(fds[0], result + received, size - received)) > 0)
+			received += n;
+		if(received < size)
+			memset(result, 0, size);
+		waitpid(pid, NULL, 0);
+	}
+	close(fds[0]);
+}
+
+/*
+ * Take a job from the bottom of a worker's own queue.
+ *
+ * @param queue The worker's queue.
+ * @return The job index, -1 if the queue is empty.
+ */
+static int takeJob(JobQueue* queue){
+	int index = -1;
+	pthread_mutex_lock(&queue->lock);
+	if(queue->bottom > queue->top)
+		index = queue->jobs[--queue->bottom];
+	pthread_mutex_unlock(&queue->lock);
+	return index;
+}
+
+/*
+ * Steal a job from the top of another worker's queue.
+ *
+ * @param queue The other worker's queue.
+ * @return The job index, -1 if the queue is empty.
+ */
+static int stealJob(JobQueue* queue){
+	int index = -1;
+	pthread_mutex_lock(&queue->lock);
+	if(queue->bottom > queue->top)
+		index = queue->jobs[queue->top++];
+	pthread_mutex_unlock(&queue->lock);
+	return index;
+}
+
+/*
+ * Worker thread: run jobs from its own queue, then from the others' until
+ * every queue is empty. No jobs are added once the batch starts, so an
+ * empty sweep means the worker is done.
+ *
+ * @param arg The worker's index.
+ */
+static void* worker(void* arg){
+	int self = (int) (long) arg;
+	while(true){
+		int index = takeJob(&queues[self]);
+		for(int i = 1; index < 0 && i < workers; i++)
+			index = stealJob(&queues[(self + i) % workers]);
+		if(index < 0)
+			return NULL;
+		runJob(index);
+	}
+}
+
+/*
+ * Retrieve the number of cores.
+ *
+ * @return The number of online cores, at least 1.
+ */
+int pool_cores(){
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores < 1 ? 1 : cores;
+}
+
+/*
+ * Run a batch of jobs and wait for all of them. Results do not depend on
+ * which worker ran which job, so a job should seed anything random from its
+ * index. Must be called before sim_init(), from one thread at a time.
+ *
+ * @param run The job, called in a forked child with its index and result.
+ * @param count The number of jobs.
+ * @param threads The most jobs to run at once.
+ * @param buffer The results, count of them.
+ * @param resultSize The size of each result in bytes.
+ */
+void pool_run(PoolJob run, int count, int threads, void* buffer, size_t resultSize){
+
+	if(count < 1)
+		return;
+	workers = threads < 1 ? 1 : threads > POOL_WORKERS ? POOL_WORKERS : threads;
+	if(workers > count)
+		workers = count;
+	job = run;
+	results = buffer;
+	size = resultSize;
+
+	//deal the jobs out in order, each worker taking its lowest index first
+	for(int i = 0; i < workers; i++){
+		pthread_mutex_init(&queues[i].lock, NULL);
+		queues[i].jobs = malloc((count / workers + 1) * sizeof(int));
+		queues[i].top = queues[i].bottom = 0;
+	}
+	for(int index = count - 1; index >= 0; index--){
+		JobQueue* queue = &queues[index % workers];
+		queue->jobs[queue->bottom++] = index;
+	}
+
+	pthread_t threadIds[POOL_WORKERS];
+	for(int i = 0; i < workers; i++)
+		pthread_create(&threadIds[i], NULL, worker, (void*) (long) i);
+	for(int i = 0; i < workers; i++)
+		pthread_join(threadIds[i], NULL);
+
+	for(int i = 0; i < workers; i++){
+		pthread_mutex_destroy(&queues[i].lock);
+		free(queues[i].jobs);
+	}
+}
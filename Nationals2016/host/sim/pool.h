@@ -0,0 +1,42 @@
+/*
+ * @file pool.h
+ *
+ * @brief Runs a batch of independent simulations across every core. Each
+ *        job runs in its own forked process, so the robot program's globals
+ *        and the simulation start clean every time and a job that crashes
+ *        or hangs only loses itself, and sends a fixed size result back down
+ *        a pipe. Jobs are spread over a pool of worker threads that each
+ *        take jobs from their own queue and steal from the others' once it
+ *        is empty.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <API.h>
+
+#define POOL_WORKERS 256	//most jobs at once
+#define POOL_TIMEOUT 120	//wall clock seconds before a job is killed
+
+//job run in a forked child, fills in its result
+typedef void (*PoolJob)(int index, void* result);
+
+int pool_cores();	//retrieve the number of cores
+void pool_run(PoolJob job, int count, int workers, void* results, size_t size);	//run jobs, zeroed results for those that die
+
+#endif /* POOL_H_ */
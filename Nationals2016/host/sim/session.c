@@ -0,0 +1,105 @@
+/*
+ * @file session.c
+ *
+ * @brief Implementation of the start up sequence of the host programs.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <main.h>
+#include "session.h"
+
+#define MENU_READS 3	//LCD reads each menu press is held for
+
+/*
+ * Task running initialize() like the PROS kernel does.
+ */
+static void initializeTask(void* ignore){
+	initialize();
+}
+
+/*
+ * Task running autonomous().
+ */
+static void autonomousTask(void* ignore){
+	autonomous();
+}
+
+/*
+ * Task running operatorControl().
+ */
+static void operatorControlTask(void* ignore){
+	operatorControl();
+}
+
+/*
+ * Check a slot name.
+ *
+ * @param slot The name.
+ * @return If it is sk, r1, r2, b1 or b2.
+ */
+bool session_isSlot(const char* slot){
+	return strcmp(slot, "sk") == 0 || (strlen(slot) == 2 && (slot[0] == 'r' || slot[0] == 'b')
+			&& (slot[1] == '1' || slot[1] == '2'));
+}
+
+/*
+ * Start the robot with the plant at rest and answer its start up menu.
+ * sim_init() must have been called.
+ *
+ * @param slot The slot to select: sk, r1, r2, b1 or b2.
+ * @param record If recording should be selected.
+ * @param config The plant parameters, NULL for the defaults.
+ * @return If initialize() finished with the whole menu answered.
+ */
+bool session_start(const char* slot, bool record, const PlantConfig* config){
+
+	bool skills = strcmp(slot, "sk") == 0;	//skills challenge selected
+
+	//battery, record, skills, alliance, position
+	sim_pressLcd(LCD_BTN_CENTER, MENU_READS);
+	sim_pressLcd(record ? LCD_BTN_LEFT : LCD_BTN_RIGHT, MENU_READS);
+	sim_pressLcd(skills ? LCD_BTN_LEFT : LCD_BTN_RIGHT, MENU_READS);
+	if(!skills){
+		sim_pressLcd(slot[0] == 'r' ? LCD_BTN_LEFT : LCD_BTN_RIGHT, MENU_READS);
+		sim_pressLcd(slot[1] == '1' ? LCD_BTN_LEFT : LCD_BTN_RIGHT, MENU_READS);
+	}
+
+	//start up with the robot disabled
+	sim_setCompetition(false, false);
+	initializeIO();
+	plant_init(config);
+
+	TaskHandle task = taskCreate(initializeTask, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_DEFAULT);
+	unsigned long start = millis();
+	while(taskGetState(task) != TASK_DEAD && millis() - start < SESSION_INIT_TIMEOUT)
+		delay(10);
+
+	return taskGetState(task) == TASK_DEAD && sim_lcdIdle();
+}
+
+/*
+ * Enable the robot in a competition mode.
+ *
+ * @param autonomous Start autonomous, otherwise driver control.
+ * @return The task running the mode.
+ */
+TaskHandle session_runMode(bool autonomous){
+	sim_setCompetition(true, autonomous);
+	return taskCreate(autonomous ? autonomousTask : operatorControlTask, TASK_DEFAULT_STACK_SIZE, NULL,
+			TASK_PRIORITY_DEFAULT);
+}
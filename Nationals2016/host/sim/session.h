@@ -0,0 +1,36 @@
+/*
+ * @file session.h
+ *
+ * @brief Start up sequence shared by the host programs that run the robot
+ *        program: answer the start up menu for a slot through the LCD, run
+ *        initializeIO() and initialize() like the PROS kernel, then start
+ *        autonomous or driver control.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include "plant.h"
+
+#define SESSION_INIT_TIMEOUT 20000	//longest time in ms initialize() may take
+
+bool session_isSlot(const char* slot);	//check a slot name: sk, r1, r2, b1 or b2
+bool session_start(const char* slot, bool record, const PlantConfig* config);	//start the robot and answer its menu
+TaskHandle session_runMode(bool autonomous);	//enable the robot and start a competition mode
+
+#endif /* SESSION_H_ */
@@ -0,0 +1,92 @@
+/*
+ * @file sim.h
+ *
+ * @brief Host simulation of the PROS API. host/sim implements every call in
+ *        include/API.h on Linux so the files in src/ build unmodified for a
+ *        workstation: motors and IO are plain arrays, the file system is a
+ *        directory, tasks are pthreads on a virtual clock and the LCD is two
+ *        strings. This header is the other side of that API, used by host
+ *        programs to drive the inputs and look at the outputs of the robot
+ *        code.
+ *
+ *        Like the Cortex, simulation files never include <stdio.h>: API.h
+ *        defines its own FILE and standard I/O calls.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <API.h>
+
+#define SIM_MOTORS  10	//motor ports
+#define SIM_DIGITAL 12	//digital ports
+#define SIM_ANALOG  8	//analog ports
+#define SIM_IMES    8	//integrated motor encoders on the I2C chain
+#define SIM_CALL_US 2	//virtual time in us an API call takes
+
+// ----------------------------------- Competition ---------------------------------------------
+
+void sim_setCompetition(bool enabled, bool autonomous);		//set the field control state
+void sim_setBattery(unsigned int main, unsigned int backup);	//set the battery voltages in mV
+
+// ------------------------------------ Joystick -----------------------------------------------
+
+void sim_setJoystickAnalog(unsigned char joystick, unsigned char axis, int value);						//move a joystick axis
+void sim_setJoystickDigital(unsigned char joystick, unsigned char group, unsigned char button, bool pressed);	//press or release a joystick button
+void sim_clearJoystick();																				//release every stick and button
+
+// ---------------------------------------- IO -------------------------------------------------
+
+int sim_getMotor(unsigned char channel);					//retrieve the output of a motor port
+unsigned char sim_getPinMode(unsigned char pin);			//retrieve the mode of a digital port
+bool sim_getDigital(unsigned char pin);						//retrieve the level of a digital port
+void sim_setDigital(unsigned char pin, bool value);			//drive a digital input
+void sim_setAnalog(unsigned char channel, int value);		//set the reading of an analog port
+void sim_setEncoder(unsigned char portTop, int count);		//set the raw count of the encoder on a port
+void sim_setGyro(unsigned char port, int degrees);			//set the raw angle of the gyro on a port
+void sim_setUltrasonic(unsigned char portEcho, int cm);		//set the distance of the ultrasonic on a port
+void sim_setIme(unsigned char address, int count);			//set the raw count of an integrated motor encoder
+
+// ---------------------------------------- LCD ------------------------------------------------
+
+void sim_pressLcd(unsigned int buttons, int reads);			//queue a button press lasting a number of reads
+bool sim_lcdIdle();											//retrieve if every queued press has been read
+const char* sim_getLcdLine(FILE* port, unsigned char line);	//retrieve the text on an LCD line
+void sim_echoLcd(bool enabled);								//print LCD changes to stderr
+
+// --------------------------------- Files and ports -------------------------------------------
+
+void sim_setFileRoot(const char* directory);	//set the directory that stands in for flash
+void sim_setUart(FILE* port, int fd);			//send a UART's output to a file descriptor, -1 drops it
+
+// --------------------------------------- Tasks -----------------------------------------------
+
+void sim_init();						//make the calling thread the host task, call before any robot code
+void sim_setSpeed(double factor);		//pace virtual time against host time, 1 for real time, 0 for as fast as possible
+void sim_charge(unsigned int us);		//spend virtual time in the running task, used by the API calls
+unsigned long long sim_getTime();		//retrieve the virtual time in us
+void sim_setTickHook(void (*hook)());	//call a function at every 1 ms tick, it may only use the sim_ calls
+
+// ---------------------------------- Call counters --------------------------------------------
+
+void sim_call(const char* name);		//count an API call and spend its virtual time, used by the API calls
+void sim_count(const char* name);		//count an API call that spends no virtual time of its own
+int sim_getCalls(const char** names, unsigned long* counts, int max);	//retrieve the API calls counted since the last reset
+void sim_resetCalls();					//start counting the calling task's API calls from zero
+
+#endif /* SIM_H_ */
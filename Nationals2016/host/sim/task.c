@@ -0,0 +1,650 @@
+/*
+ * @file task.c
+ *
+ * @brief Simulated tasks, synchronization and timing calls of the PROS API.
+ *
+ *        Time is virtual. Every task is a pthread, but only one of them runs
+ *        at a time: the running task holds the processor until it blocks,
+ *        and the scheduler then hands it to the highest priority ready task,
+ *        round robin among equals, like FreeRTOS does. When every task is
+ *        blocked the clock jumps straight to the next wake time, so a minute
+ *        of robot time runs in milliseconds and every run of the same inputs
+ *        makes the same decisions in the same order.
+ *
+ *        API calls cost SIM_CALL_US of virtual time (see sim_charge()), so
+ *        loops that poll millis() or a sensor without blocking still move the
+ *        clock, and are time sliced against tasks of equal or higher priority
+ *        at every 1 ms tick.
+ *
+ *        The host program is a task too, at the highest priority, so inputs it
+ *        sets take effect before the robot tasks woken on the same tick run.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+
+#define FOREVER ((unsigned long)-1)	//block time that never expires
+#define TICK_US 1000				//length of a scheduler tick
+#define HOST    TASK_MAX			//slot of the host program
+#define CALLS   64					//most API calls counted by name
+
+//semaphore and mutex data structure
+struct{
+	bool taken;		//flag for a taken semaphore or held mutex
+} typedef SimLock;
+
+//task data structure
+struct{
+	bool used;					//flag for a slot holding a task
+	pthread_t thread;			//thread running the task
+	pthread_cond_t turn;		//signalled when the task is given the processor
+	TaskCode code;				//task function
+	void* parameters;			//argument of the task function
+	unsigned int priority;		//TASK_PRIORITY_ value
+	unsigned int state;			//TASK_ state
+	bool suspended;				//flag for a suspended task
+	bool deleted;				//flag for a deleted task whose thread has not ended yet
+	unsigned long long wake;	//time to wake from a delay or give up on a lock
+	SimLock* waitingOn;			//lock being waited for, NULL when delayed
+	bool forever;				//flag for waiting on a lock without a timeout
+} typedef SimTask;
+
+//periodic function data structure for taskRunLoop()
+struct{
+	void (*fn)(void);			//function to call
+	unsigned long increment;	//time in ms between calls
+} typedef RunLoop;
+
+static SimTask tasks[TASK_MAX + 1];	//robot tasks, then the host program
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;	//guards the scheduler
+static SimTask* current = NULL;		//task holding the processor
+static __thread SimTask* self = NULL;	//task of the calling thread
+static const char* callNames[CALLS];	//API calls counted so far, only one task runs at a time
+static unsigned long callCounts[CALLS];	//times each API call was made
+static int callNameCount = 0;
+static SimTask* countingTask = NULL;	//task whose API calls are counted
+
+static unsigned long long now = 0;		//virtual time in us
+static unsigned long long sliceTick = 0;//tick the running task was last scheduled or sliced on
+static double speed = 0;				//virtual time per host time, 0 for as fast as possible
+static void (*tickHook)() = NULL;		//called at every tick the clock passes
+static struct timespec hostStart;		//host time pacing started at
+static unsigned long long paceStart;	//virtual time pacing started at
+
+/*
+ * Wait on the host until virtual time may reach a point when pacing.
+ *
+ * @param us The virtual time being moved to.
+ */
+static void pace(unsigned long long us){
+
+	if(speed <= 0)
+		return;
+
+	unsigned long long hostUs = (us - paceStart) / speed;	//host time since pacing started
+	struct timespec t = hostStart;
+	t.tv_sec += hostUs / 1000000;
+	t.tv_nsec += (hostUs % 1000000) * 1000;
+	if(t.tv_nsec >= 1000000000){
+		t.tv_sec++;
+		t.tv_nsec -= 1000000000;
+	}
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL) == EINTR);
+}
+
+/*
+ * Move the clock forward, calling the tick hook at every tick on the way
+ * like the tick interrupt would.
+ *
+ * @param us The virtual time being moved to.
+ */
+static void advance(unsigned long long us){
+	while(tickHook != NULL && (now / TICK_US + 1) * TICK_US <= us){
+		now = (now / TICK_US + 1) * TICK_US;
+		tickHook();
+	}
+	now = us;
+}
+
+/*
+ * Check if a task can be given the processor. Called with the lock held.
+ *
+ * @param t The task.
+ * @return If the task is ready to run.
+ */
+static bool isReady(SimTask* t){
+
+	if(!t->used || t->deleted || t->suspended || t->state == TASK_DEAD)
+		return false;
+	if(t->state != TASK_SLEEPING)
+		return true;
+
+	//waiting for a lock or a timeout
+	if(t->waitingOn != NULL)
+		return !t->waitingOn->taken || (!t->forever && now >= t->wake);
+
+	return now >= t->wake;
+}
+
+/*
+ * Find the task to run next, moving the clock forward when every task is
+ * blocked. Called with the lock held.
+ *
+ * @return The highest priority ready task, the one after the running task
+ *         in slot order among equals.
+ */
+static SimTask* pickNext(){
+
+	int start = current == NULL ? 0 : current - tasks;	//slot of the running task
+
+	while(true){
+		SimTask* best = NULL;
+
+		//round robin from the slot after the running task, which comes last
+		for(int k = 1; k <= TASK_MAX + 1; k++){
+			SimTask* t = &tasks[(start + k) % (TASK_MAX + 1)];
+			if(isReady(t) && (best == NULL || t->priority > best->priority))
+				best = t;
+		}
+
+		if(best != NULL)
+			return best;
+
+		//nothing can run, jump to the earliest wake time
+		bool found = false;
+		unsigned long long next = 0;
+		for(int i = 0; i <= TASK_MAX; i++){
+			SimTask* t = &tasks[i];
+			if(t->used && !t->deleted && !t->suspended && t->state == TASK_SLEEPING
+					&& !(t->waitingOn != NULL && t->forever) && (!found || t->wake < next)){
+				next = t->wake;
+				found = true;
+			}
+		}
+
+		if(!found){
+			const char* message = "sim: every task is blocked forever\n";
+			if(write(2, message, strlen(message)) < 0)
+				_exit(2);
+			_exit(2);
+		}
+
+		pace(next);
+		advance(next);
+	}
+}
+
+/*
+ * Give the processor to a task and return at once. Called with the lock held.
+ *
+ * @param next The task to run.
+ */
+static void handOff(SimTask* next){
+	current = next;
+	next->state = TASK_RUNNING;
+	sliceTick = now / TICK_US;
+	pthread_cond_signal(&next->turn);
+}
+
+/*
+ * Wait until the calling task is given the processor again, ending its
+ * thread if it was deleted in the meantime. Called with the lock held.
+ */
+static void waitForTurn(){
+
+	while(current != self && !self->deleted)
+		pthread_cond_wait(&self->turn, &lock);
+
+	//deleted by another task
+	if(self->deleted){
+		self->used = false;
+		pthread_mutex_unlock(&lock);
+		pthread_exit(NULL);
+	}
+}
+
+/*
+ * Give up the processor to the next ready task, which may be the calling
+ * task itself, and wait to run again. Called with the lock held.
+ */
+static void yield(){
+	SimTask* next = pickNext();
+	handOff(next);
+	waitForTurn();
+}
+
+/*
+ * Give up the processor if a ready task outranks the calling one. Called
+ * with the lock held.
+ *
+ * @param equal Also give it up to ready tasks of the same priority.
+ */
+static void preempt(bool equal){
+
+	for(int i = 0; i <= TASK_MAX; i++){
+		SimTask* t = &tasks[i];
+		if(t != self && isReady(t) && (t->priority > self->priority || (equal && t->priority == self->priority))){
+			self->state = TASK_RUNNABLE;
+			yield();
+			return;
+		}
+	}
+}
+
+/*
+ * Block the calling task until a time.
+ *
+ * @param us The virtual wake time.
+ */
+static void sleepUntil(unsigned long long us){
+	pthread_mutex_lock(&lock);
+	self->wake = us;
+	self->waitingOn = NULL;
+	self->state = TASK_SLEEPING;
+	yield();
+	pthread_mutex_unlock(&lock);
+}
+
+/*
+ * Thread entry point of a task.
+ *
+ * @param task The task being started.
+ */
+static void* taskEntry(void* task){
+
+	self = task;
+
+	pthread_mutex_lock(&lock);
+	waitForTurn();
+	pthread_mutex_unlock(&lock);
+
+	self->code(self->parameters);
+
+	//hand on the processor and end the thread
+	pthread_mutex_lock(&lock);
+	self->state = TASK_DEAD;
+	self->used = false;
+	handOff(pickNext());
+	pthread_mutex_unlock(&lock);
+	return NULL;
+}
+
+/*
+ * Take a semaphore or mutex, waiting for it to be given.
+ *
+ * @param l The lock being taken.
+ * @param blockTime The longest time to wait in ms, -1 to wait forever.
+ * @return If the lock was taken.
+ */
+static bool take(SimLock* l, unsigned long blockTime){
+
+	if(l == NULL)
+		return false;
+
+	sim_charge(SIM_CALL_US);
+	pthread_mutex_lock(&lock);
+
+	//block until given or timed out
+	if(l->taken && blockTime > 0){
+		self->waitingOn = l;
+		self->forever = blockTime == FOREVER;
+		self->wake = (now / TICK_US + (self->forever ? 0 : blockTime)) * TICK_US;
+		self->state = TASK_SLEEPING;
+		yield();
+		self->waitingOn = NULL;
+	}
+
+	bool taken = !l->taken;
+	l->taken = true;
+	pthread_mutex_unlock(&lock);
+	return taken;
+}
+
+/*
+ * Give back a semaphore or mutex, running a higher priority task
+ * waiting for it right away.
+ *
+ * @param l The lock being given.
+ * @return If the lock had been taken.
+ */
+static bool give(SimLock* l){
+
+	if(l == NULL)
+		return false;
+
+	sim_charge(SIM_CALL_US);
+	pthread_mutex_lock(&lock);
+	bool wasTaken = l->taken;
+	l->taken = false;
+	preempt(false);
+	pthread_mutex_unlock(&lock);
+	return wasTaken;
+}
+
+/*
+ * Resolve a task handle, NULL meaning the calling task.
+ *
+ * @param handle The handle from taskCreate().
+ * @return The task.
+ */
+static SimTask* taskFor(TaskHandle handle){
+	return handle == NULL ? self : handle;
+}
+
+void sim_init(){
+	SimTask* host = &tasks[HOST];
+	pthread_cond_init(&host->turn, NULL);
+	host->used = true;
+	host->thread = pthread_self();
+	host->priority = TASK_PRIORITY_HIGHEST;
+	host->state = TASK_RUNNING;
+	self = host;
+	current = host;
+}
+
+void sim_setSpeed(double factor){
+	speed = factor;
+	paceStart = now;
+	clock_gettime(CLOCK_MONOTONIC, &hostStart);
+}
+
+void sim_setTickHook(void (*hook)()){
+	tickHook = hook;
+}
+
+void sim_charge(unsigned int us){
+
+	advance(now + us);
+
+	//time slice at every tick, like the FreeRTOS tick interrupt
+	if(now / TICK_US != sliceTick && self != NULL){
+		sliceTick = now / TICK_US;
+		pthread_mutex_lock(&lock);
+		preempt(true);
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+void sim_count(const char* name){
+
+	//only the task that reset the counters, other tasks run alongside it
+	if(self != countingTask)
+		return;
+
+	//names are the callers' __func__, so one pointer per call
+	int i = 0;
+	while(i < callNameCount && callNames[i] != name)
+		i++;
+	if(i == callNameCount){
+		if(callNameCount == CALLS)
+			return;
+		callNames[callNameCount++] = name;
+	}
+	callCounts[i]++;
+}
+
+void sim_call(const char* name){
+	sim_count(name);
+	sim_charge(SIM_CALL_US);
+}
+
+int sim_getCalls(const char** names, unsigned long* counts, int max){
+	int n = 0;
+	for(int i = 0; i < callNameCount && n < max; i++)
+		if(callCounts[i] > 0){
+			names[n] = callNames[i];
+			counts[n++] = callCounts[i];
+		}
+	return n;
+}
+
+void sim_resetCalls(){
+	memset(callCounts, 0, sizeof(callCounts));
+	countingTask = self;
+}
+
+unsigned long long sim_getTime(){
+	return now;
+}
+
+// --------------------------------------- Tasks -----------------------------------------------
+
+TaskHandle taskCreate(TaskCode taskCode, const unsigned int stackDepth, void *parameters,
+	const unsigned int priority){
+
+	pthread_mutex_lock(&lock);
+
+	//find a free slot
+	SimTask* task = NULL;
+	for(int i = 0; i < TASK_MAX && task == NULL; i++)
+		if(!tasks[i].used)
+			task = &tasks[i];
+
+	if(task != NULL){
+		memset(task, 0, sizeof(SimTask));
+		pthread_cond_init(&task->turn, NULL);
+		task->used = true;
+		task->code = taskCode;
+		task->parameters = parameters;
+		task->priority = priority;
+		task->state = TASK_RUNNABLE;
+
+		pthread_attr_t attr;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+		if(pthread_create(&task->thread, &attr, taskEntry, task) != 0){
+			task->used = false;
+			task = NULL;
+		}
+		pthread_attr_destroy(&attr);
+	}
+
+	//a higher priority task starts right away
+	if(task != NULL)
+		preempt(false);
+
+	pthread_mutex_unlock(&lock);
+	return task;
+}
+
+void taskDelay(const unsigned long msToDelay){
+	sim_count(__func__);
+	sleepUntil((now / TICK_US + msToDelay) * TICK_US);
+}
+
+void taskDelayUntil(unsigned long *previousWakeTime, const unsigned long cycleTime){
+	sim_count(__func__);
+	*previousWakeTime += cycleTime;
+	sleepUntil((unsigned long long)*previousWakeTime * TICK_US);
+}
+
+void taskDelete(TaskHandle taskToDelete){
+
+	SimTask* task = taskFor(taskToDelete);	//task being deleted
+	if(task == &tasks[HOST])
+		return;
+
+	pthread_mutex_lock(&lock);
+
+	//end the calling task
+	if(task == self){
+		self->state = TASK_DEAD;
+		self->used = false;
+		handOff(pickNext());
+		pthread_mutex_unlock(&lock);
+		pthread_exit(NULL);
+	}
+
+	//wake the task's thread so it ends itself
+	if(task->used && !task->deleted){
+		task->deleted = true;
+		task->state = TASK_DEAD;
+		pthread_cond_signal(&task->turn);
+	}
+
+	pthread_mutex_unlock(&lock);
+}
+
+unsigned int taskGetCount(){
+	unsigned int count = 0;
+	pthread_mutex_lock(&lock);
+	for(int i = 0; i < TASK_MAX; i++)
+		if(tasks[i].used && !tasks[i].deleted)
+			count++;
+	pthread_mutex_unlock(&lock);
+	return count;
+}
+
+unsigned int taskGetState(TaskHandle task){
+	SimTask* t = taskFor(task);
+	if(!t->used || t->deleted)
+		return TASK_DEAD;
+	return t->suspended ? TASK_SUSPENDED : t->state;
+}
+
+unsigned int taskPriorityGet(const TaskHandle task){
+	return taskFor(task)->priority;
+}
+
+void taskPrioritySet(TaskHandle task, const unsigned int newPriority){
+	pthread_mutex_lock(&lock);
+	taskFor(task)->priority = newPriority;
+	preempt(false);
+	pthread_mutex_unlock(&lock);
+}
+
+void taskResume(TaskHandle taskToResume){
+	SimTask* task = taskToResume;
+	if(task == NULL)
+		return;
+	pthread_mutex_lock(&lock);
+	task->suspended = false;
+	preempt(false);
+	pthread_mutex_unlock(&lock);
+}
+
+void taskSuspend(TaskHandle taskToSuspend){
+
+	SimTask* task = taskFor(taskToSuspend);	//task being suspended
+	if(task == &tasks[HOST])
+		return;
+
+	pthread_mutex_lock(&lock);
+	task->suspended = true;
+	if(task == self){
+		self->state = TASK_RUNNABLE;
+		yield();
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+/*
+ * Task calling a function at a fixed period for taskRunLoop().
+ *
+ * @param loop The function and period.
+ */
+static void runLoopTask(void* loop){
+	RunLoop* r = loop;
+	unsigned long wakeTime = millis();
+	while(true){
+		r->fn();
+		taskDelayUntil(&wakeTime, r->increment);
+	}
+}
+
+TaskHandle taskRunLoop(void (*fn)(void), const unsigned long increment){
+	RunLoop* loop = malloc(sizeof(RunLoop));
+	if(loop == NULL)
+		return NULL;
+	loop->fn = fn;
+	loop->increment = increment;
+	TaskHandle handle = taskCreate(runLoopTask, TASK_DEFAULT_STACK_SIZE, loop, TASK_PRIORITY_DEFAULT + 1);
+	if(handle == NULL)
+		free(loop);
+	return handle;
+}
+
+// ------------------------------- Semaphores and mutexes --------------------------------------
+
+Semaphore semaphoreCreate(){
+	return calloc(1, sizeof(SimLock));
+}
+
+bool semaphoreGive(Semaphore semaphore){
+	sim_count(__func__);
+	return give(semaphore);
+}
+
+bool semaphoreTake(Semaphore semaphore, const unsigned long blockTime){
+	sim_count(__func__);
+	return take(semaphore, blockTime);
+}
+
+void semaphoreDelete(Semaphore semaphore){
+	free(semaphore);
+}
+
+Mutex mutexCreate(){
+	return calloc(1, sizeof(SimLock));
+}
+
+bool mutexGive(Mutex mutex){
+	sim_count(__func__);
+	return give(mutex);
+}
+
+bool mutexTake(Mutex mutex, const unsigned long blockTime){
+	sim_count(__func__);
+	return take(mutex, blockTime);
+}
+
+void mutexDelete(Mutex mutex){
+	free(mutex);
+}
+
+// --------------------------------------- Timing ----------------------------------------------
+
+void delay(const unsigned long time){
+	taskDelay(time);
+}
+
+void delayMicroseconds(const unsigned long us){
+	sim_charge(us);	//busy waits on the Cortex too
+}
+
+unsigned long micros(){
+	sim_call(__func__);
+	return (unsigned long)(now & 0xFFFFFFFF);	//32 bits wide like the Cortex
+}
+
+unsigned long millis(){
+	sim_call(__func__);
+	return (unsigned long)(now / 1000);
+}
+
+void wait(const unsigned long time){
+	taskDelay(time);
+}
+
+void waitUntil(unsigned long *previousWakeTime, const unsigned long time){
+	taskDelayUntil(previousWakeTime, time);
+}
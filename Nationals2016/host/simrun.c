@@ -0,0 +1,291 @@
+/*
+ * @file simrun.c
+ *
+ * @brief Runs the robot program on a workstation against the host simulation
+ *        of the PROS API and the robot physics in host/sim. The start up
+ *        menu is answered through the simulated LCD, then autonomous or
+ *        driver control runs for a set time while the motor outputs and
+ *        the state of the robot are traced.
+ *
+ *        usage: simrun [-d dir] [-s slot] [-m mode] [-t ms] [-p ms] [-x speed]
+ *                      [-b balls] [-j script] [-u file] [-v]
+ *
+ *          -d dir    directory standing in for the flash file system (.)
+ *          -s slot   sk, r1, r2, b1 or b2 (sk)
+ *          -m mode   auto, driver or record (auto)
+ *          -t ms     how long to run the mode for (15000)
+ *          -p ms     print the motors and digital ports at this period, 0 for
+ *                    only at the end (0)
+ *          -x speed  run at this multiple of real time, 0 for as fast as
+ *                    possible (0)
+ *          -b balls  balls loaded in the intake at the start (0)
+ *          -j script joystick script for driver control
+ *          -u file   write what the robot sends out of UART1, the telemetry
+ *                    stream, to a file for host/telemetry
+ *          -v        echo LCD changes to stderr
+ *
+ *        A joystick script has one change per line, '#' starts a comment:
+ *
+ *          <ms> <control> <value>
+ *
+ *        where ms counts from the start of the mode and control is one of
+ *        ch1 to ch6 (value -127 to 127) or a button 5U, 5D, 6U, 6D, 7U, 7D,
+ *        7L, 7R, 8U, 8D, 8L or 8R (value 1 pressed, 0 released).
+ *
+ *        The trace goes to stdout, one line per sample: the time in ms, the
+ *        ten motor ports, the twelve digital ports, then the robot's x and
+ *        y in mm, heading in degrees, flywheel rpm, balls launched and
+ *        battery voltage. Anything the robot prints to its debug terminal
+ *        goes to stderr, which ends with the event trace the robot dumps
+ *        when it is disabled (see host/tracejson). Time is virtual, so runs with the same options
+ *        give the same trace.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <main.h>
+#include <trace.h>
+#include "sim/session.h"
+
+#define MAX_EVENTS   4096	//most changes in a joystick script
+#define SCRIPT_SIZE  65536	//largest joystick script in bytes
+
+//joystick change data structure
+struct{
+	unsigned long time;		//ms from the start of the mode
+	unsigned char axis;		//axis 1 to 6, 0 for a button
+	unsigned char group;	//button group 5 to 8
+	unsigned char button;	//JOY_ button
+	int value;				//axis value or button state
+} typedef JoyEvent;
+
+static JoyEvent events[MAX_EVENTS];	//joystick script
+static int eventCount = 0;			//changes in the script
+
+/*
+ * Print a message to stderr.
+ *
+ * @param message The message.
+ */
+static void report(const char* message){
+	if(write(2, message, strlen(message)) < 0)
+		return;
+}
+
+/*
+ * Print the usage and stop.
+ *
+ * @param name The name of the program.
+ */
+static void usage(const char* name){
+	report("usage: ");
+	report(name);
+	report(" [-d dir] [-s sk|r1|r2|b1|b2] [-m auto|driver|record] [-t ms] [-p ms] [-x speed] [-b balls] [-j script] [-u file] [-v]\n");
+	_exit(1);
+}
+
+/*
+ * Load a joystick script.
+ *
+ * @param name The name of the script file.
+ * @return If the whole script was understood.
+ */
+static bool loadJoystick(const char* name){
+
+	static char text[SCRIPT_SIZE];	//script contents
+	int fd = open(name, O_RDONLY);
+	if(fd < 0)
+		return false;
+	int size = read(fd, text, SCRIPT_SIZE - 1);
+	close(fd);
+	if(size < 0)
+		return false;
+	text[size] = '\0';
+
+	for(char* line = strtok(text, "\n"); line != NULL; line = strtok(NULL, "\n")){
+
+		//drop comments and blank lines
+		char* comment = strchr(line, '#');
+		if(comment != NULL)
+			*comment = '\0';
+		char* p = line;
+		while(*p == ' ' || *p == '\t' || *p == '\r')
+			p++;
+		if(*p == '\0')
+			continue;
+
+		if(eventCount == MAX_EVENTS)
+			return false;
+		JoyEvent* e = &events[eventCount++];
+
+		//time, control and value
+		char* end;
+		e->time = strtoul(p, &end, 10);
+		while(*end == ' ' || *end == '\t')
+			end++;
+		char control[3] = {end[0], end[0] ? end[1] : 0, end[0] && end[1] ? end[2] : 0};
+		e->value = strtol(end + 3, NULL, 10);
+
+		if(control[0] == 'c' && control[1] == 'h' && control[2] >= '1' && control[2] <= '6')
+			e->axis = control[2] - '0';
+		else if(control[0] >= '5' && control[0] <= '8' && (control[2] == ' ' || control[2] == '\t')){
+			e->axis = 0;
+			e->group = control[0] - '0';
+			e->button = control[1] == 'U' ? JOY_UP : control[1] == 'D' ? JOY_DOWN : control[1] == 'L' ? JOY_LEFT
+					: control[1] == 'R' ? JOY_RIGHT : 0;
+			if(e->button == 0 || ((e->group == 5 || e->group == 6) && (e->button == JOY_LEFT || e->button == JOY_RIGHT)))
+				return false;
+		}
+		else
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Apply the joystick changes that are due.
+ *
+ * @param time The time in ms since the start of the mode.
+ * @param next The index of the next change, moved past the ones applied.
+ */
+static void applyJoystick(unsigned long time, int* next){
+	while(*next < eventCount && events[*next].time <= time){
+		JoyEvent* e = &events[(*next)++];
+		if(e->axis != 0)
+			sim_setJoystickAnalog(1, e->axis, e->value);
+		else
+			sim_setJoystickDigital(1, e->group, e->button, e->value != 0);
+	}
+}
+
+/*
+ * Print the motor and digital port outputs as one trace line.
+ *
+ * @param time The time of the sample in ms.
+ */
+static void trace(unsigned long time){
+	char line[256];	//trace line
+	int size = snprintf(line, sizeof(line), "%lu", time);
+	for(int i = 1; i <= SIM_MOTORS; i++)
+		size += snprintf(line + size, sizeof(line) - size, " %d", sim_getMotor(i));
+	for(int i = 1; i <= SIM_DIGITAL; i++)
+		size += snprintf(line + size, sizeof(line) - size, " %d", sim_getDigital(i));
+	double x, y, heading;
+	plant_getPose(&x, &y, &heading);
+	size += snprintf(line + size, sizeof(line) - size, " %.1f %.1f %.1f %.0f %d %.2f",
+			x, y, heading, plant_getFlywheelRpm(), plant_getShots(), plant_getBattery());
+	line[size++] = '\n';
+	if(write(1, line, size) < 0)
+		_exit(1);
+}
+
+int main(int argc, char** argv){
+
+	const char* slot = "sk";		//alliance and position
+	const char* mode = "auto";		//competition mode
+	unsigned long runTime = 15000;	//time to run the mode for
+	unsigned long period = 0;		//trace period
+	double speed = 0;				//multiple of real time
+	int balls = 0;					//balls loaded at the start
+	int uartFd = -1;				//file receiving UART1
+	int option;
+
+	sim_setFileRoot(".");
+	while((option = getopt(argc, argv, "d:s:m:t:p:x:b:j:u:v")) != -1)
+		switch(option){
+		case 'd':
+			sim_setFileRoot(optarg);
+			break;
+		case 's':
+			slot = optarg;
+			break;
+		case 'm':
+			mode = optarg;
+			break;
+		case 't':
+			runTime = strtoul(optarg, NULL, 10);
+			break;
+		case 'p':
+			period = strtoul(optarg, NULL, 10);
+			break;
+		case 'x':
+			speed = strtod(optarg, NULL);
+			break;
+		case 'b':
+			balls = strtol(optarg, NULL, 10);
+			break;
+		case 'j':
+			if(!loadJoystick(optarg)){
+				report("simrun: bad joystick script\n");
+				return 1;
+			}
+			break;
+		case 'u':
+			uartFd = open(optarg, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if(uartFd < 0){
+				report("simrun: cannot write the UART1 file\n");
+				return 1;
+			}
+			break;
+		case 'v':
+			sim_echoLcd(true);
+			break;
+		default:
+			usage(argv[0]);
+		}
+
+	bool record = strcmp(mode, "record") == 0;	//recording selected
+	bool autonomous = strcmp(mode, "auto") == 0;	//autonomous selected
+	if(!autonomous && !record && strcmp(mode, "driver") != 0)
+		usage(argv[0]);
+	if(!session_isSlot(slot))
+		usage(argv[0]);
+
+	sim_init();
+	sim_setSpeed(speed);
+	sim_setUart(stdout, 2);	//keep the trace on stdout clean
+	sim_setUart(uart1, uartFd);
+
+	//start up, then run the selected mode
+	if(!session_start(slot, record, NULL)){
+		report("simrun: initialize() did not finish the start up menu\n");
+		return 1;
+	}
+	plant_loadBalls(balls);
+	TaskHandle task = session_runMode(autonomous);
+	unsigned long start = millis();		//time the mode began
+	unsigned long wakeTime = start;		//time of the last update
+	unsigned long elapsed = 0;			//time since the mode began
+	int next = 0;						//next joystick change
+
+	//drive the joystick and trace every ms until the time is up or autonomous ends
+	while(elapsed < runTime && taskGetState(task) != TASK_DEAD){
+		applyJoystick(elapsed, &next);
+		if(period > 0 && elapsed % period == 0)
+			trace(elapsed);
+		taskDelayUntil(&wakeTime, 1);
+		elapsed = wakeTime - start;
+	}
+
+	trace(elapsed);
+	sim_setCompetition(false, false);
+	delay(2 * TRACE_PERIOD);	//let the robot dump its event trace
+	return 0;
+}
@@ -0,0 +1,196 @@
+/*
+ * @file telemetry.c
+ *
+ * @brief Decodes the binary telemetry stream described in
+ *        include/telemetry.h into one column file per channel for
+ *        plotting. The stream can be a capture of the robot's UART1 or the
+ *        file simrun -u writes.
+ *
+ *        usage: telemetry [-o prefix] [file]
+ *
+ *          -o prefix  start of the names of the files written (telemetry)
+ *          file       stream to decode, stdin if not given
+ *
+ *        Each channel goes to <prefix>.<channel>.tsv, one sample per line:
+ *        the time in ms, then the channel's values, under a header line
+ *        naming the columns. Frames that fail to decode are counted and
+ *        skipped, and gaps in the sequence numbers are counted as lost
+ *        frames; both are reported on stderr.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <main.h>
+#include <telemetry.h>
+
+int vsnprintf(char* buffer, size_t limit, const char* formatString, va_list args);	//from the C library, <stdio.h> clashes with API.h
+
+#define READ_SIZE 4096	//bytes read from the stream at a time
+#define NAME_SIZE 256	//longest file name
+
+static int files[TELEM_CHANNELS];			//column file of each channel, -1 until its first sample
+static unsigned long samples[TELEM_CHANNELS];	//samples decoded on each channel
+
+/*
+ * Print a message to stderr.
+ *
+ * @param message The message.
+ */
+static void report(const char* message){
+	if(write(2, message, strlen(message)) < 0)
+		return;
+}
+
+/*
+ * Print the usage and stop.
+ *
+ * @param name The name of the program.
+ */
+static void usage(const char* name){
+	report("usage: ");
+	report(name);
+	report(" [-o prefix] [file]\n");
+	_exit(1);
+}
+
+/*
+ * Print formatted text to a file descriptor.
+ */
+static void output(int fd, const char* format, ...){
+	char line[256];
+	va_list args;
+	va_start(args, format);
+	int size = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if(size > (int) sizeof(line) - 1)
+		size = sizeof(line) - 1;
+	if(write(fd, line, size) < 0)
+		_exit(1);
+}
+
+/*
+ * Write a sample to its channel's column file, creating the file with its
+ * header on the channel's first sample.
+ *
+ * @param prefix The start of the file names.
+ * @param sample The sample.
+ * @return If the sample was written.
+ */
+static bool writeSample(const char* prefix, const TelemetrySample* sample){
+
+	int channel = sample->channel;
+	if(files[channel] < 0){
+		char name[NAME_SIZE];
+		snprintf(name, sizeof(name), "%s.%s.tsv", prefix, telemetry_getName(channel));
+		files[channel] = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(files[channel] < 0)
+			return false;
+
+		//header naming the columns, tab separated
+		char header[NAME_SIZE];
+		snprintf(header, sizeof(header), "time %s\n", telemetry_getColumns(channel));
+		for(char* c = header; *c != '\0'; c++)
+			if(*c == ' ')
+				*c = '\t';
+		output(files[channel], "%s", header);
+	}
+
+	char line[256];
+	int size = snprintf(line, sizeof(line), "%lu", sample->time);
+	for(int i = 0; i < sample->count; i++)
+		size += snprintf(line + size, sizeof(line) - size, "\t%d", sample->values[i]);
+	output(files[channel], "%s\n", line);
+	samples[channel]++;
+	return true;
+}
+
+int main(int argc, char** argv){
+
+	const char* prefix = "telemetry";	//start of the file names
+	int option;
+
+	while((option = getopt(argc, argv, "o:")) != -1)
+		switch(option){
+		case 'o':
+			prefix = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	if(argc - optind > 1)
+		usage(argv[0]);
+
+	int in = 0;	//stream being decoded
+	if(optind < argc && (in = open(argv[optind], O_RDONLY)) < 0){
+		report("telemetry: cannot read the stream\n");
+		return 1;
+	}
+	for(int i = 0; i < TELEM_CHANNELS; i++)
+		files[i] = -1;
+
+	static unsigned char buffer[READ_SIZE];	//bytes read
+	unsigned char frame[TELEM_FRAME_SIZE];	//frame being collected
+	int frameSize = 0;						//bytes in the frame
+	bool overflow = false;					//flag for a frame too long to be valid
+	unsigned long decoded = 0;				//valid frames
+	unsigned long bad = 0;					//frames that failed to decode
+	unsigned long lost = 0;					//frames missing from the sequence
+	int expected = -1;						//next sequence number, -1 before the first frame
+	int n;
+
+	while((n = read(in, buffer, READ_SIZE)) > 0)
+		for(int i = 0; i < n; i++){
+
+			//collect the frame up to its zero
+			if(buffer[i] != 0){
+				if(frameSize < TELEM_FRAME_SIZE)
+					frame[frameSize++] = buffer[i];
+				else
+					overflow = true;
+				continue;
+			}
+
+			TelemetrySample sample;
+			if(frameSize == 0)
+				;
+			else if(overflow || !telemetry_decode(frame, frameSize, &sample))
+				bad++;
+			else{
+				if(expected >= 0)
+					lost += (sample.sequence - expected) & 0xFF;
+				expected = (sample.sequence + 1) & 0xFF;
+				decoded++;
+				if(!writeSample(prefix, &sample)){
+					report("telemetry: cannot write a column file\n");
+					return 1;
+				}
+			}
+			frameSize = 0;
+			overflow = false;
+		}
+
+	output(2, "%lu frames, %lu bad, %lu lost\n", decoded, bad, lost);
+	for(int i = 0; i < TELEM_CHANNELS; i++)
+		if(files[i] >= 0){
+			output(2, "  %s.%s.tsv: %lu samples\n", prefix, telemetry_getName(i), samples[i]);
+			close(files[i]);
+		}
+
+	return 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * @file tracejson.c
+ *
+ * @brief Converts an event trace dumped by the robot (include/trace.h) into
+ *        the Chrome trace event JSON format, which chrome://tracing and
+ *        ui.perfetto.dev show as one row per task on a time line. The input
+ *        is a capture of the debug terminal, or the stderr of simrun, and may
+ *        hold anything else around the dump; the last complete dump is used.
+ *
+ *        usage: tracejson [file] > trace.json
+ *
+ *          file  capture holding the dump, stdin if not given
+ *
+ *        Each event is put on the row of the task whose stack holds it: of
+ *        the named tasks running at the time of the event, the one with the
+ *        lowest stack address at or above the event's.
+ *        End events whose begin was overwritten in the ring are dropped.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <main.h>
+#include <trace.h>
+
+int vsnprintf(char* buffer, size_t limit, const char* formatString, va_list args);	//from the C library, <stdio.h> clashes with API.h
+
+#define CAPTURE_SIZE (4 << 20)	//largest capture in bytes
+#define MAX_TASKS    64			//most task lines in a dump
+
+//named task in the dump data structure
+struct{
+	char* name;				//name of the task
+	unsigned long stack;	//address on its stack where it named itself
+	unsigned long start;	//time in us it named itself
+	unsigned long end;		//time in us its stack was taken over, 0 if it was running
+	int row;				//row in the trace, shared by tasks with the same name
+} typedef DumpTask;
+
+static DumpTask tasks[MAX_TASKS];
+static int taskCount = 0;
+static int depths[MAX_TASKS + 1];	//open begin events on each row, row 0 for events of unnamed tasks
+static bool first = true;			//flag for the first JSON event
+
+/*
+ * Print a message to stderr.
+ *
+ * @param message The message.
+ */
+static void report(const char* message){
+	if(write(2, message, strlen(message)) < 0)
+		return;
+}
+
+/*
+ * Print formatted text to stdout.
+ */
+static void output(const char* format, ...){
+	char line[512];
+	va_list args;
+	va_start(args, format);
+	int size = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if(size > (int) sizeof(line) - 1)
+		size = sizeof(line) - 1;
+	if(write(1, line, size) < 0)
+		_exit(1);
+}
+
+/*
+ * Start a JSON event, separating it from the one before.
+ */
+static void startEvent(){
+	output(first ? "\n  {" : ",\n  {");
+	first = false;
+}
+
+/*
+ * Find the row of the task whose stack held an address at a time.
+ *
+ * @param stack The address.
+ * @param time The time in us.
+ * @return The row, 0 if no named task held it.
+ */
+static int rowOf(unsigned long stack, unsigned long time){
+
+	DumpTask* best = NULL;
+	for(int i = 0; i < taskCount; i++)
+		if(tasks[i].start <= time && (tasks[i].end == 0 || time < tasks[i].end) && tasks[i].stack >= stack &&
+				(best == NULL || tasks[i].stack < best->stack))
+			best = &tasks[i];
+
+	return best == NULL ? 0 : best->row;
+}
+
+/*
+ * Find the last complete dump in a capture.
+ *
+ * @param text The capture.
+ * @return The first line after "trace begin", NULL if there is no complete dump.
+ */
+static char* findDump(char* text){
+
+	char* dump = NULL;
+	for(char* p = strstr(text, "trace begin\n"); p != NULL; p = strstr(p + 1, "trace begin\n"))
+		if((p == text || p[-1] == '\n') && strstr(p, "\ntrace end") != NULL)
+			dump = p + strlen("trace begin\n");
+
+	return dump;
+}
+
+int main(int argc, char** argv){
+
+	if(argc > 2){
+		report("usage: tracejson [file] > trace.json\n");
+		return 1;
+	}
+
+	int in = 0;	//capture being read
+	if(argc == 2 && (in = open(argv[1], O_RDONLY)) < 0){
+		report("tracejson: cannot read the capture\n");
+		return 1;
+	}
+
+	char* text = malloc(CAPTURE_SIZE);
+	int size = 0;
+	int n;
+	while(size < CAPTURE_SIZE - 1 && (n = read(in, text + size, CAPTURE_SIZE - 1 - size)) > 0)
+		size += n;
+	text[size] = '\0';
+
+	char* line = findDump(text);
+	if(line == NULL){
+		report("tracejson: no complete trace dump found\n");
+		return 1;
+	}
+
+	output("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+	unsigned long events = 0;	//events written
+	unsigned long dropped = 0;	//end events without a begin
+
+	for(char* end; line != NULL && strncmp(line, "trace end", 9) != 0; line = end == NULL ? NULL : end + 1){
+		end = strchr(line, '\n');
+		if(end != NULL)
+			*end = '\0';
+		char* cr = strchr(line, '\r');
+		if(cr != NULL)
+			*cr = '\0';
+
+		//a task naming itself, one row per name
+		if(strncmp(line, "task ", 5) == 0 && taskCount < MAX_TASKS){
+			char* name = line + 5;
+			char* address = strchr(name, ' ');
+			if(address == NULL)
+				continue;
+			*address++ = '\0';
+
+			DumpTask* t = &tasks[taskCount];
+			t->name = name;
+			t->stack = strtoul(address, &address, 16);
+			t->start = strtoul(address, &address, 10);
+			t->end = strtoul(address, NULL, 10);
+			t->row = taskCount + 1;
+			for(int i = 0; i < taskCount; i++)
+				if(strcmp(tasks[i].name, name) == 0)
+					t->row = tasks[i].row;
+			if(t->row == taskCount + 1){
+				startEvent();
+				output("\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+						t->row, name);
+			}
+			taskCount++;
+			continue;
+		}
+
+		//an event: type, time, stack address and name
+		char type = line[0];
+		if((type != TRACE_BEGIN_EVENT && type != TRACE_END_EVENT && type != TRACE_INSTANT_EVENT) || line[1] != ' ')
+			continue;
+		char* p;
+		unsigned long time = strtoul(line + 2, &p, 10);
+		unsigned long stack = strtoul(p, &p, 16);
+		while(*p == ' ')
+			p++;
+		int row = rowOf(stack, time);
+
+		if(type == TRACE_END_EVENT && depths[row] == 0){
+			dropped++;
+			continue;
+		}
+		depths[row] += type == TRACE_BEGIN_EVENT ? 1 : type == TRACE_END_EVENT ? -1 : 0;
+
+		startEvent();
+		output("\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %lu, \"pid\": 1, \"tid\": %d%s}", p, type, time, row,
+				type == TRACE_INSTANT_EVENT ? ", \"s\": \"t\"" : "");
+		events++;
+	}
+
+	output("\n]}\n");
+	char summary[128];
+	snprintf(summary, sizeof(summary), "tracejson: %lu events from %d tasks, %lu unmatched ends dropped\n",
+			events, taskCount, dropped);
+	report(summary);
+	return 0;
+}
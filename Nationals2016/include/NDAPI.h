@@ -29,6 +29,7 @@
 
 #include <string.h>
 #include <API.h>
+#include <output.h>
 
 // ------------------------------------------ Ports --------------------------------------------
 
@@ -80,6 +81,11 @@
 #define DGTL_11 11	//digital sensor port eleven
 #define DGTL_12 12	//digital sensor port twelve
 
+//port masks and pins
+#define DGTL_MASK(port) (1u << ((port) - DGTL_1))	//bit of a digital port in a port mask
+#define DGTL_ALL        0x0FFFu						//mask of every digital port
+#define IN_PIN(port)    ((port) + DGTL_12)			//pin number of an analog port for pinMode()
+
 //------------------------------------- Data Structures ----------------------------------------
 
 //motor data structure
@@ -97,19 +103,22 @@ struct{
 } typedef MotorSystem;
 
 //sensor data structure
-struct{
+struct Sensor{
 	void* sensor;	//preset sensor
 	int type;		//the type of sensor
 	int* ports;		//the ports the sensor is connected to
 	int size;		//the number of ports the sensor uses
 	bool opposite;	//flag for returning opposite values
 	bool analog;	//a flag to determine if the sensor is digital or analog
+	int (*read)(const struct Sensor* target);	//reads the sensor, chosen for its type when it is set up, NULL until then
+	void (*reset)(struct Sensor* target);		//resets the sensor, chosen for its type when it is set up, NULL until then
 } typedef Sensor;
 
 //sensor system data structure
 struct{
-	Sensor* sensors;	//sensors that are part of the system
-	int size;			//the amount of sensors in the system
+	Sensor* sensors;						//sensors that are part of the system
+	int size;								//the amount of sensors in the system
+	int (*read)(const Sensor* target);		//reader shared by every sensor in the system, NULL if they differ
 } typedef SensorSystem;
 
 //lcd data structure
@@ -166,6 +175,7 @@ void motorSystem_setTillPID(MotorSystem* target, Sensor* obs, double k, int val)
 #define SOL   11 //electronic pneumatic solenoid
 
 Sensor sensor_init(int sensorType, const int port, ...);	//initialize the sensor
+void sensor_start(Sensor* target, int multiplier);			//set up the hardware of a sensor
 void sensor_set(Sensor* target, int value);					//set the value of the sensor
 void sensor_reset(Sensor* target);							//reset sensor
 bool sensor_opposite(Sensor* target);						//make the sensor return opposite values
@@ -184,6 +194,126 @@ void sensorSystem_reset(SensorSystem* target);									//reset sensor system
 int sensorSystem_getSize(SensorSystem target);									//retrieve the number of ports the sensor uses
 int sensorSystem_getValue(SensorSystem target);									//retrieve the average current sensor value
 
+// ------------------------------------- Digital Ports -----------------------------------------
+
+void digital_setMode(unsigned char port, unsigned char mode);	//set the mode of a digital port, tracking the outputs
+unsigned int digital_getOutputs();								//retrieve the mask of ports set up as outputs
+unsigned int digital_read(unsigned int mask);					//read a mask of digital ports in one pass
+void digital_write(unsigned int mask, unsigned int values);		//write the output ports of a mask in one pass
+
+// ------------------------------------- Inline Access -----------------------------------------
+
+/*
+ * Pointer forms of the accessors and setters above, defined here so the
+ * control loops inline them instead of copying a structure into every
+ * call. The by-value functions are wrappers around these.
+ */
+
+//retrieve the port of the motor
+static inline int motor_port(const Motor* target){
+	return target->port;
+}
+
+//retrieve the velocity of the motor
+static inline int motor_velocity(const Motor* target){
+	return target->velocity;
+}
+
+//retrieve the reversed flag of the motor
+static inline bool motor_reversed(const Motor* target){
+	return target->reversed;
+}
+
+//set the velocity of the motor, limited to [-127, 127]
+static inline void motor_set(Motor* target, int velocity){
+
+	//limit the velocity
+	if(velocity > 127)
+		velocity = 127;
+	else if(velocity < -127)
+		velocity = -127;
+
+	target->velocity = velocity;
+	output_set(target->port, target->reversed ? -velocity : velocity);	//the output task ramps the port to it
+}
+
+//retrieve the number of motors in the motor system
+static inline int motorSystem_size(const MotorSystem* target){
+	return target->size;
+}
+
+//retrieve the velocity of the motor system
+static inline int motorSystem_velocity(const MotorSystem* target){
+	return target->velocity;
+}
+
+//check to see if the motor system has a motor on the port of the motor
+static inline bool motorSystem_has(const MotorSystem* target, const Motor* m){
+	for(int i = 0; i < target->size; i++)
+		if(target->motors[i].port == m->port)
+			return true;
+	return false;
+}
+
+//set the velocity of every motor in the motor system, limited to [-127, 127]
+static inline void motorSystem_set(MotorSystem* target, int velocity){
+
+	//limit the velocity
+	if(velocity > 127)
+		velocity = 127;
+	else if(velocity < -127)
+		velocity = -127;
+
+	target->velocity = velocity;
+	for(int i = 0; i < target->size; i++)
+		motor_set(&target->motors[i], velocity);
+}
+
+//retrieve the type of the sensor
+static inline int sensor_type(const Sensor* target){
+	return target->type;
+}
+
+//retrieve the number of ports the sensor uses
+static inline int sensor_size(const Sensor* target){
+	return target->size;
+}
+
+//retrieve the analog flag of the sensor
+static inline bool sensor_analog(const Sensor* target){
+	return target->analog;
+}
+
+//retrieve the current value of the sensor through the reader set up for its type, 0 if it was never set up
+static inline int sensor_read(const Sensor* target){
+	return target->read != NULL ? target->read(target) : 0;
+}
+
+//retrieve the number of sensors in the sensor system
+static inline int sensorSystem_size(const SensorSystem* target){
+	return target->size;
+}
+
+//retrieve the average current value of the sensors in the sensor system
+static inline int sensorSystem_read(const SensorSystem* target){
+
+	//no sensors to pull values from
+	if(target->size == 0)
+		return 0;
+
+	int value = 0;	//the sum of all the sensor values
+
+	//sensors of one type share a reader, looked up once for the whole system
+	if(target->read != NULL)
+		for(int i = 0; i < target->size; i++)
+			value += target->read(&target->sensors[i]);
+	else
+		for(int i = 0; i < target->size; i++)
+			value += sensor_read(&target->sensors[i]);
+
+	return value / target->size;
+}
+
 // ------------------------------------------ LCD ----------------------------------------------
 
 #define ON	   true		//used to turn lcd backlight on
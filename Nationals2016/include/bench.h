@@ -0,0 +1,54 @@
+/*
+ * @file bench.h
+ *
+ * @brief Microbenchmarks of the driver control hot paths. The same table of
+ *        benchmarks is timed on the Cortex with micros() and on a workstation
+ *        by host/bench, which also counts the PROS API and NDAPI calls each
+ *        one makes and checks them against stored baselines.
+ *
+ *        Only built with BENCHMARK defined (make BENCHMARK=1), which also has
+ *        initialize() print the timings to the debug terminal once the start
+ *        up menu is done. The robot is disabled then, and every benchmark
+ *        writes 0 to the motors, so nothing moves.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <main.h>
+
+#ifdef BENCHMARK
+
+#define BENCH_LOOP_PERIOD 20	//delay in ms between userControl() calls in operatorControl()
+
+//benchmark data structure
+struct{
+	const char* name;	//name in reports and baselines
+	void (*setup)();	//prepare the robot state, NULL for none
+	void (*run)();		//one call of the code being timed
+	int iterations;		//calls timed
+} typedef Benchmark;
+
+int bench_count();							//retrieve the number of benchmarks
+const Benchmark* bench_get(int index);		//retrieve a benchmark
+unsigned long bench_time(const Benchmark* b);	//run a benchmark, retrieve the total time in us
+void bench_report();						//time every benchmark and print the results
+
+#endif /* BENCHMARK */
+
+#endif /* BENCH_H_ */
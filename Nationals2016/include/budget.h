@@ -0,0 +1,83 @@
+/*
+ * @file budget.h
+ *
+ * @brief Current and breaker heat budget of the motors. The Cortex feeds
+ *        ports 1 to 5 and ports 6 to 10 through one thermal breaker each,
+ *        and every 393 motor has its own; a breaker trips once the heat of
+ *        the current through it builds up, and stays open for seconds.
+ *
+ *        Every BUDGET_PERIOD the output task hands the budget each port's
+ *        output and the battery voltage. The current of each motor is
+ *        estimated from a DC motor model: the voltage the output applies
+ *        less the back EMF of the motor's speed, over its resistance. The
+ *        speed is measured where code with an encoder on the mechanism
+ *        passes it in with budget_setSpeed(), and otherwise follows the
+ *        output with a lag, as for a free spinning motor. The heat of each
+ *        breaker is the square of its current over the square of its trip
+ *        current, through a first order lag, so a heat of 1 is a trip.
+ *
+ *        As a breaker's heat passes BUDGET_DERATE_START the outputs behind
+ *        it are scaled down by priority: all the way to BUDGET_FLOOR for the
+ *        lowest priority ports before the next priority is touched, so the
+ *        intake gives way before the PTO and the PTO before the drive. A
+ *        motor's own breaker derates that motor alone.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BUDGET_H_
+#define BUDGET_H_
+
+#include <NDAPI.h>
+
+#define BUDGET_PERIOD 20	//time in ms between estimates
+#define BUDGET_PORTS  10	//motor ports of the Cortex
+#define BUDGET_BANKS  2		//breakers of the Cortex, ports 1 to 5 and 6 to 10
+
+//393 motor model
+#define BUDGET_VOLTAGE    7.2	//voltage in V the model is given at
+#define BUDGET_RESISTANCE 1.5	//winding resistance in ohms, 4.8 A stall at 7.2 V
+#define BUDGET_BACK_EMF   6.65	//back EMF in V at free speed, 0.37 A free current at 7.2 V
+#define BUDGET_SPIN_UP    250	//time constant in ms of the speed following the output when it is not measured
+#define BUDGET_SPEED_HOLD 100	//time in ms a measured speed is used for
+
+//breakers
+#define BUDGET_MOTOR_TRIP 2.5	//current in A a motor's own breaker trips at if held
+#define BUDGET_BANK_TRIP  4.0	//current in A a Cortex breaker trips at if held
+#define BUDGET_HEAT_LAG   10000	//time constant in ms of a breaker's heat
+
+//derating
+#define BUDGET_DERATE_START 0.6		//heat at which outputs start to be scaled down
+#define BUDGET_DERATE_FULL  0.9		//heat at which every priority is scaled down to the floor
+#define BUDGET_FLOOR        0.25	//smallest share of its output a port is scaled down to
+
+//priorities, lowest first
+#define BUDGET_LOW    0	//first to give way, such as the intake
+#define BUDGET_MID    1	//such as the PTO
+#define BUDGET_HIGH   2	//last to give way, such as the drive
+#define BUDGET_LEVELS 3	//number of priorities
+
+void budget_setPriority(unsigned char port, int priority);		//set the priority of a motor port
+int budget_getPriority(unsigned char port);						//retrieve the priority of a motor port
+void budget_setSpeed(const MotorSystem* system, float share);	//pass in the measured speed of a motor system's motors
+void budget_update(const int* outputs, unsigned int battery);	//estimate the currents and heat of a budget period
+int budget_derate(unsigned char port, int output);				//scale an output down for the heat behind its port
+float budget_getCurrent(unsigned char port);					//retrieve the estimated current of a motor port in A
+float budget_getMotorHeat(unsigned char port);					//retrieve the heat of a motor's own breaker
+float budget_getBankHeat(int bank);								//retrieve the heat of a Cortex breaker
+float budget_getScale(unsigned char port);						//retrieve the share of its output a motor port is held to
+
+#endif /* BUDGET_H_ */
@@ -0,0 +1,40 @@
+/*
+ * @file fixmath.h
+ *
+ * @brief Integer only trigonometry for the Cortex-M3, which has no floating
+ *        point unit. Angles are binary angle units where FIX_TURN is one
+ *        full revolution, ratios are Q15 fixed point and both are computed
+ *        with CORDIC.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FIXMATH_H_
+#define FIXMATH_H_
+
+#define FIX_ONE  32768	//1.0 in Q15
+#define FIX_TURN 65536	//one revolution in binary angle units
+
+#define FIX_DEG(deg)   ((int)((deg) * FIX_TURN / 360))			//convert degrees to binary angle units
+#define FIX_TO_DEG(a)  ((int)(((long long)(a) * 360) / FIX_TURN))	//convert binary angle units to degrees
+
+int fix_wrap(int angle);							//wrap an angle to half a turn either way
+void fix_sinCos(int angle, int* sine, int* cosine);	//retrieve the Q15 sine and cosine of an angle
+int fix_atan2(int y, int x);						//retrieve the angle of a vector
+int fix_hypot(int x, int y);						//retrieve the length of a vector
+int fix_mul(int a, int q15);						//multiply a value by a Q15 ratio
+
+#endif /* FIXMATH_H_ */
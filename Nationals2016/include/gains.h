@@ -0,0 +1,75 @@
+/*
+ * @file gains.h
+ *
+ * @brief Tunable controller parameters of the robot and the file they are
+ *        loaded from at start up. The file holds one parameter per line,
+ *
+ *          <name> <value>
+ *
+ *        with '#' starting a comment. Parameters missing from the file keep
+ *        the hand tuned values the controllers start with, so a file only
+ *        needs the ones that were retuned. host/autotune writes this file.
+ *
+ *          fire.slope      flywheel rapid fire threshold per unit of set speed
+ *          fire.offset     flywheel rapid fire threshold at a set speed of 0
+ *          fire.ball       wheel line sensor reading below which a ball waits
+ *          puncher.ball    puncher line sensor reading below which a ball is seated
+ *          preset.high     flywheel set speed of the high preset
+ *          preset.low      flywheel set speed of the low preset
+ *          lift.kP         lift proportional gain
+ *          lift.kI         lift integral gain
+ *          lift.kD         lift derivative gain
+ *          lift.kG         lift gravity feedforward
+ *          lift.iLimit     lift integral output limit
+ *          turn.kP         turn proportional gain
+ *          turn.kD         turn derivative gain
+ *          turn.minOutput  turn smallest output
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GAINS_H_
+#define GAINS_H_
+
+#include <lift.h>
+#include <turn.h>
+
+#define GAINS_FILE "gains.txt"	//file loaded at start up
+#define GAINS_SIZE 1024			//largest gains file in bytes
+
+//flywheel rapid fire parameters
+struct{
+	double fireSlope;	//encoder ticks per driver loop of the fire threshold per unit of set speed
+	double fireOffset;	//encoder ticks per driver loop of the fire threshold at a set speed of 0
+	int ballThreshold;	//wheel line sensor reading below which a ball waits at the flywheel
+	int puncherBall;	//puncher line sensor reading below which a ball is seated at the puncher
+	int presetHigh;		//flywheel set speed of the high preset
+	int presetLow;		//flywheel set speed of the low preset
+} typedef FlywheelGains;
+
+//every tunable parameter
+struct{
+	FlywheelGains flywheel;	//flywheel rapid fire parameters
+	LiftGains lift;			//lift controller gains
+	TurnGains turn;			//turn controller gains
+} typedef Gains;
+
+Gains gains_get();						//retrieve every tunable parameter
+void gains_set(Gains gains);			//hand every tunable parameter to its controller
+FlywheelGains gains_getFlywheel();		//retrieve the flywheel rapid fire parameters
+bool gains_load(const char* name);		//load parameters from a file over the current ones
+
+#endif /* GAINS_H_ */
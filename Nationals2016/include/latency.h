@@ -0,0 +1,62 @@
+/*
+ * @file latency.h
+ *
+ * @brief Joystick to motor latency monitor for driver control. A fast task
+ *        watches the joystick inputs and motor outputs of each control path
+ *        and, when an input changes, times with micros() how long it takes
+ *        the path's motors to change. That is what the driver feels: the
+ *        wait for the next userControl() call, everything it does before the
+ *        write and the loop delay.
+ *
+ *        Only built with LATENCY defined (make LATENCY=1). On the Cortex the
+ *        percentiles are printed to the debug terminal while the robot is
+ *        driven; host/latency steps the joystick in the host simulation and
+ *        reads the same numbers.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <robot.h>
+
+#ifdef LATENCY
+
+#define LATENCY_PERIOD        1		//time in ms between checks of the inputs and outputs
+#define LATENCY_TIMEOUT       500	//time in ms an input change may go without a motor change
+#define LATENCY_STICK_CHANGE  15	//joystick axis movement that counts as an input change
+#define LATENCY_SAMPLES       128	//latencies kept per path
+#define LATENCY_REPORT_PERIOD 10000	//time in ms between reports on the debug terminal
+
+//control paths
+#define LATENCY_DRIVE  0	//joystick channels 2 and 3 to the drive
+#define LATENCY_INTAKE 1	//buttons 5 and 6 to the intake
+#define LATENCY_PTO    2	//button group 8 to the PTO
+#define LATENCY_PATHS  3	//number of control paths
+
+void latency_init();										//start the latency monitor task
+void latency_reset();										//forget every latency measured
+const char* latency_getName(int path);						//retrieve the name of a control path
+int latency_getCount(int path);								//retrieve the number of latencies kept for a path
+int latency_getMissed(int path);							//retrieve the input changes a path never answered
+unsigned long latency_getPercentile(int path, int percent);	//retrieve a latency percentile of a path in us
+void latency_report();										//print the latency percentiles of every path
+void latency_task(void* ignore);							//latency monitor task
+
+#endif /* LATENCY */
+
+#endif /* LATENCY_H_ */
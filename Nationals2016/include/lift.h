@@ -0,0 +1,54 @@
+/*
+ * @file lift.h
+ *
+ * @brief Background lift position controller. A fixed rate task holds
+ *        Robot.liftPos as a setpoint using PID with a gravity feedforward
+ *        term so the driver loop and autonomous routines only have to set
+ *        a target.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIFT_H_
+#define LIFT_H_
+
+#include <robot.h>
+
+#define LIFT_PERIOD    10	//time in ms between controller updates
+#define LIFT_TOLERANCE 10	//sensor ticks from the target that count as reached
+#define LIFT_SETTLE    5	//consecutive updates inside the tolerance before the lift is settled
+#define LIFT_TIMEOUT   2000	//default time in ms to wait for the lift in autonomous
+
+//lift controller gains
+struct{
+	double kP;	//proportional gain
+	double kI;	//integral gain
+	double kD;	//derivative gain
+	int kG;		//gravity feedforward, the output that holds the lift still
+	int iLimit;	//largest output the integral term may contribute
+} typedef LiftGains;
+
+void lift_init();											//start the lift controller task
+bool lift_isRunning();										//retrieve if the lift controller task is running
+void lift_setGains(LiftGains gains);						//set the lift controller gains
+LiftGains lift_getGains();									//retrieve the lift controller gains
+void lift_setTarget(int pos);								//set the lift setpoint
+int lift_getTarget();										//retrieve the lift setpoint
+bool lift_atTarget();										//retrieve if the lift has settled on its setpoint
+bool lift_waitForTarget(unsigned long timeout);				//wait until the lift settles or the timeout expires
+void lift_task(void* ignore);								//lift controller task
+
+#endif /* LIFT_H_ */
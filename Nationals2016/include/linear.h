@@ -0,0 +1,51 @@
+/*
+ * @file linear.h
+ *
+ * @brief Motor output linearization. The speed of a 393 motor driven
+ *        through a Motor Controller 29 is far from proportional to its
+ *        command: little happens below 10 and most of the speed is reached
+ *        by 64. A linearization table maps a speed, as a share of full
+ *        speed from 0 to 127, to the command that gives it, and the output
+ *        stage looks up every output of a port given a table (see
+ *        output_setLinear()), so controllers and presets see a motor whose
+ *        speed follows its output.
+ *
+ *        The tables are constants generated offline by host/lingen from a
+ *        characterization run: linear_characterize() sweeps a motor system's
+ *        command with its table off and measures the speed on an encoder.
+ *        On the robot it is called with the mechanism engaged and the debug
+ *        terminal captured, in the simulation lingen -s runs it itself; a
+ *        table from the simulation only fits the simulated plant. No table
+ *        has been measured on the robot yet, so every port runs without one.
+ *        Tables are indexed by the magnitude of the output, the sign is kept.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LINEAR_H_
+#define LINEAR_H_
+
+#include <NDAPI.h>
+
+#define LINEAR_SIZE   128	//entries of a table, one per output magnitude
+#define LINEAR_STEP   8		//command step of a characterization sweep
+#define LINEAR_POINTS (127 / LINEAR_STEP + 2)	//commands of a sweep, 0 to 127
+#define LINEAR_SETTLE 2000	//time in ms each command is held before the speed is measured
+#define LINEAR_SAMPLE 500	//time in ms the speed is measured over
+
+int linear_characterize(MotorSystem* system, Sensor* encoder, int* speeds, FILE* port);	//sweep a motor system, retrieve the speed at each command
+
+#endif /* LINEAR_H_ */
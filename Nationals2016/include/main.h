@@ -117,6 +117,8 @@ void initialize();
 void operatorControl();	//do not modify in blackbox
 void userControl();		//place user code here
 
+extern int wheelSetSpeed;	//flywheel velocity driver control runs the PTO at
+
 // End C++ export structure
 #ifdef __cplusplus
 }
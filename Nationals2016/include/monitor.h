@@ -0,0 +1,66 @@
+/*
+ * @file monitor.h
+ *
+ * @brief Processor, stack and memory monitor. Each periodic task of the
+ *        robot registers itself and sleeps through monitor_delayUntil() or
+ *        monitor_delay(), which time with micros() how long the task ran
+ *        since it last woke. A monitor task turns that into the share of
+ *        the processor each task took over the last MONITOR_PERIOD.
+ *
+ *        PROS has no call for a task's stack use, so a task registering
+ *        itself fills the unused part of its stack with a pattern, and the
+ *        free stack is the part still holding it: the least the task has
+ *        ever had left. Free memory is the largest block malloc() can give.
+ *
+ *        The figures are printed to the debug terminal when any key is sent
+ *        to it and each time the robot is disabled. The run time of a task
+ *        includes any time a higher priority task took while it ran, and
+ *        PROS's own tasks are not counted.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MONITOR_H_
+#define MONITOR_H_
+
+#include <API.h>
+
+#define MONITOR_PERIOD      1000	//time in ms each processor share is measured over
+#define MONITOR_CHECK       100		//time in ms between checks for a key or the robot being disabled
+#define MONITOR_TASKS       12		//most tasks that can register
+#define MONITOR_STACK_GUARD 256		//bytes at the ends of a stack that are not filled with the pattern
+#define MONITOR_STACK_FILL  0xA5	//pattern filling unused stack
+#define MONITOR_RAM         65536	//RAM of the Cortex in bytes, the most malloc() is asked for
+
+//monitored task data structure
+struct{
+	const char* name;				//name of the task
+	unsigned int stackSize;			//size of the task's stack in bytes
+	unsigned int stackFree;			//bytes of stack the task has never used, 0 if not known
+	unsigned int load;				//share of the processor over the last period in tenths of a percent
+} typedef TaskLoad;
+
+int monitor_register(const char* name, unsigned int stackDepth);				//register the running task, retrieve its id
+void monitor_delayUntil(int id, unsigned long* wakeTime, unsigned long period);	//sleep a registered task until its next period
+void monitor_delay(int id, unsigned long time);									//sleep a registered task for a time
+void monitor_init();															//start the monitor task
+int monitor_getCount();															//retrieve the number of registered tasks
+bool monitor_getTask(int id, TaskLoad* load);									//retrieve the figures of a registered task
+unsigned int monitor_getFreeMemory();											//retrieve the largest free block of memory in bytes
+void monitor_report(FILE* port);												//print the figures of every task
+void monitor_task(void* ignore);												//monitor task
+
+#endif /* MONITOR_H_ */
@@ -0,0 +1,48 @@
+/*
+ * @file odometry.h
+ *
+ * @brief Wheel odometry. A fixed rate task integrates the drive encoders and
+ *        the gyro into an (x, y, heading) pose with integer only math and
+ *        publishes it as a snapshot any task can read without locking.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ODOMETRY_H_
+#define ODOMETRY_H_
+
+#include <robot.h>
+#include <fixmath.h>
+
+#define ODOM_PERIOD        10		//time in ms between pose updates
+#define ODOM_UM_PER_TICK   886		//wheel travel per encoder tick in micrometres (4" wheel, 360 tick encoder)
+#define ODOM_TRACK_WIDTH   380		//distance between the left and right wheels in mm
+
+//robot pose data structure
+struct{
+	int x;				//distance forward from the starting tile in mm
+	int y;				//distance left from the starting tile in mm
+	int heading;		//cumulative counter clockwise heading in binary angle units
+	unsigned long time;	//time in ms the pose was measured
+} typedef Pose;
+
+void odom_init();							//start the odometry task
+bool odom_isRunning();						//retrieve if the odometry task is running
+void odom_reset(int x, int y, int heading);	//move the pose to a known position
+void odom_getPose(Pose* pose);				//retrieve the latest pose
+void odom_task(void* ignore);				//odometry task
+
+#endif /* ODOMETRY_H_ */
@@ -0,0 +1,70 @@
+/*
+ * @file output.h
+ *
+ * @brief Motor output stage. Every motor write of the robot goes through
+ *        output_set(), which only records the value asked for. A fixed
+ *        rate task moves each port's output towards its requested value by
+ *        at most the port's slew limit each OUTPUT_PERIOD and is the only
+ *        caller of motorSet(), so a jump from full forward to full reverse
+ *        is spread over several periods instead of spiking the current.
+ *
+ *        Requests are meant for a battery at OUTPUT_NOMINAL. Before the slew
+ *        limit the task scales them by the nominal over the actual voltage,
+ *        taken from powerLevelMain() through a first order filter, so a
+ *        request gives the same motor speed on a fresh or a tired battery
+ *        until the output reaches 127.
+ *
+ *        The heat budget (include/budget.h) then scales them down when a
+ *        breaker is close to tripping.
+ *
+ *        Last, a port given a linearization table (include/linear.h) has its
+ *        output looked up in it for the command written, so the output is a
+ *        share of full speed rather than a raw command.
+ *
+ *        Values are in the motor's own direction, after any reversing.
+ *        While the robot is disabled the outputs fall to 0 at once, so the
+ *        next enable ramps up from a stop.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <API.h>
+
+#define OUTPUT_PERIOD 5		//time in ms between output updates
+#define OUTPUT_PORTS  10	//motor ports of the Cortex
+#define OUTPUT_NOSLEW 0		//slew limit that lets a port jump straight to its request
+
+#define OUTPUT_NOMINAL     7800	//battery voltage in mV requests are meant for
+#define OUTPUT_LOW_BATTERY 5000	//battery readings in mV below this are not trusted and not compensated for
+#define OUTPUT_FILTER      32	//battery readings averaged by the filter, a time constant of 160 ms
+
+void output_init();									//start the motor output task
+void output_set(unsigned char port, int value);		//request an output for a motor port
+int output_getRequest(unsigned char port);			//retrieve the output requested for a motor port
+int output_get(unsigned char port);					//retrieve the output a motor port has reached, before linearization
+void output_setSlew(unsigned char port, int slew);	//set the largest change per period of a motor port
+int output_getSlew(unsigned char port);				//retrieve the slew limit of a motor port
+void output_setCompensation(bool compensate);		//set if requests are scaled for the battery voltage
+bool output_getCompensation();						//retrieve if requests are scaled for the battery voltage
+void output_setLinear(unsigned char port, const unsigned char* table);	//set the linearization table of a motor port
+const unsigned char* output_getLinear(unsigned char port);			//retrieve the linearization table of a motor port
+unsigned int output_getBattery();					//retrieve the filtered battery voltage in mV
+void output_task(void* ignore);						//motor output task
+
+#endif /* OUTPUT_H_ */
@@ -0,0 +1,80 @@
+/*
+ * @file pto.h
+ *
+ * @brief PTO state machine. The PTO motors drive either the puncher or the
+ *        flywheel, picked by a solenoid that moves a dog across; the dog
+ *        grinds if the solenoid reverses part way or meshes with a gear
+ *        spinning at another speed. A fixed rate task owns the solenoid and
+ *        the PTO motors and steps through
+ *
+ *          PTO_PUNCHER   puncher engaged, driven at the puncher output
+ *          PTO_SHIFTING  solenoid moving the dog, for PTO_SHIFT_TIME
+ *          PTO_SPINUP    flywheel engaged, below its fire threshold
+ *          PTO_READY     flywheel engaged, at or above its fire threshold
+ *
+ *        A launcher asked for mid shift is shifted to once the shift ends.
+ *        Shifting to the flywheel, the motors are matched to the speed it is
+ *        still coasting at, so it meshes cleanly and keeps that speed rather
+ *        than spinning up from rest. The fire threshold comes from the
+ *        flywheel gains, as the rapid fire threshold always has.
+ *
+ *        The fire gains are tuned on the robot in encoder ticks per driver
+ *        loop, the speed userControl() used to measure. Driver control hands
+ *        the task the loop's measured period (see pto_setLoopPeriod()), and
+ *        the task scales its own speed to it; the same fire line, inverted,
+ *        gives the output that matches a coasting flywheel.
+ *
+ *        The task also measures the flywheel speed over each PTO_WINDOW and
+ *        hands it to the current budget. Until a launcher is picked, and after
+ *        pto_stop(), the task leaves the solenoid and motors to other code
+ *        such as a replay.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PTO_H_
+#define PTO_H_
+
+#include <robot.h>
+
+#define PTO_PERIOD     10	//time in ms between updates
+#define PTO_WINDOW     20	//time in ms the flywheel speed is measured over, a multiple of PTO_PERIOD
+#define PTO_SHIFT_TIME 200	//time in ms the solenoid takes to move the dog across, with margin
+#define PTO_CRAWL      20	//output turning the motors over so the dog finds its slot on the flywheel
+#define PTO_LOOP       20	//time in ms of the driver loop until it is measured, the delay it runs with
+#define PTO_FREE_SPEED 5370	//flywheel encoder ticks per second with the PTO motors at free speed, 160 rpm through 18:1
+
+//states
+#define PTO_OFF      0	//the task does not drive the PTO
+#define PTO_PUNCHER  1	//puncher engaged
+#define PTO_SHIFTING 2	//solenoid moving the dog
+#define PTO_SPINUP   3	//flywheel engaged, below its fire threshold
+#define PTO_READY    4	//flywheel engaged, at or above its fire threshold
+
+void pto_init();								//start the PTO task
+bool pto_isRunning();							//retrieve if the PTO task is running
+void pto_select(bool flywheel);					//pick the launcher the PTO drives
+bool pto_isFlywheel();							//retrieve if the flywheel is the launcher picked
+void pto_stop();								//stop the task driving the PTO
+int pto_getState();								//retrieve the state
+bool pto_isReady();								//retrieve if the flywheel is at its fire threshold
+void pto_setPuncher(int output);				//set the output the puncher is driven at
+void pto_setFlywheel(int speed, bool boost);	//set the flywheel set speed and if it spins up at full output
+int pto_getVelocity();							//retrieve the flywheel speed in encoder ticks per PTO_WINDOW
+void pto_setLoopPeriod(unsigned long period);	//hand the task the measured period of the driver loop
+void pto_task(void* ignore);					//PTO task
+
+#endif /* PTO_H_ */
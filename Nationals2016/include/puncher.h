@@ -0,0 +1,66 @@
+/*
+ * @file puncher.h
+ *
+ * @brief Puncher cycle controller. The PTO winds the puncher's spring with
+ *        a cam that releases it once a turn, and a ratchet keeps the cam
+ *        from turning back. A fixed rate task samples the puncher encoder
+ *        and ball detector and runs a cock, hold, fire cycle:
+ *
+ *          PUNCHER_COCKING  winding to PUNCHER_COCKED, the spring slowing it
+ *          PUNCHER_LOADED   stopped short of the release, the ratchet holding it
+ *          PUNCHER_FIRING   driving past PUNCHER_RELEASE, then cocking again
+ *
+ *        The encoder sits on the cam and counts from where the puncher rests
+ *        after a shot at start up; it is never reset, the cam angle being its
+ *        count through the current turn. The QME already takes the interrupts
+ *        of its ports, so the task samples every PUNCHER_PERIOD instead, as
+ *        often as the output stage writes the motors. Its output goes to the
+ *        PTO task (see pto_setPuncher()), which drives the motors with it
+ *        while the puncher is engaged.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PUNCHER_H_
+#define PUNCHER_H_
+
+#include <robot.h>
+
+#define PUNCHER_PERIOD  5	//time in ms between samples, the period of the output stage
+#define PUNCHER_TURN    360	//encoder ticks per cam turn
+#define PUNCHER_RELEASE 300	//cam angle in ticks the spring is released at
+#define PUNCHER_COCKED  280	//cam angle in ticks the puncher is held at, short of the release
+#define PUNCHER_PAST    10	//ticks past the release a shot is driven to
+
+//states
+#define PUNCHER_OFF     0	//the controller does not drive the puncher
+#define PUNCHER_COCKING 1	//winding to the cocked angle
+#define PUNCHER_LOADED  2	//held at the cocked angle
+#define PUNCHER_FIRING  3	//driving past the release
+
+void puncher_init();			//start the puncher controller task
+bool puncher_isRunning();		//retrieve if the puncher controller task is running
+void puncher_start();			//start cocking and holding the puncher
+void puncher_stop();			//stop the controller driving the puncher
+void puncher_fire();			//fire once the puncher is loaded
+int puncher_getState();			//retrieve the state
+bool puncher_isLoaded();		//retrieve if the puncher is held at the cocked angle
+bool puncher_hasBall();			//retrieve if a ball is seated in front of the puncher
+int puncher_getAngle();			//retrieve the cam angle in encoder ticks
+int puncher_getShots();			//retrieve the number of shots fired
+void puncher_task(void* ignore);	//puncher controller task
+
+#endif /* PUNCHER_H_ */
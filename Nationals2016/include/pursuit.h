@@ -0,0 +1,51 @@
+/*
+ * @file pursuit.h
+ *
+ * @brief Pure pursuit path follower for autonomous. Paths are smoothed,
+ *        densified and given a velocity for every point on the host by
+ *        host/pathgen, then stored in flash as constant tables and followed
+ *        on the robot using the odometry pose.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PURSUIT_H_
+#define PURSUIT_H_
+
+#include <robot.h>
+
+#define PURSUIT_PERIOD    10	//time in ms between steering updates
+#define PURSUIT_LOOKAHEAD 300	//lookahead distance in mm
+#define PURSUIT_TOLERANCE 40	//distance in mm from the last point that finishes the path
+#define PURSUIT_SEARCH    20	//points past the last closest point searched each update
+#define PURSUIT_ACCEL     4		//largest increase of the drive output per update
+
+//path point data structure
+struct{
+	short x;		//distance forward from the starting tile in mm
+	short y;		//distance left from the starting tile in mm
+	short velocity;	//drive output scheduled for this point
+} typedef PathPoint;
+
+//path data structure
+struct{
+	const PathPoint* points;	//points of the path in driving order
+	int size;					//number of points in the path
+} typedef Path;
+
+bool pursuit_follow(const Path* path, unsigned long timeout);	//drive along a path until its end or the timeout
+
+#endif /* PURSUIT_H_ */
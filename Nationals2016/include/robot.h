@@ -44,6 +44,10 @@
 #define DRIVER  1	//the main driver controller
 #define PARTNER 2	//the partner driver controller
 
+//recordings
+#define RECORD_BATTERY 'V'	//first character of a recording whose frames end with the battery voltage
+#define RECORD_LINEAR  'L'	//first character of a recording as RECORD_BATTERY whose outputs are before linearization
+
 //motors
 Motor motor1;	//motor on port 1
 Motor motor2;	//motor on port 2
@@ -0,0 +1,38 @@
+/*
+ * @file script.h
+ *
+ * @brief Interpreter for compiled autonomous scripts. Scripts are written on
+ *        the host, compiled by host/scriptc to a few hundred bytes of
+ *        bytecode (see scriptops.h) and run here on top of the Motor,
+ *        MotorSystem and Sensor calls, with parallel branches stepped side
+ *        by side every update.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPT_H_
+#define SCRIPT_H_
+
+#include <robot.h>
+#include <scriptops.h>
+
+#define SCRIPT_PERIOD  10	//time in ms between interpreter updates
+
+bool script_run(const unsigned char* code, int size);	//run a script until it ends
+bool script_runFile(const char* name);					//load a script from a file and run it
+bool script_runSlot();									//run the script for the selected alliance and position
+
+#endif /* SCRIPT_H_ */
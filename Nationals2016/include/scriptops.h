@@ -0,0 +1,66 @@
+/*
+ * @file scriptops.h
+ *
+ * @brief Bytecode format of the autonomous scripts. Shared by the robot's
+ *        interpreter and the host compiler, so it must not include any PROS
+ *        header.
+ *
+ *        A script starts with the SCRIPT_MAGIC bytes and SCRIPT_VERSION,
+ *        followed by instructions. Every instruction is an opcode byte and
+ *        its arguments, with 16 bit arguments stored little endian.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCRIPTOPS_H_
+#define SCRIPTOPS_H_
+
+#define SCRIPT_MAGIC0  'A'	//first byte of every script
+#define SCRIPT_MAGIC1  'S'	//second byte of every script
+#define SCRIPT_VERSION 1	//third byte of every script
+#define SCRIPT_HEADER  3	//size of the header in bytes
+#define SCRIPT_SIZE    1024	//largest script, header included, that the robot loads
+#define SCRIPT_THREADS 8	//most branches, the main one included, that can run at once
+
+//opcodes							  arguments
+#define OP_END      0x00	//end of the script or of a parallel branch
+#define OP_DRIVE    0x01	//distance in mm (16), velocity (16)
+#define OP_TURN     0x02	//absolute heading in degrees (16)
+#define OP_LIFT     0x03	//lift position (16)
+#define OP_INTAKE   0x04	//intake velocity (16)
+#define OP_PTO      0x05	//PTO velocity (16)
+#define OP_WAIT     0x06	//time in ms (16)
+#define OP_UNTIL    0x07	//sensor (8), comparison (8), value (16)
+#define OP_OUTPUT   0x08	//digital pin (8), value (8)
+#define OP_PARALLEL 0x09	//branch count (8), branch lengths in bytes (16 each), then the branches
+
+//sensors for OP_UNTIL
+#define SENSOR_WHEEL_ENCODER    0	//Robot.wheelEncoder
+#define SENSOR_PUNCHER_ENCODER  1	//Robot.puncherEncoder
+#define SENSOR_WHEEL_DETECTOR   2	//Robot.wheelDetector
+#define SENSOR_PUNCHER_DETECTOR 3	//Robot.puncherDetector
+#define SENSOR_LIFT             4	//Robot.liftSensor
+#define SENSOR_LEFT_DRIVE       5	//Robot.leftDriveSensor
+#define SENSOR_RIGHT_DRIVE      6	//Robot.rightDriveSensor
+#define SENSOR_TURN             7	//Robot.turnSensor
+#define SENSOR_COUNT            8	//number of sensors
+
+//comparisons for OP_UNTIL
+#define CMP_LESS    0	//sensor value is below the value
+#define CMP_GREATER 1	//sensor value is above the value
+#define CMP_EQUAL   2	//sensor value matches the value
+
+#endif /* SCRIPTOPS_H_ */
@@ -0,0 +1,86 @@
+/*
+ * @file telemetry.h
+ *
+ * @brief Binary telemetry stream of the robot's state. The driver control
+ *        loop samples the channels below into a lock free ring buffer, each
+ *        channel only every so many loops, and a low priority task sends
+ *        what is in the ring out of a serial port. Sampling only copies
+ *        values, so the control loop never waits on the port; when the ring
+ *        is full new samples are dropped and counted.
+ *
+ *        Each sample is sent as one frame: the payload below encoded with
+ *        COBS (consistent overhead byte stuffing) so it holds no zero bytes,
+ *        then a zero byte ending the frame. A receiver joining mid-stream or
+ *        losing bytes resynchronizes at the next zero.
+ *
+ *          channel (1 byte), sequence number (1 byte), time in ms (4 bytes),
+ *          values (4 bytes each), checksum (1 byte)
+ *
+ *        Multi-byte fields are little endian. The sequence number counts
+ *        every frame sent so a receiver can tell frames were lost, and the
+ *        checksum makes the sum of the payload's bytes zero. host/telemetry
+ *        decodes a stream into one column file per channel.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <robot.h>
+
+#define TELEM_PERIOD     10		//time in ms between sends of the ring buffer
+#define TELEM_RING       32		//samples the ring buffer holds, a power of two
+#define TELEM_MAX_VALUES 10		//most values in a sample
+#define TELEM_BAUD       115200	//baud rate of a UART telemetry port
+
+//largest payload and frame in bytes
+#define TELEM_PAYLOAD_SIZE (7 + 4 * TELEM_MAX_VALUES)
+#define TELEM_FRAME_SIZE   (TELEM_PAYLOAD_SIZE + TELEM_PAYLOAD_SIZE / 254 + 2)
+
+//channels
+#define TELEM_MOTORS   0	//outputs of motor ports 1 to 10
+#define TELEM_FLYWHEEL 1	//flywheel set speed, encoder counts per PTO window and PTO state
+#define TELEM_PUNCHER  2	//puncher cam angle, ball detector readings and puncher state
+#define TELEM_POSE     3	//odometry x and y in mm and heading in degrees
+#define TELEM_BATTERY  4	//main and backup battery voltages in mV
+#define TELEM_LOOP     5	//driver control loop period and userControl() time in us
+#define TELEM_CURRENT  6	//estimated currents of motor ports 1 to 10 in mA
+#define TELEM_BUDGET   7	//heat of the Cortex breakers and the hottest motor, and the smallest output share of each priority, in thousandths
+#define TELEM_CHANNELS 8	//number of channels
+
+//telemetry sample data structure
+struct{
+	unsigned char channel;				//channel sampled
+	unsigned char sequence;				//frame number, set when sent
+	unsigned long time;					//time in ms the sample was taken
+	int count;							//number of values
+	int values[TELEM_MAX_VALUES];		//sampled values
+} typedef TelemetrySample;
+
+void telemetry_init(FILE* port);										//start sending telemetry out of a port
+bool telemetry_isRunning();												//retrieve if telemetry is being sent
+void telemetry_setDecimation(int channel, int loops);					//sample a channel every number of loops, 0 for never
+int telemetry_getDecimation(int channel);								//retrieve how often a channel is sampled
+void telemetry_sample(unsigned long loopTime);							//sample the channels due this driver control loop
+unsigned long telemetry_getDropped();									//retrieve the samples dropped with the ring buffer full
+const char* telemetry_getName(int channel);								//retrieve the name of a channel
+const char* telemetry_getColumns(int channel);							//retrieve the names of a channel's values
+int telemetry_encode(const TelemetrySample* sample, unsigned char* frame);			//frame a sample for sending
+bool telemetry_decode(const unsigned char* frame, int size, TelemetrySample* sample);	//unframe a received sample
+void telemetry_task(void* ignore);										//telemetry sending task
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,74 @@
+/*
+ * @file trace.h
+ *
+ * @brief Event trace of the robot's tasks. Trace points in NDAPI, robot.c
+ *        and the control loops record when a piece of work begins and ends,
+ *        or that something happened, into a fixed ring buffer in RAM: the
+ *        micros() time, the event name and the task it ran in. When the
+ *        robot is disabled after a match the ring is printed to the debug
+ *        terminal, and host/tracejson turns a capture of it into a Chrome
+ *        trace (chrome://tracing or ui.perfetto.dev) showing every task's
+ *        work on one time line.
+ *
+ *        The PROS API gives no way to name the running task, so the address
+ *        of a local variable stands in for it: every task's stack is its
+ *        own block of memory, and each task names itself with TRACE_TASK()
+ *        when it starts so the dump can map addresses back to tasks. A task
+ *        naming itself within a stack's size of another is taken to have
+ *        been given the stack of one that ended, such as initialize().
+ *
+ *        Trace points cost a micros() call and a few stores. They are
+ *        compiled out with make NOTRACE=1.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <API.h>
+
+#define TRACE_EVENTS 512	//events the ring buffer holds, a power of two
+#define TRACE_TASKS  12		//most tasks that can name themselves
+#define TRACE_STACK_SPAN (TASK_DEFAULT_STACK_SIZE * 4)	//bytes of a task's stack
+#define TRACE_PERIOD 100	//time in ms between checks for the robot being disabled
+
+//event types, the Chrome trace phase letters
+#define TRACE_BEGIN_EVENT   'B'	//work began
+#define TRACE_END_EVENT     'E'	//work ended
+#define TRACE_INSTANT_EVENT 'i'	//something happened
+
+//trace points, names must be string literals
+#ifndef NOTRACE
+#define TRACE_BEGIN(name)   trace_event(TRACE_BEGIN_EVENT, name)
+#define TRACE_END(name)     trace_event(TRACE_END_EVENT, name)
+#define TRACE_INSTANT(name) trace_event(TRACE_INSTANT_EVENT, name)
+#define TRACE_TASK(name)    trace_nameTask(name)
+#else
+#define TRACE_BEGIN(name)
+#define TRACE_END(name)
+#define TRACE_INSTANT(name)
+#define TRACE_TASK(name)
+#endif
+
+void trace_init();								//start the task that dumps the trace when the robot is disabled
+void trace_event(char type, const char* name);	//record an event in the running task
+void trace_nameTask(const char* name);			//name the running task
+void trace_dump(FILE* port);					//print the trace
+void trace_clear();								//forget every event recorded
+void trace_task(void* ignore);					//trace dumping task
+
+#endif /* TRACE_H_ */
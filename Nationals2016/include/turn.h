@@ -0,0 +1,65 @@
+/*
+ * @file turn.h
+ *
+ * @brief Gyro based turn and heading hold controller for the drive. A fixed
+ *        rate task closes the loop on the robot's heading, either turning in
+ *        place to an angle or holding a heading while driving straight.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TURN_H_
+#define TURN_H_
+
+#include <robot.h>
+
+#define TURN_PERIOD    10	//time in ms between controller updates
+#define TURN_TOLERANCE 2	//degrees from the target that count as reached
+#define TURN_RATE      5	//largest degrees per second that count as stopped
+#define TURN_SETTLE    5	//consecutive updates at the target before the turn is settled
+#define TURN_TIMEOUT   2000	//default time in ms to wait for a turn in autonomous
+
+//controller modes
+#define TURN_OFF  0	//the controller does not drive
+#define TURN_TO   1	//turn in place to the target heading
+#define TURN_HOLD 2	//drive at a base velocity while holding the target heading
+
+//turn controller gains
+struct{
+	double kP;		//proportional output per degree of error
+	double kD;		//derivative output per degree per second
+	int minOutput;	//smallest output that still turns the robot in place
+} typedef TurnGains;
+
+void turn_init();										//start the turn controller task
+bool turn_isRunning();									//retrieve if the turn controller task is running
+void turn_setGains(TurnGains gains);					//set the turn controller gains
+TurnGains turn_getGains();								//retrieve the turn controller gains
+int turn_getHeading();									//retrieve the robot's heading in degrees
+int turn_getHeadingFix();								//retrieve the robot's heading in binary angle units
+void turn_toAngle(int angle);							//start turning in place to an absolute heading
+void turn_hold(int angle, int velocity);				//drive at a velocity while holding a heading
+void turn_holdFix(int angle, int velocity);				//drive at a velocity while holding a heading in binary angle units
+void turn_stop();										//stop the controller driving
+int turn_getMode();										//retrieve the controller mode
+bool turn_isSettled();									//retrieve if a turn has settled on its target
+bool turn_waitForSettle(unsigned long timeout);			//wait until a turn settles or the timeout expires
+bool turn_turnTo(int angle, unsigned long timeout);		//turn in place to a heading and wait for it
+void turn_setAssist(bool enabled);						//enable driver heading assist in robot_joyDrive
+bool turn_assistEnabled();								//retrieve if driver heading assist is available
+void turn_task(void* ignore);							//turn controller task
+
+#endif /* TURN_H_ */
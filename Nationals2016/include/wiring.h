@@ -0,0 +1,82 @@
+/*
+ * @file wiring.h
+ *
+ * @brief The robot's wiring: which port every motor and sensor is plugged
+ *        into, written once as tables. src/wiring.c expands the tables into
+ *        the motors, motor systems and sensors of the robot as static data,
+ *        so nothing is allocated and no port lists are parsed at start up;
+ *        wiring_init() only sets up the sensors' hardware. Two motors on one
+ *        port, or two sensors on one digital or analog port, stop the build.
+ *
+ *        Each table is an X-macro: a list of X(...) rows that the code using
+ *        it expands with its own X.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WIRING_H_
+#define WIRING_H_
+
+#include <NDAPI.h>
+#include <linear.h>
+#include <budget.h>
+
+//motor directions
+#define FORWARD  false	//positive velocity turns the motor forward
+#define REVERSED true	//positive velocity turns the motor backward
+
+//motor types, the linearization table of each
+#define TWO_WIRE NULL	//393 motor driven with its command as it is, no table
+
+//motors: global name, port, direction, type; the Motor Controller 29 ports stay TWO_WIRE
+//until linear_characterize() has measured a table for them on the robot
+#define WIRING_MOTORS(X) \
+	X(motor1,  PORT_1,  REVERSED, TWO_WIRE) \
+	X(motor2,  PORT_2,  FORWARD,  TWO_WIRE) \
+	X(motor3,  PORT_3,  FORWARD,  TWO_WIRE) \
+	X(motor4,  PORT_4,  REVERSED, TWO_WIRE) \
+	X(motor5,  PORT_5,  FORWARD,  TWO_WIRE) \
+	X(motor6,  PORT_6,  REVERSED, TWO_WIRE) \
+	X(motor7,  PORT_7,  REVERSED, TWO_WIRE) \
+	X(motor8,  PORT_8,  FORWARD,  TWO_WIRE) \
+	X(motor9,  PORT_9,  REVERSED, TWO_WIRE) \
+	X(motor10, PORT_10, REVERSED, TWO_WIRE)
+
+//motor systems: member of Robot, slew limit of its motors, current budget priority, motors from the motor table
+#define WIRING_SYSTEMS(X) \
+	X(PTO,        3,  BUDGET_MID,  WIRED(motor4), WIRED(motor5), WIRED(motor8), WIRED(motor9)) \
+	X(intake,     12, BUDGET_LOW,  WIRED(motor1), WIRED(motor10)) \
+	X(leftDrive,  8,  BUDGET_HIGH, WIRED(motor2), WIRED(motor3)) \
+	X(rightDrive, 8,  BUDGET_HIGH, WIRED(motor6), WIRED(motor7))
+
+//sensors: member of Robot, type, port, second port of two port sensors or 0
+#define WIRING_SENSORS(X) \
+	X(wheelEncoder,    QME,  DGTL_1, DGTL_2) \
+	X(puncherEncoder,  QME,  DGTL_3, DGTL_4) \
+	X(wheelDetector,   LINE, IN_2,   0) \
+	X(puncherDetector, LINE, IN_3,   0)
+
+//digital outputs driven directly rather than through a Sensor
+#define WIRING_PTO_SOLENOID DGTL_12	//switches the PTO between the puncher and the flywheel
+
+//facts about a sensor type, constant expressions
+#define WIRING_SIZE(type)    ((type) == QME || (type) == USRF ? 2 : 1)						//ports the type uses
+#define WIRING_ANALOG(type)  ((type) == GYRO || ((type) >= POT && (type) <= LIGHT))		//flag for analog types
+#define WIRING_DIGITAL(type) (!WIRING_ANALOG(type) && (type) != IME)						//flag for digital types
+
+void wiring_init();	//set up the motors and sensors of the wiring tables
+
+#endif /* WIRING_H_ */
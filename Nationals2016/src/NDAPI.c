@@ -26,6 +26,7 @@
  */
 
 #include <NDAPI.h>
+#include <trace.h>
 
 // -------------------------------------- Motor ------------------------------------------------
 
@@ -63,24 +64,7 @@ bool motor_reverse(Motor* target){
  * @param velocity The desired velocity of the motor.
  */
 void motor_setVelocity(Motor* target, int velocity){
-
-	//input velocity is over max limit
-	if(velocity > 127)
-		velocity = 127;
-
-	//input velocity is below min limit
-	else if(velocity < -127)
-		velocity = -127;
-
-	target->velocity = velocity;	//assign the velocity for the motor
-
-	//reversed
-	if(target->reversed)
-		motorSet(target->port, -target->velocity);	//set the velocity for the motor
-
-	//not reversed
-	else
-		motorSet(target->port, target->velocity);	//set the velocity for the motor
+	motor_set(target, velocity);
 }
 
 /*
@@ -90,7 +74,7 @@ void motor_setVelocity(Motor* target, int velocity){
  * @return The current velocity of the motor.
  */
 int motor_getVelocity(Motor target){
-	return target.velocity;
+	return motor_velocity(&target);
 }
 
 /*
@@ -100,7 +84,7 @@ int motor_getVelocity(Motor target){
  * @return The port of the motor.
  */
 int motor_getPort(Motor target){
-	return target.port;
+	return motor_port(&target);
 }
 
 /*
@@ -110,7 +94,7 @@ int motor_getPort(Motor target){
  * @return The reversed state of the motor.
  */
 bool motor_isReversed(Motor target){
-	return target.reversed;
+	return motor_reversed(&target);
 }
 
 /*
@@ -145,7 +129,7 @@ void motor_setFor(Motor* target, int velocity, unsigned int time){
  */
 void motor_setTill(Motor* target, Sensor* obs, int velocity, int val){
 	motor_setVelocity(target, velocity);	//set motor velocity
-	while(sensor_getValue(*obs) != val);	//run motor until sensor value is reached
+	while(sensor_read(obs) != val);		//run motor until sensor value is reached
 	motor_stop(target);						//stop motor
 }
 
@@ -160,8 +144,8 @@ void motor_setTill(Motor* target, Sensor* obs, int velocity, int val){
 void motor_setTillPID(Motor* target, Sensor* obs, double k, int val){
 
 	//update motor in PID loop until sensor target value is near
-	while(abs(sensor_getValue(*obs)) != val || (val - sensor_getValue(*obs)) * k < 10)
-		motor_setVelocity(target, (val - sensor_getValue(*obs)) * k );
+	while(abs(sensor_read(obs)) != val || (val - sensor_read(obs)) * k < 10)
+		motor_setVelocity(target, (val - sensor_read(obs)) * k );
 
 	motor_stop(target);	//stop motor
 }
@@ -176,12 +160,7 @@ void motor_setTillPID(Motor* target, Sensor* obs, double k, int val){
  *	@return If the motor system contains the motor.
  */
 bool motorSystem_contains(MotorSystem target, Motor m){
-
-	//search for motor
-	for(int i = 0; i < motorSystem_getSize(target); i++)
-		if(target.motors[i].port == m.port)
-			return true;
-	return false;
+	return motorSystem_has(&target, &m);
 }
 
 /*
@@ -223,20 +202,7 @@ MotorSystem motorSystem_init(const int motors, Motor* m, ...){
  *	@param velocity The new velocity for the motor system.
  */
 void motorSystem_setVelocity(MotorSystem* target, int velocity){
-
-	//input velocity is over max limit
-	if(velocity > 127)
-		velocity = 127;
-
-	//input velocity is below min limit
-	else if(velocity < -127)
-		velocity = -127;
-
-	target->velocity = velocity;	//set the new motor system velocity
-
-	//set the new velocity for the motors
-	for(int i = 0; i < target->size; i++)
-			motor_setVelocity(&target->motors[i], target->velocity);
+	motorSystem_set(target, velocity);
 }
 
 /*
@@ -246,7 +212,7 @@ void motorSystem_setVelocity(MotorSystem* target, int velocity){
  *	@return The velocity of the motor system.
  */
 int motorSystem_getVelocity(MotorSystem target){
-	return target.velocity;
+	return motorSystem_velocity(&target);
 }
 
 /*
@@ -256,7 +222,7 @@ int motorSystem_getVelocity(MotorSystem target){
  *	@return The size of the motor system.
  */
 int motorSystem_getSize(MotorSystem target){
-	return target.size;
+	return motorSystem_size(&target);
 }
 
 /*
@@ -291,7 +257,7 @@ void motorSystem_setFor(MotorSystem* target, int velocity, unsigned int time){
  */
 void motorSystem_setTill(MotorSystem* target, Sensor* obs, int velocity, int val){
 	motorSystem_setVelocity(target, velocity);	//set motor system velocity
-	while(sensor_getValue(*obs) != val);		//run motor system until sensor value is reached
+	while(sensor_read(obs) != val);			//run motor system until sensor value is reached
 	motorSystem_stop(target);					//stop motor system
 }
 
@@ -306,14 +272,76 @@ void motorSystem_setTill(MotorSystem* target, Sensor* obs, int velocity, int val
 void motorSystem_setTillPID(MotorSystem* target, Sensor* obs, double k, int val){
 
 	//update motor system in PID loop until sensor target value is near
-	while(abs(sensor_getValue(*obs)) != val || (val - sensor_getValue(*obs)) * k < 10)
-		motorSystem_setVelocity(target, (val - sensor_getValue(*obs)) * k );
+	while(abs(sensor_read(obs)) != val || (val - sensor_read(obs)) * k < 10)
+		motorSystem_setVelocity(target, (val - sensor_read(obs)) * k );
 
 	motorSystem_stop(target);	//stop motor system
 }
 
 // ---------------------------------------- Sensor ---------------------------------------------
 
+/*
+ * Readers and resetters for each type of sensor. sensor_start() picks the
+ * ones for a sensor's type, so reading or resetting it does not test the
+ * type again.
+ */
+
+//integrated motor encoder
+static int readIME(const Sensor* target){
+	int value = 0;						//holds integrated motor encoder value
+	imeGet(target->ports[0], &value);	//retrieve value from integrated motor encoder
+	return value;
+}
+
+//2-wire quadrature motor encoder
+static int readQME(const Sensor* target){
+	return encoderGet(target->sensor);
+}
+
+//ultrasonic sensor
+static int readUSRF(const Sensor* target){
+	return ultrasonicGet(target->sensor);
+}
+
+//gyroscope
+static int readGyro(const Sensor* target){
+	return gyroGet(target->sensor);
+}
+
+//analog sensor
+static int readAnalog(const Sensor* target){
+	return analogRead(target->ports[0]);
+}
+
+//digital sensor
+static int readDigital(const Sensor* target){
+	return digitalRead(target->ports[0]);
+}
+
+//integrated motor encoder
+static void resetIME(Sensor* target){
+	imeReset(target->ports[0]);
+}
+
+//2-wire quadrature motor encoder
+static void resetQME(Sensor* target){
+	encoderReset(target->sensor);
+}
+
+//gyroscope
+static void resetGyro(Sensor* target){
+	gyroReset(target->sensor);
+}
+
+//regular analog sensors cannot be reset
+static void resetAnalog(Sensor* target){
+}
+
+//other digital sensors
+static void resetDigital(Sensor* target){
+	sensor_set(target, 0);
+}
+
 /*
  * Set up and initialize the sensor.
  *
@@ -348,55 +376,98 @@ Sensor sensor_init(int sensorType, int port, ...){
 		port = va_arg(param, int);	//get the next parameter
 	}
 
+	int multiplier = sensor_getType(tmp) == GYRO ? va_arg(param, int) : 0;	//user defined gyro multiplier
+
+	va_end(param);					//end the list of parameters
+	sensor_start(&tmp, multiplier);	//set up the sensor's hardware
+	return tmp;						//ports stay allocated, analog and digital reads use them
+}
+
+/*
+ * Set up the hardware of a sensor whose type and ports are already set,
+ * such as one filled in at compile time from wiring.h.
+ *
+ * @param target The sensor being set up.
+ * @param multiplier The gyro multiplier, 0 for the default. Unused by other sensors.
+ */
+void sensor_start(Sensor* target, int multiplier){
+
 	//initialize gyro sensor
-	if(sensor_getType(tmp) == GYRO){
-		tmp.sensor = gyroInit(tmp.ports[0], va_arg(param, int));	//set sensor to Gyro with user defined multiplier
-		tmp.analog = true;											//is an analog sensor
+	if(target->type == GYRO){
+		target->sensor = gyroInit(target->ports[0], multiplier);	//set sensor to Gyro with user defined multiplier
+		target->analog = true;										//is an analog sensor
 	}
 
 	//initialize integrated motor encoder on I2C
-	else if(tmp.type == IME){
-		tmp.sensor = NULL;	//set the sensor to null
-		tmp.analog = false;	//not an analog sensor
+	else if(target->type == IME){
+		target->sensor = NULL;	//set the sensor to null
+		target->analog = false;	//not an analog sensor
 	}
 
 	//initialize quadrature motor encoder
-	else if(tmp.type == QME){
-		tmp.sensor = encoderInit(tmp.ports[0], tmp.ports[1], tmp.opposite);	//set sensor to be an encoder
-		tmp.analog = false;													//not an analog sensor
+	else if(target->type == QME){
+		digital_setMode(target->ports[0], INPUT);	//both ports are inputs
+		digital_setMode(target->ports[1], INPUT);
+		target->sensor = encoderInit(target->ports[0], target->ports[1], target->opposite);	//set sensor to be an encoder
+		target->analog = false;																//not an analog sensor
 	}
 
 	//initialize ultrasonic range finder
-	else if(tmp.type == USRF){
-		tmp.sensor = ultrasonicInit(tmp.ports[0], tmp.ports[1]);	//set sensor to be an ultrasonic range finder
-		tmp.analog = false;											//not an analog sensor
+	else if(target->type == USRF){
+		digital_setMode(target->ports[0], INPUT);	//echo port is an input
+		digital_setMode(target->ports[1], OUTPUT);	//ping port is an output
+		target->sensor = ultrasonicInit(target->ports[0], target->ports[1]);	//set sensor to be an ultrasonic range finder
+		target->analog = false;												//not an analog sensor
 	}
 
 	//intialize standard analog input sensor type
-	else if(tmp.type >= POT && tmp.type <= LIGHT){
-		tmp.sensor = NULL;						//set the sensor to null
-		pinMode(tmp.ports[0], INPUT_ANALOG);	//set up IO port for analog reading
-		tmp.analog = true;						//is an analog sensor
+	else if(target->type >= POT && target->type <= LIGHT){
+		target->sensor = NULL;						//set the sensor to null
+		pinMode(IN_PIN(target->ports[0]), INPUT_ANALOG);	//set up IO port for analog reading
+		target->analog = true;						//is an analog sensor
 	}
 
 	//initialize standard digital input sensor type
-	else if(tmp.type >= BUMP && tmp.type <= LIM){
-		tmp.sensor = NULL;				//set the sensor to null
-		pinMode(tmp.ports[0], INPUT);	//set up IO port for digital reading
-		tmp.analog = false;				//not an analog sensor
+	else if(target->type >= BUMP && target->type <= LIM){
+		target->sensor = NULL;				//set the sensor to null
+		digital_setMode(target->ports[0], INPUT);	//set up IO port for digital reading
+		target->analog = false;				//not an analog sensor
 	}
 
 	//initialize standard digital input sensor type
-	else if(tmp.type >= LED && tmp.type <= SOL){
-		tmp.sensor = NULL;				//set the sensor to null
-		pinMode(tmp.ports[0], OUTPUT);	//set up IO port for digital writing
-		tmp.analog = false;				//not an analog sensor
+	else if(target->type >= LED && target->type <= SOL){
+		target->sensor = NULL;				//set the sensor to null
+		digital_setMode(target->ports[0], OUTPUT);	//set up IO port for digital writing
+		target->analog = false;				//not an analog sensor
 	}
 
-	va_end(param);		//end the list of parameters
-	sensor_reset(&tmp);	//reset the sensor
-	free(tmp.ports);	//give back memmory
-	return tmp;
+	//pick the reader and resetter for the type
+	if(target->type == IME){
+		target->read = readIME;
+		target->reset = resetIME;
+	}
+	else if(target->type == QME){
+		target->read = readQME;
+		target->reset = resetQME;
+	}
+	else if(target->type == USRF){
+		target->read = readUSRF;
+		target->reset = resetDigital;
+	}
+	else if(target->type == GYRO){
+		target->read = readGyro;
+		target->reset = resetGyro;
+	}
+	else if(target->analog){
+		target->read = readAnalog;
+		target->reset = resetAnalog;
+	}
+	else{
+		target->read = readDigital;
+		target->reset = resetDigital;
+	}
+
+	sensor_reset(target);	//reset the sensor
 }
 
 /*
@@ -419,21 +490,9 @@ void sensor_set(Sensor* target, int value){
  */
 void sensor_reset(Sensor* target){
 
-	//reset integrated motor encoder
-	if(target->type == IME)
-		imeReset(target->ports[0]);
-
-	//reset 2-wire quadrature motor encoder
-	else if(target->type == QME)
-		encoderReset(target->sensor);
-
-	//reset gyro
-	else if(target->type == GYRO)
-		gyroReset(target->sensor);
-
-	//reset other sensors (regular analog sensors cannot be reset)
-	else if(!sensor_isAnalog(*target))
-		sensor_set(target, 0);
+	//a sensor that was never set up, such as one not wired, has nothing to reset
+	if(target->reset != NULL)
+		target->reset(target);	//resetter set up for the sensor's type
 }
 
 /*
@@ -469,7 +528,7 @@ bool sensor_isOpposite(Sensor target){
  * @return The sensor type.
  */
 int sensor_getType(Sensor target){
-	return target.type;
+	return sensor_type(&target);
 }
 
 /*
@@ -479,7 +538,7 @@ int sensor_getType(Sensor target){
  * @return The amount of ports the sensor uses.
  */
 int sensor_getSize(Sensor target){
-	return target.size;
+	return sensor_size(&target);
 }
 
 /*
@@ -489,29 +548,7 @@ int sensor_getSize(Sensor target){
  * @return The most current sensor value.
  */
 int sensor_getValue(Sensor target){
-
-	//integrated motor encoder
-	if(target.type == IME){
-		int value = 0;						//holds integrated motor encoder value
-		imeGet(target.ports[0], &value);	//retrieve value from integrated motor encoder
-		return value;
-	}
-
-	//2-wire quadrature motor encoder
-	else if(target.type == QME)
-		return encoderGet(target.sensor);
-
-	//ultrasonic sensor
-	else if(target.type == USRF)
-		return ultrasonicGet(target.sensor);
-
-	//analog sensor
-	else if(sensor_isAnalog(target))
-		return analogRead(target.ports[0]);
-
-	//digital sensor
-	else
-		return digitalRead(target.ports[0]);
+	return sensor_read(&target);
 }
 
 /*
@@ -521,7 +558,7 @@ int sensor_getValue(Sensor target){
  * @return The state of the analog flag.
  */
 bool sensor_isAnalog(Sensor target){
-	return target.analog;
+	return sensor_analog(&target);
 }
 
 // ------------------------------------- Sensor System -----------------------------------------
@@ -576,6 +613,12 @@ SensorSystem sensorSystem_init(const int sensors, Sensor* sensor, ...){
 		sensor = va_arg(param, Sensor*);	//get the next parameter
 	}
 
+	//sensors all of one type share a reader
+	tmp.read = tmp.size > 0 ? tmp.sensors[0].read : NULL;
+	for(int i = 1; i < tmp.size; i++)
+		if(tmp.sensors[i].read != tmp.read)
+			tmp.read = NULL;
+
 	va_end(param);				//end the list of parameters
 	sensorSystem_reset(&tmp);	//reset all the sensors in the sensor system
 	return tmp;
@@ -590,7 +633,7 @@ SensorSystem sensorSystem_init(const int sensors, Sensor* sensor, ...){
 void sensorSystem_set(SensorSystem* target, int value){
 
 	//set the value of the sensor system
-	for(int i = 0; i < sensorSystem_getSize(*target); i++)
+	for(int i = 0; i < sensorSystem_size(target); i++)
 		sensor_set(&target->sensors[i], value);
 }
 
@@ -602,7 +645,7 @@ void sensorSystem_set(SensorSystem* target, int value){
 void sensorSystem_reset(SensorSystem* target){
 
 	//reset sensor system
-	for(int i = 0; i < sensorSystem_getSize(*target); i++)
+	for(int i = 0; i < sensorSystem_size(target); i++)
 		sensor_reset(&target->sensors[i]);
 }
 
@@ -613,7 +656,7 @@ void sensorSystem_reset(SensorSystem* target){
  * @return The number of sensors in the system.
  */
 int sensorSystem_getSize(SensorSystem target){
-	return target.size;
+	return sensorSystem_size(&target);
 }
 
 /*
@@ -623,18 +666,79 @@ int sensorSystem_getSize(SensorSystem target){
  * @return The average current sensor value.
  */
 int sensorSystem_getValue(SensorSystem target){
+	return sensorSystem_read(&target);
+}
 
-	//no sensors to pull values from
-	if(sensorSystem_getSize(target) == 0)
-		return 0;
+// ------------------------------------- Digital Ports -----------------------------------------
 
-	int value = 0;	//the sum of all the sensor values
+static unsigned int outputPorts = 0;	//mask of the digital ports set up as outputs
 
-	//get the sum of the sensor values
-	for(int i = 0; i < sensorSystem_getSize(target); i++)
-		value += sensor_getValue(target.sensors[i]);
+/*
+ * Set the mode of a digital port, keeping track of which ports are
+ * outputs. Every digital port the robot uses should be set up here or
+ * by sensor_init().
+ *
+ * @param port The digital port.
+ * @param mode INPUT, INPUT_FLOATING, OUTPUT or OUTPUT_OD.
+ */
+void digital_setMode(unsigned char port, unsigned char mode){
+
+	pinMode(port, mode);	//set up the port
 
-	return value / sensorSystem_getSize(target);	//return the average sensor value
+	//not a digital port
+	if(port < DGTL_1 || port > DGTL_12)
+		return;
+
+	if(mode == OUTPUT || mode == OUTPUT_OD)
+		outputPorts |= DGTL_MASK(port);
+	else
+		outputPorts &= ~DGTL_MASK(port);
+}
+
+/*
+ * Retrieve the digital ports set up as outputs.
+ *
+ * @return The mask of output ports.
+ */
+unsigned int digital_getOutputs(){
+	return outputPorts;
+}
+
+/*
+ * Read a set of digital ports in one pass. Ports outside the mask are
+ * not read and come back as 0.
+ *
+ * @param mask The mask of ports to read, DGTL_ALL for every port.
+ * @return The mask of ports that are high.
+ */
+unsigned int digital_read(unsigned int mask){
+
+	unsigned int values = 0;	//ports read high
+
+	//each port in the mask, lowest first
+	for(mask &= DGTL_ALL; mask != 0; mask &= mask - 1){
+		int bit = __builtin_ctz(mask);	//lowest port left
+		if(digitalRead(DGTL_1 + bit))
+			values |= 1u << bit;
+	}
+
+	return values;
+}
+
+/*
+ * Write a set of digital ports in one pass. Only ports set up as outputs
+ * are written, the rest of the mask is ignored.
+ *
+ * @param mask The mask of ports to write.
+ * @param values The mask of ports to set high, the others in the mask are set low.
+ */
+void digital_write(unsigned int mask, unsigned int values){
+
+	//each output port in the mask, lowest first
+	for(mask &= outputPorts; mask != 0; mask &= mask - 1){
+		int bit = __builtin_ctz(mask);	//lowest port left
+		digitalWrite(DGTL_1 + bit, (values >> bit) & 1);
+	}
 }
 
 // ------------------------------------------ LCD ----------------------------------------------
@@ -818,7 +922,9 @@ void lcd_centerPrint(LCD* lcd, unsigned char line, const char* buffer){
  * @return The button being pressed.
  */
 int lcd_buttonPressed(LCD lcd){
+	TRACE_BEGIN("lcd_buttonPressed");
 	delay(25);							//delay to allow lcd to read button
+	TRACE_END("lcd_buttonPressed");
 	return lcdReadButtons(lcd.port);
 }
 
@@ -38,6 +38,8 @@
  */
 
 #include "main.h"
+#include "script.h"
+#include "trace.h"
 
 /*
  * Runs the user autonomous code. This function will be started in its own task with the default
@@ -54,7 +56,13 @@
  * so, the robot will await a switch to another mode or disable/enable cycle.
  */
 void autonomous() {
+	TRACE_TASK("autonomous");
 	lcd_centerPrint(&Robot.lcd, TOP, "Autonomous Mode");	//print to lcd
 	lcd_centerPrint(&Robot.lcd, BOTTOM, "ACTIVE");			//print to lcd
-	robot_replay();											//replay the correct autonomous
+
+	//run the scripted routine for this slot, fall back to the recorded one
+	TRACE_BEGIN("autonomous");
+	if(!script_runSlot())
+		robot_replay();
+	TRACE_END("autonomous");
 }
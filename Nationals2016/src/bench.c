@@ -0,0 +1,153 @@
+/*
+ * @file bench.c
+ *
+ * @brief Implementation of the driver control microbenchmarks.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <bench.h>
+
+#ifdef BENCHMARK
+
+static SensorSystem flywheelSensors;	//both launcher encoders, for the sensor system reads
+static volatile int sink;				//keeps sensor reads from being optimized out
+
+/*
+ * Group the launcher encoders into a sensor system.
+ */
+static void setupSensorSystem(){
+	if(sensorSystem_getSize(flywheelSensors) == 0)
+		flywheelSensors = sensorSystem_init(2, &Robot.wheelEncoder, &Robot.puncherEncoder);
+}
+
+static void runUserControl(){
+	userControl();
+}
+
+static void runJoyDrive(){
+	robot_joyDrive(DRIVER);
+}
+
+static void runSetVelocity(){
+	motorSystem_setVelocity(&Robot.PTO, 0);
+}
+
+static void runSet(){
+	motorSystem_set(&Robot.PTO, 0);
+}
+
+static void runStop(){
+	motorSystem_stop(&Robot.intake);
+}
+
+static void runEncoder(){
+	sink = sensor_getValue(Robot.wheelEncoder);
+}
+
+static void runReadEncoder(){
+	sink = sensor_read(&Robot.wheelEncoder);
+}
+
+static void runLineSensor(){
+	sink = sensor_getValue(Robot.wheelDetector);
+}
+
+static void runSensorSystem(){
+	sink = sensorSystem_getValue(flywheelSensors);
+}
+
+static void runReadSensorSystem(){
+	sink = sensorSystem_read(&flywheelSensors);
+}
+
+static void runLcdPrint(){
+	lcd_print(&Robot.lcd, TOP, "Benchmark");
+}
+
+//benchmarks, userControl() waits on the LCD so it gets few iterations
+static const Benchmark benchmarks[] = {
+	{"userControl", NULL, runUserControl, 20},
+	{"robot_joyDrive", NULL, runJoyDrive, 1000},
+	{"motorSystem_setVelocity", NULL, runSetVelocity, 1000},
+	{"motorSystem_set", NULL, runSet, 1000},
+	{"motorSystem_stop", NULL, runStop, 1000},
+	{"sensor_getValue(QME)", NULL, runEncoder, 1000},
+	{"sensor_read(QME)", NULL, runReadEncoder, 1000},
+	{"sensor_getValue(LINE)", NULL, runLineSensor, 1000},
+	{"sensorSystem_getValue", setupSensorSystem, runSensorSystem, 1000},
+	{"sensorSystem_read", setupSensorSystem, runReadSensorSystem, 1000},
+	{"lcd_print", NULL, runLcdPrint, 1000}
+};
+
+/*
+ * Retrieve the number of benchmarks.
+ *
+ * @return The number of benchmarks.
+ */
+int bench_count(){
+	return sizeof(benchmarks) / sizeof(Benchmark);
+}
+
+/*
+ * Retrieve a benchmark.
+ *
+ * @param index The benchmark's index.
+ * @return The benchmark, NULL if the index is out of range.
+ */
+const Benchmark* bench_get(int index){
+	return index >= 0 && index < bench_count() ? &benchmarks[index] : NULL;
+}
+
+/*
+ * Run a benchmark.
+ *
+ * @param b The benchmark.
+ * @return The time all of its iterations took in us.
+ */
+unsigned long bench_time(const Benchmark* b){
+
+	if(b->setup != NULL)
+		b->setup();
+
+	unsigned long start = micros();	//time the benchmark began
+	for(int i = 0; i < b->iterations; i++)
+		b->run();
+
+	return micros() - start;
+}
+
+/*
+ * Time every benchmark and print the time per call, then how much of the
+ * driver control loop userControl() takes.
+ */
+void bench_report(){
+
+	unsigned long loop = 0;	//time of one userControl() call in us
+
+	printf("benchmark                  us/call\n");
+	for(int i = 0; i < bench_count(); i++){
+		const Benchmark* b = bench_get(i);
+		unsigned long total = bench_time(b);
+		printf("%-26s %7lu.%02lu\n", b->name, total / b->iterations, total * 100 / b->iterations % 100);
+		if(b->run == runUserControl)
+			loop = total / b->iterations;
+	}
+
+	printf("driver loop: userControl %lu us of a %lu us tick\n", loop, loop + BENCH_LOOP_PERIOD * 1000);
+}
+
+#endif /* BENCHMARK */
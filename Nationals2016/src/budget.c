@@ -0,0 +1,200 @@
+/*
+ * @file budget.c
+ *
+ * @brief Implementation of the motor current and breaker heat budget.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <budget.h>
+#include <fixmath.h>
+
+//motor port data structure
+struct{
+	int priority;				//BUDGET_ priority
+	float speed;				//speed as a share of free speed at BUDGET_VOLTAGE
+	volatile float measured;	//last speed passed in
+	volatile unsigned long at;	//time in ms the speed was passed in, 0 for never
+	float current;				//estimated current in A
+	float heat;					//heat of the motor's own breaker, 1 trips it
+	volatile int scale;			//Q15 share of its output the port is held to
+} typedef BudgetPort;
+
+static BudgetPort ports[BUDGET_PORTS] = {[0 ... BUDGET_PORTS - 1] = {.priority = BUDGET_HIGH, .scale = FIX_ONE}};
+static float bankHeat[BUDGET_BANKS];	//heat of each Cortex breaker, 1 trips it
+
+/*
+ * Set the priority of a motor port.
+ *
+ * @param port The motor port.
+ * @param priority BUDGET_LOW, BUDGET_MID or BUDGET_HIGH.
+ */
+void budget_setPriority(unsigned char port, int priority){
+
+	if(port < 1 || port > BUDGET_PORTS || priority < 0 || priority >= BUDGET_LEVELS)
+		return;
+
+	ports[port - 1].priority = priority;
+}
+
+/*
+ * Retrieve the priority of a motor port.
+ *
+ * @param port The motor port.
+ * @return The priority, BUDGET_HIGH if there is no such port.
+ */
+int budget_getPriority(unsigned char port){
+	return port >= 1 && port <= BUDGET_PORTS ? ports[port - 1].priority : BUDGET_HIGH;
+}
+
+/*
+ * Pass in the measured speed of a motor system's motors, used in place
+ * of the estimate for BUDGET_SPEED_HOLD ms.
+ *
+ * @param system The motor system.
+ * @param share The speed as a share of the motors' free speed at BUDGET_VOLTAGE, positive forward.
+ */
+void budget_setSpeed(const MotorSystem* system, float share){
+
+	unsigned long now = millis() | 1;	//never 0
+
+	for(int i = 0; i < motorSystem_size(system); i++){
+		const Motor* m = &system->motors[i];
+		if(motor_port(m) < 1 || motor_port(m) > BUDGET_PORTS)
+			continue;
+
+		BudgetPort* p = &ports[motor_port(m) - 1];
+		p->measured = motor_reversed(m) ? -share : share;
+		p->at = now;
+	}
+}
+
+/*
+ * Turn a breaker's heat into how far its outputs are derated.
+ *
+ * @param heat The heat.
+ * @return 0 below BUDGET_DERATE_START to 1 at BUDGET_DERATE_FULL.
+ */
+static float derating(float heat){
+
+	float d = (heat - BUDGET_DERATE_START) / (BUDGET_DERATE_FULL - BUDGET_DERATE_START);
+	return d < 0 ? 0 : d > 1 ? 1 : d;
+}
+
+/*
+ * Estimate the current of every motor and the heat of every breaker
+ * over a budget period, then the share of its output each port is held
+ * to. Called every BUDGET_PERIOD ms by the output task.
+ *
+ * @param outputs The command written to each port, port 1 first, in the motor's direction.
+ * @param battery The battery voltage in mV.
+ */
+void budget_update(const int* outputs, unsigned int battery){
+
+	float volts = battery / 1000.0;									//battery voltage
+	float spin = (float) BUDGET_PERIOD / BUDGET_SPIN_UP;				//share of the speed change each period
+	float lag = (float) BUDGET_PERIOD / BUDGET_HEAT_LAG;				//share of the heat change each period
+	float banks[BUDGET_BANKS] = {0};									//current through each Cortex breaker
+	unsigned long now = millis();
+
+	//motors
+	for(int i = 0; i < BUDGET_PORTS; i++){
+		BudgetPort* p = &ports[i];
+		float share = outputs[i] / 127.0;	//share of the battery voltage applied
+
+		//measured speed, or the free running speed the output leads to
+		unsigned long at = p->at;
+		if(at != 0 && now - at <= BUDGET_SPEED_HOLD)
+			p->speed = p->measured;
+		else
+			p->speed += (share * volts / BUDGET_VOLTAGE - p->speed) * spin;
+
+		p->current = (share * volts - p->speed * BUDGET_BACK_EMF) / BUDGET_RESISTANCE;
+		float amps = p->current < 0 ? -p->current : p->current;
+		p->heat += (amps * amps / (BUDGET_MOTOR_TRIP * BUDGET_MOTOR_TRIP) - p->heat) * lag;
+		banks[i * BUDGET_BANKS / BUDGET_PORTS] += amps;
+	}
+
+	//Cortex breakers
+	for(int b = 0; b < BUDGET_BANKS; b++)
+		bankHeat[b] += (banks[b] * banks[b] / (BUDGET_BANK_TRIP * BUDGET_BANK_TRIP) - bankHeat[b]) * lag;
+
+	//a hot bank derates its lowest priority ports all the way before the next, a hot motor only itself
+	for(int i = 0; i < BUDGET_PORTS; i++){
+		BudgetPort* p = &ports[i];
+		float bank = derating(bankHeat[i * BUDGET_BANKS / BUDGET_PORTS]) * BUDGET_LEVELS - p->priority;
+		float own = derating(p->heat);
+		float cut = bank < 0 ? 0 : bank > 1 ? 1 : bank;
+		cut = own > cut ? own : cut;
+
+		p->scale = (1 - cut * (1 - BUDGET_FLOOR)) * FIX_ONE;
+	}
+}
+
+/*
+ * Scale an output down for the heat behind its port.
+ *
+ * @param port The motor port.
+ * @param output The output.
+ * @return The derated output.
+ */
+int budget_derate(unsigned char port, int output){
+
+	if(port < 1 || port > BUDGET_PORTS)
+		return output;
+
+	return fix_mul(output, ports[port - 1].scale);
+}
+
+/*
+ * Retrieve the estimated current of a motor port.
+ *
+ * @param port The motor port.
+ * @return The current in A, negative driving the motor backwards.
+ */
+float budget_getCurrent(unsigned char port){
+	return port >= 1 && port <= BUDGET_PORTS ? ports[port - 1].current : 0;
+}
+
+/*
+ * Retrieve the heat of a motor's own breaker.
+ *
+ * @param port The motor port.
+ * @return The heat, 1 at the trip point.
+ */
+float budget_getMotorHeat(unsigned char port){
+	return port >= 1 && port <= BUDGET_PORTS ? ports[port - 1].heat : 0;
+}
+
+/*
+ * Retrieve the heat of a Cortex breaker.
+ *
+ * @param bank 0 for ports 1 to 5, 1 for ports 6 to 10.
+ * @return The heat, 1 at the trip point.
+ */
+float budget_getBankHeat(int bank){
+	return bank >= 0 && bank < BUDGET_BANKS ? bankHeat[bank] : 0;
+}
+
+/*
+ * Retrieve the share of its output a motor port is held to.
+ *
+ * @param port The motor port.
+ * @return The share, from BUDGET_FLOOR to 1.
+ */
+float budget_getScale(unsigned char port){
+	return port >= 1 && port <= BUDGET_PORTS ? (float) ports[port - 1].scale / FIX_ONE : 1;
+}
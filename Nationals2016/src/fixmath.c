@@ -0,0 +1,201 @@
+/*
+ * @file fixmath.c
+ *
+ * @brief Implementation of the CORDIC integer trigonometry.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <API.h>
+#include <fixmath.h>
+
+#define CORDIC_STEPS 16				//number of CORDIC iterations
+#define CORDIC_GAIN  652032874		//1 / CORDIC gain in Q30
+
+//atan(2^-i) where 2^32 is one revolution
+static const int atanTable[CORDIC_STEPS] = {
+	536870912, 316933406, 167458907, 85004756, 42667331, 21354465, 10679838, 5340245,
+	2670163, 1335087, 667544, 333772, 166886, 83443, 41722, 20861
+};
+
+/*
+ * Wrap an angle into the range of half a turn either way.
+ *
+ * @param angle The angle in binary angle units.
+ * @return The equivalent angle from -FIX_TURN/2 to FIX_TURN/2 - 1.
+ */
+int fix_wrap(int angle){
+	return ((angle + FIX_TURN / 2) & (FIX_TURN - 1)) - FIX_TURN / 2;
+}
+
+/*
+ * Retrieve the sine and cosine of an angle.
+ *
+ * @param angle The angle in binary angle units.
+ * @param sine Where the Q15 sine is stored.
+ * @param cosine Where the Q15 cosine is stored.
+ */
+void fix_sinCos(int angle, int* sine, int* cosine){
+
+	unsigned int z = (unsigned int)angle << 16;	//angle where 2^32 is one revolution
+	int x = CORDIC_GAIN;						//start pre-scaled so the result has unit length
+	int y = 0;
+	bool flip = false;							//rotated half a turn to stay in range
+
+	//CORDIC only converges within a quarter turn, rotate the rest by half a turn
+	if((int)z > (1 << 30) || (int)z < -(1 << 30)){
+		z += 0x80000000u;
+		flip = true;
+	}
+
+	//rotate the unit vector towards the angle
+	for(int i = 0; i < CORDIC_STEPS; i++){
+		int dx = y >> i;
+		int dy = x >> i;
+
+		//rotate counter clockwise
+		if((int)z >= 0){
+			x -= dx;
+			y += dy;
+			z -= atanTable[i];
+		}
+
+		//rotate clockwise
+		else{
+			x += dx;
+			y -= dy;
+			z += atanTable[i];
+		}
+	}
+
+	//round from Q30 to Q15
+	x = (x + (1 << 14)) >> 15;
+	y = (y + (1 << 14)) >> 15;
+
+	*cosine = flip ? -x : x;
+	*sine = flip ? -y : y;
+}
+
+/*
+ * Rotate a vector onto the x axis.
+ *
+ * @param x The x component of the vector, replaced by the scaled length.
+ * @param y The y component of the vector.
+ * @param shift Where the normalization shift is stored.
+ * @return The angle of the vector where 2^32 is one revolution.
+ */
+static unsigned int vector(int* x, int* y, int* shift){
+
+	unsigned int z = 0;	//accumulated angle
+
+	//point the vector into the right half plane
+	if(*x < 0){
+		*x = -*x;
+		*y = -*y;
+		z = 0x80000000u;
+	}
+
+	//normalize so the largest component is between 2^28 and 2^29
+	unsigned int big = (unsigned int)(*x > abs(*y) ? *x : abs(*y));
+	*shift = 0;
+	while(big >= (1u << 29)){
+		big >>= 1;
+		(*shift)--;
+	}
+	while(big < (1u << 28)){
+		big <<= 1;
+		(*shift)++;
+	}
+	if(*shift > 0){
+		*x <<= *shift;
+		*y <<= *shift;
+	}
+	else{
+		*x >>= -*shift;
+		*y >>= -*shift;
+	}
+
+	//rotate the vector until it lies on the x axis
+	for(int i = 0; i < CORDIC_STEPS; i++){
+		int dx = *y >> i;
+		int dy = *x >> i;
+
+		//rotate clockwise
+		if(*y > 0){
+			*x += dx;
+			*y -= dy;
+			z += atanTable[i];
+		}
+
+		//rotate counter clockwise
+		else{
+			*x -= dx;
+			*y += dy;
+			z -= atanTable[i];
+		}
+	}
+
+	return z;
+}
+
+/*
+ * Retrieve the angle of a vector.
+ *
+ * @param y The y component of the vector.
+ * @param x The x component of the vector.
+ * @return The angle of the vector in binary angle units.
+ */
+int fix_atan2(int y, int x){
+
+	//no direction
+	if(x == 0 && y == 0)
+		return 0;
+
+	int shift = 0;	//normalization shift
+	return fix_wrap((int)(vector(&x, &y, &shift) >> 16));
+}
+
+/*
+ * Retrieve the length of a vector.
+ *
+ * @param x The x component of the vector.
+ * @param y The y component of the vector.
+ * @return The length of the vector.
+ */
+int fix_hypot(int x, int y){
+
+	//no length
+	if(x == 0 && y == 0)
+		return 0;
+
+	int shift = 0;	//normalization shift
+	vector(&x, &y, &shift);
+
+	long long length = (long long)x * CORDIC_GAIN;	//remove the CORDIC gain, in Q30
+	shift += 30;									//undo the normalization and the Q30 scale
+	return (int)((length + (1LL << (shift - 1))) >> shift);	//round to the nearest whole length
+}
+
+/*
+ * Multiply a value by a Q15 ratio.
+ *
+ * @param a The value being scaled.
+ * @param q15 The Q15 ratio.
+ * @return The scaled value.
+ */
+int fix_mul(int a, int q15){
+	return (int)(((long long)a * q15) >> 15);
+}
@@ -0,0 +1,185 @@
+/*
+ * @file gains.c
+ *
+ * @brief Implementation of the tunable parameters and the gains file loader.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gains.h>
+#include <stddef.h>
+
+//hand tuned flywheel parameters, used until a gains file replaces them
+static FlywheelGains flywheelGains = {
+	.fireSlope = 0.518,
+	.fireOffset = 30.7,
+	.ballThreshold = 900,
+	.puncherBall = 900,
+	.presetHigh = 110,
+	.presetLow = 80
+};
+
+//where a named parameter lives data structure
+struct{
+	const char* name;	//name in the gains file
+	bool integer;		//flag for an int parameter, otherwise a double
+	int offset;			//byte offset of the parameter in Gains
+} typedef GainField;
+
+static const GainField fields[] = {
+	{"fire.slope", false, offsetof(Gains, flywheel.fireSlope)},
+	{"fire.offset", false, offsetof(Gains, flywheel.fireOffset)},
+	{"fire.ball", true, offsetof(Gains, flywheel.ballThreshold)},
+	{"puncher.ball", true, offsetof(Gains, flywheel.puncherBall)},
+	{"preset.high", true, offsetof(Gains, flywheel.presetHigh)},
+	{"preset.low", true, offsetof(Gains, flywheel.presetLow)},
+	{"lift.kP", false, offsetof(Gains, lift.kP)},
+	{"lift.kI", false, offsetof(Gains, lift.kI)},
+	{"lift.kD", false, offsetof(Gains, lift.kD)},
+	{"lift.kG", true, offsetof(Gains, lift.kG)},
+	{"lift.iLimit", true, offsetof(Gains, lift.iLimit)},
+	{"turn.kP", false, offsetof(Gains, turn.kP)},
+	{"turn.kD", false, offsetof(Gains, turn.kD)},
+	{"turn.minOutput", true, offsetof(Gains, turn.minOutput)}
+};
+
+#define FIELDS (sizeof(fields) / sizeof(GainField))
+
+/*
+ * Parse a decimal number such as -12, 0.518 or 30.7.
+ *
+ * @param text The text, moved past the number.
+ * @param value Set to the number.
+ * @return If a number was found.
+ */
+static bool parseNumber(char** text, double* value){
+
+	char* p = *text;
+	double sign = 1;
+	double scale = 0;	//place value of the next fraction digit, 0 before the point
+	bool digits = false;
+
+	if(*p == '-' || *p == '+')
+		sign = *p++ == '-' ? -1 : 1;
+
+	for(*value = 0; (*p >= '0' && *p <= '9') || (*p == '.' && scale == 0); p++){
+		if(*p == '.')
+			scale = 0.1;
+		else if(scale == 0)
+			*value = *value * 10 + (*p - '0');
+		else{
+			*value += (*p - '0') * scale;
+			scale /= 10;
+		}
+		digits |= *p != '.';
+	}
+
+	*value *= sign;
+	*text = p;
+	return digits;
+}
+
+/*
+ * Retrieve every tunable parameter.
+ *
+ * @return The parameters the controllers currently use.
+ */
+Gains gains_get(){
+	Gains gains;
+	gains.flywheel = flywheelGains;
+	gains.lift = lift_getGains();
+	gains.turn = turn_getGains();
+	return gains;
+}
+
+/*
+ * Hand every tunable parameter to its controller.
+ *
+ * @param gains The new parameters.
+ */
+void gains_set(Gains gains){
+	flywheelGains = gains.flywheel;
+	lift_setGains(gains.lift);
+	turn_setGains(gains.turn);
+}
+
+/*
+ * Retrieve the flywheel rapid fire parameters.
+ *
+ * @return The flywheel rapid fire parameters.
+ */
+FlywheelGains gains_getFlywheel(){
+	return flywheelGains;
+}
+
+/*
+ * Load parameters from a gains file over the current ones. Lines
+ * that are not understood are skipped.
+ *
+ * @param name The name of the file.
+ * @return If the file was found.
+ */
+bool gains_load(const char* name){
+
+	static char text[GAINS_SIZE];	//file contents
+	FILE* file = fopen(name, "r");	//gains file
+
+	//no gains saved
+	if(file == NULL)
+		return false;
+
+	int size = fread(text, 1, GAINS_SIZE - 1, file);
+	fclose(file);
+	text[size] = '\0';
+
+	Gains gains = gains_get();	//parameters not in the file keep their values
+
+	for(char* line = text; *line != '\0';){
+
+		//split off the next line
+		char* end = line;
+		while(*end != '\0' && *end != '\n')
+			end++;
+		char* next = *end == '\0' ? end : end + 1;
+		*end = '\0';
+
+		//name and value
+		while(*line == ' ' || *line == '\t')
+			line++;
+		char* value = line;
+		while(*value != '\0' && *value != ' ' && *value != '\t')
+			value++;
+		int length = value - line;
+		while(*value == ' ' || *value == '\t')
+			value++;
+
+		double number;
+		if(*line != '#' && parseNumber(&value, &number))
+			for(unsigned int i = 0; i < FIELDS; i++)
+				if((int) strlen(fields[i].name) == length && strncmp(fields[i].name, line, length) == 0){
+					char* field = (char*) &gains + fields[i].offset;
+					if(fields[i].integer)
+						*(int*) field = (int) (number < 0 ? number - 0.5 : number + 0.5);
+					else
+						*(double*) field = number;
+				}
+
+		line = next;
+	}
+
+	gains_set(gains);
+	return true;
+}
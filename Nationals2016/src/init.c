@@ -36,6 +36,19 @@
  */
 
 #include "main.h"
+#include "bench.h"
+#include "gains.h"
+#include "latency.h"
+#include "lift.h"
+#include "monitor.h"
+#include "odometry.h"
+#include "output.h"
+#include "pto.h"
+#include "puncher.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "turn.h"
+#include "wiring.h"
 
 /*
  * Runs pre-initialization code. This function will be started in kernel mode one time while the
@@ -46,8 +59,8 @@
  * configure a UART port (usartOpen()) but cannot set up an LCD (lcdInit()).
  */
 void initializeIO() {
-pinMode(12, OUTPUT);
-digitalWrite(12, LOW);
+digital_setMode(WIRING_PTO_SOLENOID, OUTPUT);
+digitalWrite(WIRING_PTO_SOLENOID, LOW);
 }
 
 /*
@@ -65,28 +78,34 @@ digitalWrite(12, LOW);
  */
 Encoder wheelEnc;
 void initialize() {
+	TRACE_TASK("initialize");
+	trace_init();	//dump the event trace at the end of each match
+	monitor_init();	//report processor, stack and memory use
+	output_init();	//ramp the motors to the values asked for
 	robot_init();	//initialize the robot
+	wiring_init();	//motors, motor systems and sensors from the wiring tables
 
-	//motors
-	motor_reverse(&motor4);
-	motor_reverse(&motor9);
-	motor_reverse(&motor6);
-	motor_reverse(&motor7);
-	motor_reverse(&motor1);
-	motor_reverse(&motor10);
-	//motor systems
-	Robot.PTO = motorSystem_init(4, &motor4, &motor5, &motor8, &motor9);
-	Robot.intake = motorSystem_init(2, &motor1, &motor10);
-	Robot.leftDrive = motorSystem_init(2, &motor2, &motor3);
-	Robot.rightDrive = motorSystem_init(2, &motor6, &motor7);
-
-	//sensors
-	Robot.wheelEncoder = sensor_init(QME, 1, 2);
-	Robot.puncherEncoder = sensor_init(QME, 3, 4);
-	Robot.wheelDetector = sensor_init(LINE, 2);
-	Robot.puncherDetector = sensor_init(LINE, 3);
+	//controllers
+	lift_init();	//hold the lift position in the background
+	odom_init();	//track the robot's position on the field
+	turn_init();	//close the loop on the gyro for turns and straight driving
+	pto_init();		//shift the PTO and spin the flywheel up
+	puncher_init();	//cock, hold and fire the puncher
+	TRACE_BEGIN("gains_load");
+	gains_load(GAINS_FILE);	//replace the hand tuned gains with any saved by the autotuner
+	TRACE_END("gains_load");
+	telemetry_init(uart1);	//stream the robot's state out of the UART1 port
 
 	//LCD
 	Robot.lcd = lcd_init(uart2);    //setup the robot's lcd
+	TRACE_BEGIN("robot_lcdMenu");
 	robot_lcdMenu();                //begin robot start up menu
+	TRACE_END("robot_lcdMenu");
+
+#ifdef BENCHMARK
+	bench_report();	//time the driver control hot paths while the robot is disabled
+#endif
+#ifdef LATENCY
+	latency_init();	//time joystick changes to motor changes while the robot is driven
+#endif
 }
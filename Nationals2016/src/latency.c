@@ -0,0 +1,306 @@
+/*
+ * @file latency.c
+ *
+ * @brief Implementation of the joystick to motor latency monitor.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <latency.h>
+#include <monitor.h>
+
+#ifdef LATENCY
+
+#define MAX_INPUTS  4	//most joystick inputs of a path
+#define MAX_OUTPUTS 10	//most motor ports of a path
+
+//state of one control path data structure
+struct{
+	int inputs[MAX_INPUTS];					//inputs when the last change was seen
+	int outputs[MAX_OUTPUTS];				//outputs when the last change was seen
+	bool pending;							//flag for an input change waiting on the motors
+	unsigned long start;					//time in us the input change was seen
+	unsigned long samples[LATENCY_SAMPLES];	//latencies in us, oldest overwritten first
+	int next;								//next sample to write
+	int count;								//samples kept
+	int missed;								//input changes the motors never answered
+} typedef LatencyPath;
+
+static TaskHandle latencyTask = NULL;		//handle of the latency monitor task
+static Mutex lock = NULL;					//guards the samples
+static LatencyPath paths[LATENCY_PATHS];	//state of every control path
+static bool added = false;					//flag for samples added since the last report
+
+static const char* names[LATENCY_PATHS] = {"drive", "intake", "PTO"};
+
+/*
+ * Read the joystick inputs of a control path.
+ *
+ * @param path The control path.
+ * @param inputs The inputs, MAX_INPUTS of them.
+ * @return The number of inputs read.
+ */
+static int readInputs(int path, int* inputs){
+
+	switch(path){
+	case LATENCY_DRIVE:
+		inputs[0] = joystickGetAnalog(1, 2);
+		inputs[1] = joystickGetAnalog(1, 3);
+		return 2;
+	case LATENCY_INTAKE:
+		inputs[0] = joystickGetDigital(1, 5, JOY_UP);
+		inputs[1] = joystickGetDigital(1, 5, JOY_DOWN);
+		inputs[2] = joystickGetDigital(1, 6, JOY_UP);
+		inputs[3] = joystickGetDigital(1, 6, JOY_DOWN);
+		return 4;
+	default:
+		inputs[0] = joystickGetDigital(1, 8, JOY_UP);
+		inputs[1] = joystickGetDigital(1, 8, JOY_DOWN);
+		inputs[2] = joystickGetDigital(1, 8, JOY_LEFT);
+		inputs[3] = joystickGetDigital(1, 8, JOY_RIGHT);
+		return 4;
+	}
+}
+
+/*
+ * Read the motor outputs of a motor system.
+ *
+ * @param system The motor system.
+ * @param outputs The outputs read so far.
+ * @param count The number of outputs read so far.
+ * @return The number of outputs read.
+ */
+static int readSystem(const MotorSystem* system, int* outputs, int count){
+
+	for(int i = 0; i < motorSystem_size(system) && count < MAX_OUTPUTS; i++)
+		outputs[count++] = motorGet(motor_port(&system->motors[i]));
+
+	return count;
+}
+
+/*
+ * Read the motor outputs of a control path.
+ *
+ * @param path The control path.
+ * @param outputs The outputs, MAX_OUTPUTS of them.
+ * @return The number of outputs read.
+ */
+static int readOutputs(int path, int* outputs){
+
+	switch(path){
+	case LATENCY_DRIVE:
+		return readSystem(&Robot.rightDrive, outputs, readSystem(&Robot.leftDrive, outputs, 0));
+	case LATENCY_INTAKE:
+		return readSystem(&Robot.intake, outputs, 0);
+	default:
+		return readSystem(&Robot.PTO, outputs, 0);
+	}
+}
+
+/*
+ * Keep a latency of a control path.
+ *
+ * @param p The control path's state.
+ * @param us The latency in us.
+ */
+static void addSample(LatencyPath* p, unsigned long us){
+
+	mutexTake(lock, -1);
+	p->samples[p->next] = us;
+	p->next = (p->next + 1) % LATENCY_SAMPLES;
+	if(p->count < LATENCY_SAMPLES)
+		p->count++;
+	added = true;
+	mutexGive(lock);
+}
+
+/*
+ * Check a control path for an input change or the motor change answering one.
+ *
+ * @param path The control path.
+ */
+static void checkPath(int path){
+
+	LatencyPath* p = &paths[path];
+	int inputs[MAX_INPUTS];
+	int outputs[MAX_OUTPUTS];
+	int inputCount = readInputs(path, inputs);
+	int outputCount = readOutputs(path, outputs);
+	unsigned long now = micros();	//time the path was read
+
+	//waiting on the motors
+	if(p->pending){
+		if(memcmp(outputs, p->outputs, outputCount * sizeof(int)) != 0){
+			addSample(p, now - p->start);
+			p->pending = false;
+		}
+		else if(now - p->start > LATENCY_TIMEOUT * 1000UL){
+			p->missed++;
+			p->pending = false;
+		}
+		return;
+	}
+
+	//an input changed, the sticks only past a small movement
+	int threshold = path == LATENCY_DRIVE ? LATENCY_STICK_CHANGE : 0;
+	bool changed = false;
+	for(int i = 0; i < inputCount; i++)
+		changed |= abs(inputs[i] - p->inputs[i]) > threshold;
+
+	if(changed){
+		memcpy(p->inputs, inputs, sizeof(inputs));
+		memcpy(p->outputs, outputs, sizeof(outputs));
+		p->start = now;
+		p->pending = true;
+	}
+}
+
+/*
+ * Start the latency monitor task.
+ */
+void latency_init(){
+
+	if(latencyTask != NULL)
+		return;
+
+	lock = mutexCreate();
+	latencyTask = taskCreate(latency_task, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_DEFAULT + 2);
+}
+
+/*
+ * Forget every latency measured.
+ */
+void latency_reset(){
+
+	mutexTake(lock, -1);
+	for(int i = 0; i < LATENCY_PATHS; i++)
+		paths[i].next = paths[i].count = paths[i].missed = 0;
+	added = false;
+	mutexGive(lock);
+}
+
+/*
+ * Retrieve the name of a control path.
+ *
+ * @param path The control path.
+ * @return The name, NULL if there is no such path.
+ */
+const char* latency_getName(int path){
+	return path >= 0 && path < LATENCY_PATHS ? names[path] : NULL;
+}
+
+/*
+ * Retrieve the number of latencies kept for a control path.
+ *
+ * @param path The control path.
+ * @return The number of latencies, at most LATENCY_SAMPLES.
+ */
+int latency_getCount(int path){
+	return path >= 0 && path < LATENCY_PATHS ? paths[path].count : 0;
+}
+
+/*
+ * Retrieve the input changes of a control path that its motors never
+ * answered within LATENCY_TIMEOUT, such as a button with nothing to do
+ * in the current PTO mode.
+ *
+ * @param path The control path.
+ * @return The number of unanswered input changes.
+ */
+int latency_getMissed(int path){
+	return path >= 0 && path < LATENCY_PATHS ? paths[path].missed : 0;
+}
+
+/*
+ * Retrieve a latency percentile of a control path.
+ *
+ * @param path The control path.
+ * @param percent The percentile, 100 for the worst latency kept.
+ * @return The latency in us, 0 if none were measured.
+ */
+unsigned long latency_getPercentile(int path, int percent){
+
+	if(latency_getCount(path) == 0)
+		return 0;
+
+	//sort a copy of the samples
+	unsigned long sorted[LATENCY_SAMPLES];
+	mutexTake(lock, -1);
+	int count = paths[path].count;
+	memcpy(sorted, paths[path].samples, count * sizeof(unsigned long));
+	mutexGive(lock);
+
+	for(int i = 1; i < count; i++){
+		unsigned long sample = sorted[i];
+		int j = i;
+		for(; j > 0 && sorted[j - 1] > sample; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = sample;
+	}
+
+	//nearest rank
+	int rank = (percent * count + 99) / 100;
+	return sorted[rank < 1 ? 0 : rank > count ? count - 1 : rank - 1];
+}
+
+/*
+ * Print the latency percentiles of every control path.
+ */
+void latency_report(){
+
+	printf("latency     n  missed    p50 ms    p90 ms    p99 ms    max ms\n");
+	for(int i = 0; i < LATENCY_PATHS; i++){
+		printf("%-7s %5d %7d", names[i], latency_getCount(i), latency_getMissed(i));
+		static const int percents[4] = {50, 90, 99, 100};
+		for(int j = 0; j < 4; j++){
+			unsigned long us = latency_getPercentile(i, percents[j]);
+			printf(" %6lu.%02lu", us / 1000, us / 10 % 100);
+		}
+		printf("\n");
+	}
+}
+
+/*
+ * Latency monitor task. Checks every control path each LATENCY_PERIOD ms,
+ * above the priority of driver control so the times are taken promptly.
+ *
+ * @param ignore Unused task parameter.
+ */
+void latency_task(void* ignore){
+
+	int monitorId = monitor_register("latency", TASK_DEFAULT_STACK_SIZE);
+	unsigned long wakeTime = millis();		//time of the last check
+	unsigned long reportTime = wakeTime;	//time of the last report
+
+	//the joystick as it is now is the reference for the first changes
+	for(int i = 0; i < LATENCY_PATHS; i++)
+		readInputs(i, paths[i].inputs);
+
+	while(true){
+		for(int i = 0; i < LATENCY_PATHS; i++)
+			checkPath(i);
+
+		if(added && millis() - reportTime >= LATENCY_REPORT_PERIOD){
+			latency_report();
+			added = false;
+			reportTime = millis();
+		}
+
+		monitor_delayUntil(monitorId, &wakeTime, LATENCY_PERIOD);
+	}
+}
+
+#endif /* LATENCY */
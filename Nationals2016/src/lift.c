@@ -0,0 +1,185 @@
+/*
+ * @file lift.c
+ *
+ * @brief Implementation of the background lift position controller.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <lift.h>
+#include <trace.h>
+#include <monitor.h>
+
+static TaskHandle liftTask = NULL;		//handle of the lift controller task
+static LiftGains liftGains;				//current controller gains
+static volatile int settledCount = 0;	//consecutive updates spent inside the tolerance
+
+/*
+ * Start the lift controller task. The task is only created
+ * when the lift motor system has been set up.
+ */
+void lift_init(){
+
+	//the robot has no lift or the controller is already running
+	if(motorSystem_size(&Robot.lift) == 0 || lift_isRunning())
+		return;
+
+	liftGains.kP = robot_getLiftConst();	//proportional gain starts at the lift constant
+	liftGains.kI = 0.01;					//small integral gain to remove steady state error
+	liftGains.kD = 2.0;						//derivative gain to damp preset moves
+	liftGains.kG = 10;						//output needed to hold the lift against gravity
+	liftGains.iLimit = 30;					//limit integral wind up
+
+	Robot.liftPos = sensor_read(&Robot.liftSensor);		//hold the lift where it currently is
+	settledCount = 0;
+
+	liftTask = taskCreate(lift_task, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_DEFAULT + 1);
+}
+
+/*
+ * Retrieve if the lift controller task is running.
+ *
+ * @return If the lift controller task is running.
+ */
+bool lift_isRunning(){
+	return liftTask != NULL;
+}
+
+/*
+ * Set the lift controller gains.
+ *
+ * @param gains The new lift controller gains.
+ */
+void lift_setGains(LiftGains gains){
+	liftGains = gains;
+}
+
+/*
+ * Retrieve the lift controller gains.
+ *
+ * @return The current lift controller gains.
+ */
+LiftGains lift_getGains(){
+	return liftGains;
+}
+
+/*
+ * Set the position the lift controller holds.
+ *
+ * @param pos The desired lift position.
+ */
+void lift_setTarget(int pos){
+
+	//new setpoint, the lift is no longer settled
+	if(pos != Robot.liftPos)
+		settledCount = 0;
+
+	Robot.liftPos = pos;
+}
+
+/*
+ * Retrieve the position the lift controller holds.
+ *
+ * @return The lift setpoint.
+ */
+int lift_getTarget(){
+	return Robot.liftPos;
+}
+
+/*
+ * Retrieve if the lift has settled on its setpoint.
+ *
+ * @return If the lift has settled on its setpoint.
+ */
+bool lift_atTarget(){
+	return settledCount >= LIFT_SETTLE;
+}
+
+/*
+ * Pause the calling task until the lift settles on its
+ * setpoint or the timeout expires.
+ *
+ * @param timeout The longest time in ms to wait.
+ * @return If the lift settled before the timeout.
+ */
+bool lift_waitForTarget(unsigned long timeout){
+
+	//nothing is moving the lift
+	if(!lift_isRunning())
+		return false;
+
+	unsigned long start = millis();	//time the wait began
+
+	//wait for the lift to settle
+	while(!lift_atTarget()){
+		if(millis() - start >= timeout)
+			return false;
+		delay(LIFT_PERIOD);
+	}
+
+	return true;
+}
+
+/*
+ * Lift controller task. Runs every LIFT_PERIOD ms and drives
+ * the lift towards Robot.liftPos with PID plus gravity
+ * feedforward.
+ *
+ * @param ignore Unused task parameter.
+ */
+void lift_task(void* ignore){
+
+	unsigned long wakeTime = millis();						//time of the last update
+	int lastValue = sensor_read(&Robot.liftSensor);			//sensor value of the last update
+	double integral = 0;									//accumulated error
+
+	TRACE_TASK("lift");
+	int monitorId = monitor_register("lift", TASK_DEFAULT_STACK_SIZE);
+
+	while(true){
+		TRACE_BEGIN("lift update");
+		int value = sensor_read(&Robot.liftSensor);		//current lift position
+		int error = Robot.liftPos - value;				//distance from the setpoint
+
+		//accumulate error and clamp the integral contribution
+		integral += error;
+		if(integral * liftGains.kI > liftGains.iLimit)
+			integral = liftGains.iLimit / liftGains.kI;
+		else if(integral * liftGains.kI < -liftGains.iLimit)
+			integral = -liftGains.iLimit / liftGains.kI;
+
+		//derivative on measurement so setpoint changes do not kick the output
+		int output = error * liftGains.kP + integral * liftGains.kI
+				   - (value - lastValue) * liftGains.kD + liftGains.kG;
+
+		motorSystem_set(&Robot.lift, output);			//update the lift output
+		lastValue = value;
+
+		//count updates spent at the setpoint
+		if(abs(error) <= LIFT_TOLERANCE){
+			if(settledCount < LIFT_SETTLE)
+				settledCount++;
+		}
+		else{
+			settledCount = 0;
+			if((error > 0) != (integral > 0))
+				integral = 0;	//crossed the setpoint, drop the stale integral
+		}
+
+		TRACE_END("lift update");
+		monitor_delayUntil(monitorId, &wakeTime, LIFT_PERIOD);
+	}
+}
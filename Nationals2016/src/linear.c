@@ -0,0 +1,84 @@
+/*
+ * @file linear.c
+ *
+ * @brief Characterization sweep the linearization tables are generated
+ *        from.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <linear.h>
+
+/*
+ * Sweep a motor system's command from 0 to 127 in LINEAR_STEP steps
+ * with its linearization off, holding each command for LINEAR_SETTLE ms
+ * and measuring the speed on an encoder over LINEAR_SAMPLE ms. The
+ * mechanism must be free to spin and the robot enabled. Each point is
+ * printed as "linear <command> <speed>" between "linear begin" and
+ * "linear end" lines for host/lingen.
+ *
+ * @param system The motor system.
+ * @param encoder An encoder on the mechanism.
+ * @param speeds The speed in ticks per second at each command, LINEAR_POINTS of them, NULL if not wanted.
+ * @param port The port to print the points to, NULL for none.
+ * @return The number of points measured.
+ */
+int linear_characterize(MotorSystem* system, Sensor* encoder, int* speeds, FILE* port){
+
+	const unsigned char* tables[OUTPUT_PORTS];	//tables of the system's motors
+
+	//the sweep writes its commands as they are
+	for(int i = 0; i < motorSystem_size(system) && i < OUTPUT_PORTS; i++){
+		tables[i] = output_getLinear(motor_port(&system->motors[i]));
+		output_setLinear(motor_port(&system->motors[i]), NULL);
+	}
+
+	if(port != NULL)
+		fprintf(port, "linear begin\n");
+
+	int count = 0;	//points measured
+	for(int command = 0; count < LINEAR_POINTS; command += LINEAR_STEP){
+		if(command > 127)
+			command = 127;
+
+		motorSystem_set(system, command);
+		delay(LINEAR_SETTLE);
+
+		//speed over the sample
+		sensor_reset(encoder);
+		unsigned long start = millis();
+		delay(LINEAR_SAMPLE);
+		int speed = abs(sensor_read(encoder)) * 1000L / (long) (millis() - start);
+
+		if(speeds != NULL)
+			speeds[count] = speed;
+		if(port != NULL)
+			fprintf(port, "linear %d %d\n", command, speed);
+		count++;
+
+		if(command == 127)
+			break;
+	}
+
+	motorSystem_stop(system);
+	for(int i = 0; i < motorSystem_size(system) && i < OUTPUT_PORTS; i++)
+		output_setLinear(motor_port(&system->motors[i]), tables[i]);
+
+	if(port != NULL)
+		fprintf(port, "linear end\n");
+
+	return count;
+}
@@ -0,0 +1,286 @@
+/*
+ * @file monitor.c
+ *
+ * @brief Implementation of the processor, stack and memory monitor.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <monitor.h>
+#include <string.h>
+
+//registered task data structure
+struct{
+	const char* name;				//name of the task
+	unsigned int stackSize;			//size of its stack in bytes
+	unsigned char* stackFill;		//lowest address filled with the pattern
+	unsigned int fillSize;			//bytes filled with the pattern
+	unsigned int stackFree;			//pattern bytes left at the last check
+	volatile unsigned long busy;	//total time in us it has run
+	volatile unsigned long wake;	//time in us it last woke
+	unsigned long lastBusy;			//run time at the start of the period
+	unsigned long lastWake;			//wake time at the start of the period
+	unsigned int load;				//share of the last period in tenths of a percent
+} typedef MonitorTask;
+
+static TaskHandle monitorTask = NULL;		//handle of the monitor task
+static MonitorTask tasks[MONITOR_TASKS];	//registered tasks
+static int taskCount = 0;					//number of registered tasks
+
+/*
+ * Fill the unused part of the running task's stack with the pattern,
+ * leaving MONITOR_STACK_GUARD bytes below this function's frame and
+ * above where the bottom of the stack could be.
+ *
+ * @param t The running task.
+ */
+static void __attribute__((noinline)) fillStack(MonitorTask* t){
+
+	volatile unsigned char marker;	//near the lowest frame in use
+
+	if(t->stackSize <= 3 * MONITOR_STACK_GUARD)
+		return;
+
+	//the task has used less than the guard above the marker when it registers
+	t->fillSize = t->stackSize - 2 * MONITOR_STACK_GUARD;
+	t->stackFill = (unsigned char*) &marker - MONITOR_STACK_GUARD - t->fillSize;
+	memset(t->stackFill, MONITOR_STACK_FILL, t->fillSize);
+	t->stackFree = t->fillSize;
+}
+
+/*
+ * Count the pattern bytes left at the bottom of a task's stack.
+ *
+ * @param t The task.
+ * @return The bytes of stack the task has never reached.
+ */
+static unsigned int checkStack(MonitorTask* t){
+
+	unsigned int free = 0;
+	while(free < t->fillSize && t->stackFill[free] == MONITOR_STACK_FILL)
+		free++;
+
+	return free;
+}
+
+/*
+ * Register the running task. Called at the start of a task, before it
+ * calls anything that uses much stack.
+ *
+ * @param name The name of the task, a string literal.
+ * @param stackDepth The stack depth the task was created with, in words.
+ * @return The task's id, -1 if too many tasks have registered.
+ */
+int monitor_register(const char* name, unsigned int stackDepth){
+
+	//a task started again, such as operatorControl(), keeps its id
+	int id = 0;
+	while(id < taskCount && tasks[id].name != name)
+		id++;
+	if(id == MONITOR_TASKS)
+		return -1;
+	if(id == taskCount)
+		taskCount++;
+
+	MonitorTask* t = &tasks[id];
+	t->name = name;
+	t->stackSize = stackDepth * sizeof(int);
+	t->fillSize = 0;
+	t->stackFree = 0;
+	fillStack(t);
+	t->wake = micros();
+
+	return id;
+}
+
+/*
+ * Sleep a registered task until its next period, counting the time it
+ * ran since it last woke.
+ *
+ * @param id The task's id.
+ * @param wakeTime The time of the task's last period, moved to the next.
+ * @param period The task's period in ms.
+ */
+void monitor_delayUntil(int id, unsigned long* wakeTime, unsigned long period){
+
+	if(id < 0){
+		taskDelayUntil(wakeTime, period);
+		return;
+	}
+
+	MonitorTask* t = &tasks[id];
+	t->busy += micros() - t->wake;
+	taskDelayUntil(wakeTime, period);
+	t->wake = micros();
+}
+
+/*
+ * Sleep a registered task for a time, counting the time it ran since it
+ * last woke.
+ *
+ * @param id The task's id.
+ * @param time The time to sleep in ms.
+ */
+void monitor_delay(int id, unsigned long time){
+
+	if(id < 0){
+		delay(time);
+		return;
+	}
+
+	MonitorTask* t = &tasks[id];
+	t->busy += micros() - t->wake;
+	delay(time);
+	t->wake = micros();
+}
+
+/*
+ * Start the monitor task.
+ */
+void monitor_init(){
+
+	if(monitorTask != NULL)
+		return;
+
+	monitorTask = taskCreate(monitor_task, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_DEFAULT - 1);
+}
+
+/*
+ * Retrieve the number of registered tasks.
+ *
+ * @return The number of tasks.
+ */
+int monitor_getCount(){
+	return taskCount;
+}
+
+/*
+ * Retrieve the figures of a registered task.
+ *
+ * @param id The task's id.
+ * @param load The figures.
+ * @return True if there is a task with the id.
+ */
+bool monitor_getTask(int id, TaskLoad* load){
+
+	if(id < 0 || id >= taskCount)
+		return false;
+
+	load->name = tasks[id].name;
+	load->stackSize = tasks[id].stackSize;
+	load->stackFree = tasks[id].stackFree;
+	load->load = tasks[id].load;
+	return true;
+}
+
+/*
+ * Retrieve the largest block of memory malloc() can give, found by
+ * asking for blocks of halving sizes. Not for use in a control loop.
+ *
+ * @return The size of the block in bytes, at most MONITOR_RAM.
+ */
+unsigned int monitor_getFreeMemory(){
+
+	unsigned int low = 0;				//size known to fit
+	unsigned int high = MONITOR_RAM;	//size known not to fit
+
+	void* block = malloc(high);
+	if(block != NULL){
+		free(block);
+		return high;
+	}
+
+	while(high - low > 16){
+		unsigned int size = (low + high) / 2;
+		block = malloc(size);
+		if(block == NULL)
+			high = size;
+		else{
+			free(block);
+			low = size;
+		}
+	}
+
+	return low;
+}
+
+/*
+ * Print the figures of every registered task and the free memory.
+ *
+ * @param port The port to print to.
+ */
+void monitor_report(FILE* port){
+
+	unsigned int total = 0;	//share of every registered task
+
+	fprintf(port, "task             cpu %%   stack free/size\n");
+	for(int i = 0; i < taskCount; i++){
+		MonitorTask* t = &tasks[i];
+		fprintf(port, "%-15s %3u.%u %%   %5u/%u\n", t->name, t->load / 10, t->load % 10, t->stackFree, t->stackSize);
+		total += t->load;
+	}
+	fprintf(port, "registered tasks %u.%u %%, largest free block %u bytes\n", total / 10, total % 10,
+			monitor_getFreeMemory());
+}
+
+/*
+ * Monitor task. Measures each registered task's share of the processor
+ * every MONITOR_PERIOD and the stacks of the tasks that ran in it, and
+ * prints the figures when asked to or when the robot is disabled.
+ *
+ * @param ignore Unused task parameter.
+ */
+void monitor_task(void* ignore){
+
+	int id = monitor_register("monitor", TASK_DEFAULT_STACK_SIZE);
+	unsigned long wakeTime = millis();		//time of the last check
+	unsigned long periodStart = micros();	//time the period began
+	bool enabled = false;					//robot's state at the last check
+
+	while(true){
+
+		//close the period
+		unsigned long now = micros();
+		if(now - periodStart >= MONITOR_PERIOD * 1000UL){
+			for(int i = 0; i < taskCount; i++){
+				MonitorTask* t = &tasks[i];
+				unsigned long busy = t->busy;
+				t->load = (busy - t->lastBusy) / ((now - periodStart) / 1000);
+
+				//only tasks that woke in the period are surely still running
+				if(t->wake != t->lastWake && t->fillSize > 0)
+					t->stackFree = checkStack(t);
+
+				t->lastBusy = busy;
+				t->lastWake = t->wake;
+			}
+			periodStart = now;
+		}
+
+		//any key sent to the debug terminal asks for the figures
+		bool asked = false;
+		while(fcount(stdin) > 0){
+			fgetc(stdin);
+			asked = true;
+		}
+
+		if(asked || (enabled && !isEnabled()))
+			monitor_report(stdout);
+		enabled = isEnabled();
+
+		monitor_delayUntil(id, &wakeTime, MONITOR_CHECK);
+	}
+}
@@ -0,0 +1,181 @@
+/*
+ * @file odometry.c
+ *
+ * @brief Implementation of wheel odometry.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <odometry.h>
+#include <trace.h>
+#include <monitor.h>
+
+#define BARRIER() __asm__ volatile("" ::: "memory")	//keep the compiler from reordering memory accesses
+#define GYRO_BLEND 4								//shift applied to the gyro correction each update
+
+static TaskHandle odomTask = NULL;	//handle of the odometry task
+
+//published pose, the task writes the buffer readers are not using
+static Pose poses[2];				//pose buffers
+static volatile unsigned int seq;	//bumped after each publish, the low bit selects the buffer
+
+//pending reset request
+static Pose resetPose;					//pose to move to
+static volatile bool resetPending;		//flag for if a reset is waiting
+
+/*
+ * Retrieve if the robot has a gyro set up as its turn sensor.
+ *
+ * @return If the gyro can be used for heading.
+ */
+static bool hasGyro(){
+	return sensor_size(&Robot.turnSensor) > 0 && sensor_type(&Robot.turnSensor) == GYRO;
+}
+
+/*
+ * Start the odometry task. The task is only created when
+ * both drive sensors have been set up.
+ */
+void odom_init(){
+
+	//the drive has no sensors or odometry is already running
+	if(sensor_size(&Robot.leftDriveSensor) == 0 || sensor_size(&Robot.rightDriveSensor) == 0 || odom_isRunning())
+		return;
+
+	odom_reset(0, 0, 0);
+	odomTask = taskCreate(odom_task, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_DEFAULT + 1);
+}
+
+/*
+ * Retrieve if the odometry task is running.
+ *
+ * @return If the odometry task is running.
+ */
+bool odom_isRunning(){
+	return odomTask != NULL;
+}
+
+/*
+ * Move the pose to a known position. Takes effect on the
+ * next update.
+ *
+ * @param x The new distance forward in mm.
+ * @param y The new distance left in mm.
+ * @param heading The new heading in binary angle units.
+ */
+void odom_reset(int x, int y, int heading){
+	resetPose.x = x;
+	resetPose.y = y;
+	resetPose.heading = heading;
+	resetPose.time = millis();
+	BARRIER();
+	resetPending = true;
+
+	//nothing is updating the pose yet, publish it directly
+	if(!odom_isRunning()){
+		poses[0] = poses[1] = resetPose;
+		resetPending = false;
+	}
+}
+
+/*
+ * Retrieve the latest pose. Never blocks, the copy is retried
+ * if the odometry task published while it was being made.
+ *
+ * @param pose Where the pose is copied to.
+ */
+void odom_getPose(Pose* pose){
+	unsigned int start;	//publish count when the copy began
+
+	do{
+		start = seq;
+		BARRIER();
+		*pose = poses[start & 1];
+		BARRIER();
+	}while(start != seq);
+}
+
+/*
+ * Odometry task. Runs every ODOM_PERIOD ms, integrating the
+ * drive encoder travel along the average heading of each update.
+ *
+ * @param ignore Unused task parameter.
+ */
+void odom_task(void* ignore){
+
+	unsigned long wakeTime = millis();					//time of the last update
+	int lastLeft = sensor_read(&Robot.leftDriveSensor);		//left encoder at the last update
+	int lastRight = sensor_read(&Robot.rightDriveSensor);		//right encoder at the last update
+	int gyroStart = hasGyro() ? sensor_read(&Robot.turnSensor) : 0;		//gyro reading at the last reset
+
+	long long x = 0;		//distance forward in micrometres
+	long long y = 0;		//distance left in micrometres
+	long long heading = 0;	//heading in binary angle units shifted up by 16
+
+	TRACE_TASK("odometry");
+	int monitorId = monitor_register("odometry", TASK_DEFAULT_STACK_SIZE);
+
+	while(true){
+		TRACE_BEGIN("odometry update");
+
+		//move to the requested pose
+		if(resetPending){
+			x = (long long)resetPose.x * 1000;
+			y = (long long)resetPose.y * 1000;
+			heading = (long long)resetPose.heading << 16;
+			gyroStart = hasGyro() ? sensor_read(&Robot.turnSensor) - FIX_TO_DEG(resetPose.heading) : 0;
+			BARRIER();
+			resetPending = false;
+		}
+
+		int left = sensor_read(&Robot.leftDriveSensor);			//current left encoder
+		int right = sensor_read(&Robot.rightDriveSensor);		//current right encoder
+
+		int dLeft = (left - lastLeft) * ODOM_UM_PER_TICK;		//left wheel travel in micrometres
+		int dRight = (right - lastRight) * ODOM_UM_PER_TICK;	//right wheel travel in micrometres
+		lastLeft = left;
+		lastRight = right;
+
+		//heading change from the wheels, 2^32 per revolution
+		long long dHeading = ((long long)(dRight - dLeft) << 32) / (6283LL * ODOM_TRACK_WIDTH);
+
+		//integrate along the heading halfway through the update
+		int sine, cosine;
+		fix_sinCos((int)((heading + dHeading / 2) >> 16), &sine, &cosine);
+		int travel = (dLeft + dRight) / 2;
+		x += fix_mul(travel, cosine);
+		y += fix_mul(travel, sine);
+		heading += dHeading;
+
+		//pull the wheel heading towards the gyro, which does not drift with wheel slip
+		if(hasGyro()){
+			long long gyro = (long long)FIX_DEG(sensor_read(&Robot.turnSensor) - gyroStart) << 16;
+			heading += (gyro - heading) >> GYRO_BLEND;
+		}
+
+		//publish into the buffer readers are not using
+		Pose* next = &poses[(seq + 1) & 1];
+		next->x = (int)(x / 1000);
+		next->y = (int)(y / 1000);
+		next->heading = (int)(heading >> 16);
+		next->time = millis();
+		BARRIER();
+		seq++;
+
+		TRACE_END("odometry update");
+		monitor_delayUntil(monitorId, &wakeTime, ODOM_PERIOD);
+	}
+}
@@ -36,6 +36,10 @@
  */
 
 #include "main.h"
+#include "monitor.h"
+#include "pto.h"
+#include "telemetry.h"
+#include "trace.h"
 
 /*
  * Runs the user operator control code. This function will be started in its own task with the
@@ -56,13 +60,24 @@
  */
 void operatorControl() {
 
+	TRACE_TASK("operatorControl");
+	int monitorId = monitor_register("operatorControl", TASK_DEFAULT_STACK_SIZE);
 	lcd_centerPrint(&Robot.lcd, TOP, "Driver");				//print to lcd
 	lcd_centerPrint(&Robot.lcd, BOTTOM, "Control Mode");	//print to lcd
 
+	unsigned long last = 0;	//time the last loop began, 0 before the first
+
 	//continue to loop until competition is ended
 	while(!robot_isRecording()){
+		TRACE_BEGIN("userControl");
+		unsigned long start = micros();		//time the loop began
+		if(last != 0)
+			pto_setLoopPeriod(start - last);	//the fire gains are in ticks per loop
+		last = start;
 		userControl();
-		delay(20);
+		telemetry_sample(micros() - start);	//stream the robot's state
+		TRACE_END("userControl");
+		monitor_delay(monitorId, 20);
 	}
 
 	//do record sequence for skills challenge (60 seconds)
@@ -0,0 +1,287 @@
+/*
+ * @file output.c
+ *
+ * @brief Implementation of the battery compensated, current budgeted,
+ *        slew limited and linearized motor output stage.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <output.h>
+#include <budget.h>
+#include <trace.h>
+#include <monitor.h>
+
+//motor port data structure
+struct{
+	volatile int request;			//output asked for
+	int applied;					//output reached, before linearization
+	int written;					//command last written
+	int slew;						//largest change per period, OUTPUT_NOSLEW for none
+	const unsigned char* linear;	//linearization table, NULL for none
+} typedef OutputPort;
+
+static TaskHandle outputTask = NULL;		//handle of the motor output task
+static OutputPort ports[OUTPUT_PORTS];		//state of every motor port, port 1 first
+static bool compensation = true;			//flag for scaling requests for the battery voltage
+static unsigned long batterySum = 0;		//filter state, OUTPUT_FILTER times the filtered voltage
+static volatile unsigned int battery = 0;	//filtered battery voltage in mV
+
+/*
+ * Start the motor output task with every port stopped, without
+ * slew limits and without linearization.
+ */
+void output_init(){
+
+	if(outputTask != NULL)
+		return;
+
+	for(int i = 0; i < OUTPUT_PORTS; i++){
+		ports[i].request = 0;
+		ports[i].applied = 0;
+		ports[i].written = 0;
+		ports[i].slew = OUTPUT_NOSLEW;
+		ports[i].linear = NULL;
+	}
+	motorStopAll();
+
+	outputTask = taskCreate(output_task, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_DEFAULT + 2);
+}
+
+/*
+ * Request an output for a motor port. The output task reaches it
+ * at the port's slew limit.
+ *
+ * @param port The motor port.
+ * @param value The output, limited to [-127, 127].
+ */
+void output_set(unsigned char port, int value){
+
+	//not a motor port
+	if(port < 1 || port > OUTPUT_PORTS)
+		return;
+
+	//limit the output
+	if(value > 127)
+		value = 127;
+	else if(value < -127)
+		value = -127;
+
+	ports[port - 1].request = value;
+}
+
+/*
+ * Retrieve the output requested for a motor port.
+ *
+ * @param port The motor port.
+ * @return The requested output, 0 if there is no such port.
+ */
+int output_getRequest(unsigned char port){
+
+	if(port < 1 || port > OUTPUT_PORTS)
+		return 0;
+
+	return ports[port - 1].request;
+}
+
+/*
+ * Retrieve the output a motor port has reached, after the battery
+ * compensation and slew limit but before linearization.
+ *
+ * @param port The motor port.
+ * @return The output, 0 if there is no such port.
+ */
+int output_get(unsigned char port){
+
+	if(port < 1 || port > OUTPUT_PORTS)
+		return 0;
+
+	return ports[port - 1].applied;
+}
+
+/*
+ * Set the largest change in output a motor port may make each
+ * OUTPUT_PERIOD.
+ *
+ * @param port The motor port.
+ * @param slew The largest change, OUTPUT_NOSLEW for none.
+ */
+void output_setSlew(unsigned char port, int slew){
+
+	if(port < 1 || port > OUTPUT_PORTS)
+		return;
+
+	ports[port - 1].slew = slew < 0 ? OUTPUT_NOSLEW : slew;
+}
+
+/*
+ * Retrieve the slew limit of a motor port.
+ *
+ * @param port The motor port.
+ * @return The largest change per period, OUTPUT_NOSLEW for none.
+ */
+int output_getSlew(unsigned char port){
+
+	if(port < 1 || port > OUTPUT_PORTS)
+		return OUTPUT_NOSLEW;
+
+	return ports[port - 1].slew;
+}
+
+/*
+ * Set if requests are scaled for the battery voltage.
+ *
+ * @param compensate True to scale requests, false to write them as they are.
+ */
+void output_setCompensation(bool compensate){
+	compensation = compensate;
+}
+
+/*
+ * Retrieve if requests are scaled for the battery voltage.
+ *
+ * @return True if requests are scaled.
+ */
+bool output_getCompensation(){
+	return compensation;
+}
+
+/*
+ * Set the linearization table of a motor port.
+ *
+ * @param port The motor port.
+ * @param table LINEAR_SIZE commands indexed by output magnitude, NULL to write outputs as they are.
+ */
+void output_setLinear(unsigned char port, const unsigned char* table){
+
+	if(port < 1 || port > OUTPUT_PORTS)
+		return;
+
+	ports[port - 1].linear = table;
+}
+
+/*
+ * Retrieve the linearization table of a motor port.
+ *
+ * @param port The motor port.
+ * @return The table, NULL if there is none.
+ */
+const unsigned char* output_getLinear(unsigned char port){
+
+	if(port < 1 || port > OUTPUT_PORTS)
+		return NULL;
+
+	return ports[port - 1].linear;
+}
+
+/*
+ * Retrieve the filtered battery voltage.
+ *
+ * @return The voltage in mV, 0 before the output task first runs.
+ */
+unsigned int output_getBattery(){
+	return battery;
+}
+
+/*
+ * Filter a new battery reading into the battery voltage.
+ */
+static void readBattery(){
+
+	unsigned int reading = powerLevelMain();	//unfiltered voltage
+
+	//the first reading starts the filter
+	if(batterySum == 0)
+		batterySum = (unsigned long) reading * OUTPUT_FILTER;
+	else
+		batterySum = batterySum - batterySum / OUTPUT_FILTER + reading;
+
+	battery = batterySum / OUTPUT_FILTER;
+}
+
+/*
+ * Motor output task. Runs every OUTPUT_PERIOD ms, scales each port's
+ * request for the battery voltage and down for the heat budget, moves
+ * its output towards it by at most its slew limit, looks the output up
+ * in the port's linearization table and writes the ports whose command
+ * changed. Every BUDGET_PERIOD ms it hands the commands written, the
+ * voltage the motors actually see, to the budget.
+ *
+ * @param ignore Unused task parameter.
+ */
+void output_task(void* ignore){
+
+	unsigned long wakeTime = millis();	//time of the last update
+	int budgetCount = 0;				//updates until the budget is next estimated
+
+	TRACE_TASK("output");
+	int monitorId = monitor_register("output", TASK_DEFAULT_STACK_SIZE);
+
+	while(true){
+		TRACE_BEGIN("output update");
+		bool enabled = isEnabled();	//the motors only run while enabled
+		readBattery();
+		bool compensate = compensation && battery >= OUTPUT_LOW_BATTERY;	//flag for scaling the requests
+		int outputs[OUTPUT_PORTS];											//commands written, for the budget
+
+		for(int i = 0; i < OUTPUT_PORTS; i++){
+			OutputPort* p = &ports[i];
+			int value = enabled ? p->request : 0;	//output to reach
+
+			//scale for the battery, limited to [-127, 127]
+			if(compensate && value != 0){
+				value = value * OUTPUT_NOMINAL / (int) battery;
+				if(value > 127)
+					value = 127;
+				else if(value < -127)
+					value = -127;
+			}
+
+			//keep the breakers from tripping
+			value = budget_derate(i + 1, value);
+
+			//limit the change
+			if(enabled && p->slew != OUTPUT_NOSLEW){
+				if(value > p->applied + p->slew)
+					value = p->applied + p->slew;
+				else if(value < p->applied - p->slew)
+					value = p->applied - p->slew;
+			}
+
+			p->applied = value;
+
+			//command giving the output
+			const unsigned char* linear = p->linear;
+			if(linear != NULL)
+				value = value < 0 ? -linear[-value] : linear[value];
+
+			if(value != p->written){
+				p->written = value;
+				motorSet(i + 1, value);
+			}
+			outputs[i] = value;
+		}
+
+		//estimate the currents and heat
+		if(budgetCount-- <= 0){
+			budget_update(outputs, battery >= OUTPUT_LOW_BATTERY ? battery : OUTPUT_NOMINAL);
+			budgetCount = BUDGET_PERIOD / OUTPUT_PERIOD - 1;
+		}
+
+		TRACE_END("output update");
+		monitor_delayUntil(monitorId, &wakeTime, OUTPUT_PERIOD);
+	}
+}
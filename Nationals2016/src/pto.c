@@ -0,0 +1,245 @@
+/*
+ * @file pto.c
+ *
+ * @brief Implementation of the PTO state machine.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pto.h>
+#include <budget.h>
+#include <gains.h>
+#include <wiring.h>
+#include <trace.h>
+#include <monitor.h>
+
+static TaskHandle ptoTask = NULL;			//handle of the PTO task
+static volatile bool active = false;		//flag for the task driving the PTO
+static volatile bool wantFlywheel = false;	//launcher asked for, true for the flywheel
+static volatile int state = PTO_OFF;		//current state
+static volatile int puncherOutput = 0;		//output the puncher is driven at
+static volatile int flywheelSpeed = 0;		//flywheel set speed, 0 to let it coast
+static volatile bool boosted = false;		//flag for spinning the flywheel up at full output
+static volatile int velocity = 0;			//flywheel encoder ticks in the last window
+static volatile unsigned long loopPeriod = PTO_LOOP * 1000;	//driver loop period in us, averaged
+
+/*
+ * Start the PTO task. The task is only created when the PTO motor
+ * system has been set up, and does not drive the PTO until a
+ * launcher is picked.
+ */
+void pto_init(){
+
+	//the robot has no PTO or the task is already running
+	if(motorSystem_size(&Robot.PTO) == 0 || pto_isRunning())
+		return;
+
+	ptoTask = taskCreate(pto_task, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_DEFAULT + 1);
+}
+
+/*
+ * Retrieve if the PTO task is running.
+ *
+ * @return If the PTO task is running.
+ */
+bool pto_isRunning(){
+	return ptoTask != NULL;
+}
+
+/*
+ * Pick the launcher the PTO drives. The task takes the PTO if it
+ * was not driving it, and shifts once any shift under way ends.
+ *
+ * @param flywheel True for the flywheel, false for the puncher.
+ */
+void pto_select(bool flywheel){
+	wantFlywheel = flywheel;
+	active = true;
+}
+
+/*
+ * Retrieve if the flywheel is the launcher picked. The PTO may
+ * still be shifting to it.
+ *
+ * @return True for the flywheel, false for the puncher.
+ */
+bool pto_isFlywheel(){
+	return wantFlywheel;
+}
+
+/*
+ * Stop the task driving the PTO. The PTO motors are stopped if
+ * the task was driving them; the solenoid is left as it is.
+ */
+void pto_stop(){
+
+	//hand the PTO back
+	if(active){
+		active = false;
+		motorSystem_stop(&Robot.PTO);
+	}
+}
+
+/*
+ * Retrieve the state.
+ *
+ * @return PTO_OFF, PTO_PUNCHER, PTO_SHIFTING, PTO_SPINUP or PTO_READY.
+ */
+int pto_getState(){
+	return active ? state : PTO_OFF;
+}
+
+/*
+ * Retrieve if the flywheel is engaged and at its fire threshold.
+ *
+ * @return If the state is PTO_READY.
+ */
+bool pto_isReady(){
+	return pto_getState() == PTO_READY;
+}
+
+/*
+ * Set the output the puncher is driven at while it is engaged.
+ *
+ * @param output The output.
+ */
+void pto_setPuncher(int output){
+	puncherOutput = output;
+}
+
+/*
+ * Set the flywheel set speed. Below the fire threshold of the set
+ * speed the flywheel is either driven at the set speed or, boosted,
+ * at full output.
+ *
+ * @param speed The set speed, 0 to let the flywheel coast.
+ * @param boost True to spin up at full output.
+ */
+void pto_setFlywheel(int speed, bool boost){
+	flywheelSpeed = speed;
+	boosted = boost;
+}
+
+/*
+ * Retrieve the flywheel speed, measured whichever launcher is
+ * engaged.
+ *
+ * @return The encoder ticks in the last PTO_WINDOW.
+ */
+int pto_getVelocity(){
+	return velocity;
+}
+
+/*
+ * Hand the task a measured period of the driver loop, the unit of
+ * the fire gains. Periods are averaged over about eight loops, the
+ * loop's LCD prints making single periods uneven.
+ *
+ * @param period The time in us between the starts of two driver loops.
+ */
+void pto_setLoopPeriod(unsigned long period){
+	loopPeriod += ((long)period - (long)loopPeriod) / 8;
+}
+
+/*
+ * PTO task. Runs every PTO_PERIOD ms, measures the flywheel speed
+ * over the last PTO_WINDOW, steps the state machine and drives the
+ * PTO motors for the state.
+ *
+ * @param ignore Unused task parameter.
+ */
+void pto_task(void* ignore){
+
+	unsigned long wakeTime = millis();				//time of the last update
+	int readings[PTO_WINDOW / PTO_PERIOD];			//flywheel encoder readings of the updates in the window
+	int next = 0;									//oldest reading, replaced next
+	bool engaged = false;							//launcher the solenoid selects, true for the flywheel
+	int shiftLeft = 0;								//time in ms left in a shift
+
+	for(int i = 0; i < PTO_WINDOW / PTO_PERIOD; i++)
+		readings[i] = sensor_read(&Robot.wheelEncoder);
+
+	TRACE_TASK("pto");
+	int monitorId = monitor_register("pto", TASK_DEFAULT_STACK_SIZE);
+
+	while(true){
+		TRACE_BEGIN("pto update");
+		int reading = sensor_read(&Robot.wheelEncoder);
+		velocity = reading - readings[next];
+		readings[next] = reading;
+		next = (next + 1) % (PTO_WINDOW / PTO_PERIOD);
+
+		if(!active)
+			state = PTO_OFF;
+		else{
+			int speed = flywheelSpeed;									//flywheel set speed
+			FlywheelGains gains = gains_getFlywheel();					//fire line in ticks per driver loop
+			double perLoop = velocity * (loopPeriod / 1000.0) / PTO_WINDOW;	//flywheel speed in ticks per driver loop
+
+			//take the PTO on the launcher the solenoid already selects
+			if(state == PTO_OFF){
+				engaged = digital_read(DGTL_MASK(WIRING_PTO_SOLENOID)) != 0;
+				state = engaged ? PTO_SPINUP : PTO_PUNCHER;
+			}
+
+			//finish a shift, or start one, never reversing a shift part way
+			if(state == PTO_SHIFTING){
+				shiftLeft -= PTO_PERIOD;
+				if(shiftLeft <= 0)
+					state = engaged ? PTO_SPINUP : PTO_PUNCHER;
+			}
+			else if(wantFlywheel != engaged){
+				engaged = wantFlywheel;
+				digitalWrite(WIRING_PTO_SOLENOID, engaged ? HIGH : LOW);
+				shiftLeft = PTO_SHIFT_TIME;
+				state = PTO_SHIFTING;
+			}
+
+			//ready once the flywheel reaches the fire threshold of its set speed
+			if(state == PTO_SPINUP || state == PTO_READY){
+				state = speed != 0 && perLoop >= gains.fireSlope * speed + gains.fireOffset ? PTO_READY : PTO_SPINUP;
+				budget_setSpeed(&Robot.PTO, velocity * (1000.0 / PTO_WINDOW) / PTO_FREE_SPEED);
+			}
+
+			//output of the state
+			int output;
+			switch(state){
+			case PTO_PUNCHER:
+				output = puncherOutput;
+				break;
+			case PTO_SHIFTING:
+
+				//match the set speed whose fire threshold the flywheel coasts at, let the motors spin down for the puncher
+				output = engaged && gains.fireSlope > 0 ? (perLoop - gains.fireOffset) / gains.fireSlope : 0;
+				if(output > 127)
+					output = 127;
+				if(engaged && output < PTO_CRAWL)
+					output = PTO_CRAWL;
+				break;
+			case PTO_SPINUP:
+				output = boosted && speed != 0 ? 127 : speed;
+				break;
+			default:
+				output = speed;
+			}
+
+			motorSystem_set(&Robot.PTO, output);
+		}
+
+		TRACE_END("pto update");
+		monitor_delayUntil(monitorId, &wakeTime, PTO_PERIOD);
+	}
+}
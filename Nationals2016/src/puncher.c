@@ -0,0 +1,201 @@
+/*
+ * @file puncher.c
+ *
+ * @brief Implementation of the puncher cycle controller.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <puncher.h>
+#include <pto.h>
+#include <gains.h>
+#include <trace.h>
+#include <monitor.h>
+
+static TaskHandle puncherTask = NULL;		//handle of the puncher controller task
+static volatile bool active = false;		//flag for the controller driving the puncher
+static volatile bool firing = false;		//flag for a shot asked for and not yet started
+static volatile int state = PUNCHER_OFF;	//current state
+static volatile int angle = 0;				//cam angle in encoder ticks
+static volatile int shots = 0;				//shots fired
+static int zero = 0;						//encoder reading with the cam at rest after a shot
+
+/*
+ * Start the puncher controller task. The task is only created when
+ * the puncher encoder has been set up, and the cam is taken to be
+ * at rest after a shot.
+ */
+void puncher_init(){
+
+	//the robot has no puncher encoder or the controller is already running
+	if(sensor_size(&Robot.puncherEncoder) == 0 || puncher_isRunning())
+		return;
+
+	zero = sensor_read(&Robot.puncherEncoder);
+
+	puncherTask = taskCreate(puncher_task, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_DEFAULT + 1);
+}
+
+/*
+ * Retrieve if the puncher controller task is running.
+ *
+ * @return If the puncher controller task is running.
+ */
+bool puncher_isRunning(){
+	return puncherTask != NULL;
+}
+
+/*
+ * Start cocking the puncher and holding it loaded. The cycle is
+ * taken up wherever the cam is.
+ */
+void puncher_start(){
+	active = true;
+}
+
+/*
+ * Stop the controller driving the puncher. Its output to the PTO
+ * task is stopped if the controller was driving it, and any shot
+ * not yet started is dropped.
+ */
+void puncher_stop(){
+
+	//hand the puncher back
+	if(active){
+		active = false;
+		firing = false;
+		pto_setPuncher(0);
+	}
+}
+
+/*
+ * Fire the puncher once it is loaded. A shot asked for while one
+ * is already waiting is the same shot.
+ */
+void puncher_fire(){
+	if(active)
+		firing = true;
+}
+
+/*
+ * Retrieve the state.
+ *
+ * @return PUNCHER_OFF, PUNCHER_COCKING, PUNCHER_LOADED or PUNCHER_FIRING.
+ */
+int puncher_getState(){
+	return active ? state : PUNCHER_OFF;
+}
+
+/*
+ * Retrieve if the puncher is held at the cocked angle.
+ *
+ * @return If the state is PUNCHER_LOADED.
+ */
+bool puncher_isLoaded(){
+	return puncher_getState() == PUNCHER_LOADED;
+}
+
+/*
+ * Retrieve if a ball is seated in front of the puncher.
+ *
+ * @return If the puncher line sensor is below the puncher.ball gain.
+ */
+bool puncher_hasBall(){
+	return sensor_read(&Robot.puncherDetector) < gains_getFlywheel().puncherBall;
+}
+
+/*
+ * Retrieve the cam angle.
+ *
+ * @return The encoder ticks through the current turn, from 0 to PUNCHER_TURN - 1.
+ */
+int puncher_getAngle(){
+	return angle;
+}
+
+/*
+ * Retrieve the number of shots fired since start up.
+ *
+ * @return The number of shots.
+ */
+int puncher_getShots(){
+	return shots;
+}
+
+/*
+ * Puncher controller task. Runs every PUNCHER_PERIOD ms, reads the
+ * cam angle and steps the cock, hold, fire cycle.
+ *
+ * @param ignore Unused task parameter.
+ */
+void puncher_task(void* ignore){
+
+	unsigned long wakeTime = millis();	//time of the last update
+	int target = 0;						//encoder position, from zero, the cam is driven to
+
+	TRACE_TASK("puncher");
+	int monitorId = monitor_register("puncher", TASK_DEFAULT_STACK_SIZE);
+
+	while(true){
+		TRACE_BEGIN("puncher update");
+		int position = sensor_read(&Robot.puncherEncoder) - zero;	//cam travel since start up
+		int cam = position % PUNCHER_TURN;								//cam angle
+		if(cam < 0)
+			cam += PUNCHER_TURN;
+		int turn = position - cam;										//position the current turn began at
+		angle = cam;
+
+		//stopped, the stop may have come between the last update's check and its output
+		if(!active){
+			if(state != PUNCHER_OFF)
+				pto_setPuncher(0);
+			state = PUNCHER_OFF;
+		}
+		else{
+
+			//take the cycle up where the cam is
+			if(state == PUNCHER_OFF){
+				if(cam >= PUNCHER_COCKED && cam < PUNCHER_RELEASE)
+					state = PUNCHER_LOADED;
+				else{
+					target = turn + PUNCHER_COCKED + (cam < PUNCHER_COCKED ? 0 : PUNCHER_TURN);
+					state = PUNCHER_COCKING;
+				}
+			}
+
+			//stop at the cocked angle, the ratchet holds the spring
+			if(state == PUNCHER_COCKING && position >= target)
+				state = PUNCHER_LOADED;
+
+			//fire, then cock for the next turn
+			if(state == PUNCHER_LOADED && firing){
+				firing = false;
+				target = turn + PUNCHER_RELEASE + PUNCHER_PAST;
+				state = PUNCHER_FIRING;
+			}
+			else if(state == PUNCHER_FIRING && position >= target){
+				shots++;
+				target = turn + PUNCHER_TURN + PUNCHER_COCKED;
+				state = PUNCHER_COCKING;
+			}
+
+			pto_setPuncher(state == PUNCHER_LOADED ? 0 : 127);
+		}
+
+		TRACE_END("puncher update");
+		monitor_delayUntil(monitorId, &wakeTime, PUNCHER_PERIOD);
+	}
+}
@@ -0,0 +1,121 @@
+/*
+ * @file pursuit.c
+ *
+ * @brief Implementation of the pure pursuit path follower.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pursuit.h>
+#include <odometry.h>
+
+/*
+ * Retrieve the squared distance between the robot and a point.
+ *
+ * @param pose The robot's pose.
+ * @param point The point on the path.
+ * @return The squared distance in mm.
+ */
+static int distanceSq(const Pose* pose, const PathPoint* point){
+	int dx = point->x - pose->x;
+	int dy = point->y - pose->y;
+	return dx * dx + dy * dy;
+}
+
+/*
+ * Drive along a path with pure pursuit. The drive steers
+ * along the arc through the point one lookahead distance down
+ * the path and runs at the velocity scheduled for the closest
+ * point. Needs the odometry task to be running.
+ *
+ * @param path The path being followed.
+ * @param timeout The longest time in ms to drive.
+ * @return If the end of the path was reached before the timeout.
+ */
+bool pursuit_follow(const Path* path, unsigned long timeout){
+
+	//no pose to steer with
+	if(!odom_isRunning() || path->size == 0)
+		return false;
+
+	unsigned long start = millis();		//time the path began
+	unsigned long wakeTime = start;		//time of the last update
+	const PathPoint* last = &path->points[path->size - 1];	//final point of the path
+	int closest = 0;					//index of the closest point
+	int velocity = 0;					//current drive output
+	bool reached = false;				//flag for reaching the end of the path
+	Pose pose;							//robot's pose
+
+	while(millis() - start < timeout){
+		odom_getPose(&pose);
+
+		//finished once the robot is at the last point
+		if(distanceSq(&pose, last) <= PURSUIT_TOLERANCE * PURSUIT_TOLERANCE){
+			reached = true;
+			break;
+		}
+
+		//the closest point only moves forward along the path
+		int end = closest + PURSUIT_SEARCH < path->size ? closest + PURSUIT_SEARCH : path->size;
+		int best = distanceSq(&pose, &path->points[closest]);
+		for(int i = closest + 1; i < end; i++){
+			int d = distanceSq(&pose, &path->points[i]);
+			if(d < best){
+				best = d;
+				closest = i;
+			}
+		}
+
+		//lookahead point is the first point at least a lookahead away, or the end of the path
+		int look = closest;
+		while(look < path->size - 1 && distanceSq(&pose, &path->points[look]) < PURSUIT_LOOKAHEAD * PURSUIT_LOOKAHEAD)
+			look++;
+
+		//lookahead point relative to the robot, forward and left
+		int sine, cosine;
+		fix_sinCos(pose.heading, &sine, &cosine);
+		int dx = path->points[look].x - pose.x;
+		int dy = path->points[look].y - pose.y;
+		int ahead = fix_mul(dx, cosine) + fix_mul(dy, sine);
+		int left = fix_mul(dy, cosine) - fix_mul(dx, sine);
+		int lengthSq = ahead * ahead + left * left;
+
+		//limit acceleration towards the scheduled velocity
+		int scheduled = path->points[closest].velocity;
+		if(scheduled > velocity + PURSUIT_ACCEL)
+			velocity += PURSUIT_ACCEL;
+		else
+			velocity = scheduled;
+
+		//steer along the arc with curvature 2 * left / length^2
+		int steer = lengthSq == 0 ? 0 : (int)((long long)velocity * left * ODOM_TRACK_WIDTH / lengthSq);
+		int leftOut = velocity - steer;
+		int rightOut = velocity + steer;
+
+		//keep the ratio between the sides if either is past full output
+		int biggest = abs(leftOut) > abs(rightOut) ? abs(leftOut) : abs(rightOut);
+		if(biggest > 127){
+			leftOut = leftOut * 127 / biggest;
+			rightOut = rightOut * 127 / biggest;
+		}
+
+		robot_setDriveSplit(leftOut, rightOut);
+		taskDelayUntil(&wakeTime, PURSUIT_PERIOD);
+	}
+
+	robot_stop();	//stop the drive
+	return reached;
+}
@@ -23,25 +23,19 @@
 
 #include <robot.h>
 #include <main.h>
+#include <lift.h>
+#include <turn.h>
+#include <pto.h>
+#include <puncher.h>
+#include <trace.h>
+
 
 /*
- * Initialize all of the motors for the robot.
- *
- * @param driveType The type of drive the robot will be
- * 					utilizing.
+ * Set the robot's defaults. The motors are defined with their ports and
+ * directions in wiring.c.
  */
 void robot_init(){
-	Robot.liftConst = 0.7;					//sed default value for PID lift constant
-	motor1 = motor_init(PORT_1, false);		//initialize motor on port 1
-	motor2 = motor_init(PORT_2, false);		//initialize motor on port 2
-	motor3 = motor_init(PORT_3, false);		//initialize motor on port 3
-	motor4 = motor_init(PORT_4, false);		//initialize motor on port 4
-	motor5 = motor_init(PORT_5, false);		//initialize motor on port 5
-	motor6 = motor_init(PORT_6, false);		//initialize motor on port 6
-	motor7 = motor_init(PORT_7, false);		//initialize motor on port 7
-	motor8 = motor_init(PORT_8, false);		//initialize motor on port 8
-	motor9 = motor_init(PORT_9, false);		//initialize motor on port 9
-	motor10 = motor_init(PORT_10, false);	//initialize motor on port 10
+	Robot.liftConst = 0.7;	//sed default value for PID lift constant
 }
 
 /*
@@ -191,23 +185,38 @@ void robot_lcdMenu(){
 }
 
 /*
- *	Control robot's drive via the vexNET joystick
+ *	Control robot's drive via the vexNET joystick. When both sticks
+ *	ask for the same velocity the turn controller holds the heading
+ *	the robot had when the straight drive began.
  *
  *	@param controller The joystick that will be controlling the drive.
  */
 void robot_joyDrive(unsigned int controller){
 
-	//used for dead zoning joystick
-	if(abs(joystickGetAnalog(controller, 2)) > 10)
-		motorSystem_setVelocity(&Robot.rightDrive, joystickGetAnalog(controller, 2));	//set robot's right drive velocity
-	else
-		motorSystem_stop(&Robot.rightDrive);	//stop robot's right drive
+	static int holdAngle = 0;						//heading in binary angle units captured when the straight drive began
+	int right = joystickGetAnalog(controller, 2);	//requested right drive velocity
+	int left = joystickGetAnalog(controller, 3);	//requested left drive velocity
 
 	//used for dead zoning joystick
-	if(abs(joystickGetAnalog(controller, 3)) > 10)
-		motorSystem_setVelocity(&Robot.leftDrive, joystickGetAnalog(controller, 3));	//set robot's left drive velocity
-	else
-		motorSystem_stop(&Robot.leftDrive);	//stop robot's left drive
+	if(abs(right) <= 10)
+		right = 0;
+	if(abs(left) <= 10)
+		left = 0;
+
+	//driving straight with no turn asked for, let the turn controller cancel drift
+	if(turn_assistEnabled() && left != 0 && left == right){
+		if(turn_getMode() != TURN_HOLD)
+			holdAngle = turn_getHeadingFix();
+		turn_holdFix(holdAngle, left);
+		return;
+	}
+
+	//take the drive back from the turn controller
+	if(turn_getMode() != TURN_OFF)
+		turn_stop();
+
+	motorSystem_set(&Robot.rightDrive, right);			//set robot's right drive velocity
+	motorSystem_set(&Robot.leftDrive, left);			//set robot's left drive velocity
 }
 
 /*
@@ -227,8 +236,8 @@ void robot_setDrive(int velocity){
  * @param right The desired velocity for the right drive.
  */
 void robot_setDriveSplit(int left, int right){
-	motorSystem_setVelocity(&Robot.leftDrive, left);		//set the left drive velocity
-	motorSystem_setVelocity(&Robot.rightDrive, right);	//set the right drive velocity
+	motorSystem_set(&Robot.leftDrive, left);				//set the left drive velocity
+	motorSystem_set(&Robot.rightDrive, right);			//set the right drive velocity
 }
 
 /*
@@ -263,26 +272,18 @@ void robot_setDriveForSplit(int left, int right, unsigned int time){
 }
 
 /*
- * Have the robot's lift go to the desired position
+ * Have the robot's lift go to the desired position. The lift
+ * controller task holds the position, during autonomous the
+ * call waits for the lift to settle.
  *
  * @param pos The desired lift position.
  */
 void robot_liftToPosition(int pos){
+	lift_setTarget(pos);	//hand the new setpoint to the lift controller
 
 	//it is the autonomous period
 	if(isAutonomous())
-		motorSystem_setTillPID(&Robot.lift, &Robot.liftSensor, robot_getLiftConst(), pos);
-
-	//it is op control period
-	else{
-		//update motor in PID loop until sensor target value is near
-		if(abs(sensor_getValue(Robot.liftSensor)) != pos || (pos - sensor_getValue(Robot.liftSensor)) * robot_getLiftConst() < 10)
-			motorSystem_setVelocity(&Robot.lift, (pos - sensor_getValue(Robot.liftSensor)));
-
-		//target position has been reached
-		else
-			motorSystem_stop(&Robot.lift);	//stop motor
-	}
+		lift_waitForTarget(LIFT_TIMEOUT);
 }
 
 /**
@@ -291,20 +292,25 @@ void robot_liftToPosition(int pos){
  */
 void robot_setLiftConst(double value){
 	Robot.liftConst = value;
+
+	//update the running lift controller
+	LiftGains gains = lift_getGains();
+	gains.kP = value;
+	lift_setGains(gains);
 }
 
 /*
  * Set the robot's intake to the on state.
  */
 void robot_intakeIn(){
-	motorSystem_setVelocity(&Robot.intake, 127);
+	motorSystem_set(&Robot.intake, 127);
 }
 
 /*
  * Set the robot's intake to the out state.
  */
 void robot_intakeOut(){
-	motorSystem_setVelocity(&Robot.intake, -127);
+	motorSystem_set(&Robot.intake, -127);
 }
 
 /*
@@ -384,7 +390,7 @@ int charToInt(char chr){
  * @param motor The motor port whose velocity is being taken.
  */
 void writeMotorValue(FILE* file, int port){
-	int velocity = motorGet(port) + 127;
+	int velocity = output_get(port) + 127;	//output before linearization, replay looks it up again
 	fputc(intToChar(velocity/100), file);
 	velocity %= 100;
 	fputc(intToChar(velocity/10), file);
@@ -405,21 +411,58 @@ int readMotorValue(FILE* file){
 }
 
 /*
- * Write the state of the digital port to the desired
- * file.
+ * Write the battery voltage in hundredths of a volt to the
+ * desired file.
+ *
+ * @param file The file to write too.
+ * @param voltage The battery voltage in mV.
+ */
+void writeBatteryValue(FILE* file, unsigned int voltage){
+	voltage = voltage / 10 > 999 ? 999 : voltage / 10;
+	fputc(intToChar(voltage/100), file);
+	voltage %= 100;
+	fputc(intToChar(voltage/10), file);
+	voltage %= 10;
+	fputc(intToChar(voltage), file);
+}
+
+/*
+ * Retrieve a battery voltage from the desired file.
+ *
+ * @param The file being read from.
+ * @return The battery voltage in mV.
  */
-void writeDigitalPortValue(FILE* file, int port){
-	fputc(intToChar(digitalRead(port)), file);
+unsigned int readBatteryValue(FILE* file){
+	unsigned int voltage = 0;
+	voltage = charToInt(fgetc(file))*100;
+	voltage += charToInt(fgetc(file))*10;
+	return (voltage + charToInt(fgetc(file)))*10;
 }
 
 /*
- * Retrieve the digital port value from a file.
+ * Write the states of the digital ports to the desired
+ * file, one character per port.
+ *
+ * @param file The file to write too.
+ * @param values The mask of ports that are high.
+ */
+void writeDigitalPortValues(FILE* file, unsigned int values){
+	for(int i = DGTL_1; i <= DGTL_12; i++)
+		fputc(intToChar((values & DGTL_MASK(i)) != 0), file);
+}
+
+/*
+ * Retrieve the states of the digital ports from a file.
  *
  * @param The file being read from,
- * @return The numerical state of the digital port.
+ * @return The mask of ports that are high.
  */
-int readDigitalPortValue(FILE* file){
-	return charToInt(fgetc(file));
+unsigned int readDigitalPortValues(FILE* file){
+	unsigned int values = 0;
+	for(int i = DGTL_1; i <= DGTL_12; i++)
+		if(charToInt(fgetc(file)) != 0)
+			values |= DGTL_MASK(i);
+	return values;
 }
 
 /*
@@ -432,6 +475,8 @@ void robot_record(unsigned long int time){
 
 	FILE* file = NULL;	//initialize file pointer
 
+	TRACE_BEGIN("record open");
+
 	//skills challenge autonomous
 	if(robot_getSkills())
 			file = fopen("sk.txt", "w");
@@ -452,6 +497,8 @@ void robot_record(unsigned long int time){
 	else if(robot_getAlliance() == BLUE_ALLIANCE && robot_getStartPos() == POS_2)
 		file = fopen("b2.txt" , "w");
 
+	TRACE_END("record open");
+
 	//countdown timer
 	lcd_centerPrint(&Robot.lcd, TOP, "Recording in:");
 	for(int i = 10; i > 0; i--){
@@ -463,26 +510,38 @@ void robot_record(unsigned long int time){
 	lcd_centerPrint(&Robot.lcd, TOP, "Recording");	    //print to lcd
 	lcd_centerPrint(&Robot.lcd, BOTTOM, "IN PROGRESS");	//print to lcd
 
+	//mark the recording as holding the battery voltage of each frame and outputs before linearization
+	if(file != NULL)
+		fputc(RECORD_LINEAR, file);
+
 	//read motor values until record time is reached
 	unsigned int counter = 0;
 	if(file != NULL)
 		while(counter < time){
+			TRACE_BEGIN("userControl");
 			userControl();	//do normal drive functions
+			TRACE_END("userControl");
 
 			//write motor values
+			TRACE_BEGIN("record write");
 			for(int i = PORT_1; i <= PORT_10; i++)
 				writeMotorValue(file, i);
 
-			//write sensor values
-			for(int i = DGTL_1; i <= DGTL_12; i++)
-				writeDigitalPortValue(file, i);
+			//write output port values, inputs are recorded low
+			writeDigitalPortValues(file, digital_read(digital_getOutputs()));
+
+			//write the battery voltage the motor values were written at
+			writeBatteryValue(file, output_getBattery());
+			TRACE_END("record write");
 
 			//delay(5);		//standard delay
 			counter += 26;	//increase counter
 		}
 
 	robot_stop();										//stop all motors
+	TRACE_BEGIN("record close");
 	fclose(file);										//close the file stream
+	TRACE_END("record close");
 	lcd_centerPrint(&Robot.lcd, TOP, "Recording");	    //print to lcd
 	lcd_centerPrint(&Robot.lcd, BOTTOM, "COMPLETED");	//print to lcd
 }
@@ -514,19 +573,50 @@ void robot_replay(){
 	else if(robot_getAlliance() == BLUE_ALLIANCE && robot_getStartPos() == POS_2)
 		file = fopen("b2.txt" , "r");
 
+	//recordings made before the battery voltage was kept hold nominal values
+	int header = file != NULL ? fgetc(file) : EOF;					//first character of the recording
+	bool battery = header == RECORD_BATTERY || header == RECORD_LINEAR;	//flag for frames holding the battery voltage
+	bool linear = header == RECORD_LINEAR;							//flag for outputs before linearization
+	if(file != NULL && !battery)
+		fseek(file, 0, SEEK_SET);
+
+	//recordings made before linearization hold the commands written, replay them as they are
+	const unsigned char* tables[OUTPUT_PORTS];	//linearization tables of the ports
+	for(int i = PORT_1; i <= PORT_10; i++){
+		tables[i - PORT_1] = output_getLinear(i);
+		if(!linear)
+			output_setLinear(i, NULL);
+	}
+
+	//the recording drives the solenoid and PTO motors itself
+	puncher_stop();
+	pto_stop();
+
 	//continue to feed motor values until the end of the file
 	if(file != NULL)
 		while(!feof(file)){
 
-			//set motor velocities
+			//read motor velocities
+			TRACE_BEGIN("replay read");
+			int velocities[PORT_10];
 			for(int i = PORT_1; i <= PORT_10; i++)
-				motorSet(i, readMotorValue(file));
+				velocities[i - PORT_1] = readMotorValue(file);
+
+			//set the output ports
+			digital_write(DGTL_ALL, readDigitalPortValues(file));
 
-			//set digital pin statuses
-			for(int i = DGTL_1; i <= DGTL_12; i++)
-				digitalWrite(i, readDigitalPortValue(file));
+			//rescale the velocities from the recording's battery voltage to nominal, the output task scales them to the battery's
+			int voltage = battery ? readBatteryValue(file) : OUTPUT_NOMINAL;
+			if(voltage < OUTPUT_LOW_BATTERY)
+				voltage = OUTPUT_NOMINAL;
+			for(int i = PORT_1; i <= PORT_10; i++)
+				output_set(i, velocities[i - PORT_1] * voltage / OUTPUT_NOMINAL);
+			TRACE_END("replay read");
 
 			delay(26);
 		}
 	robot_stop();	//stop all motors
+
+	for(int i = PORT_1; i <= PORT_10; i++)
+		output_setLinear(i, tables[i - PORT_1]);
 }
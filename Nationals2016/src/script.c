@@ -0,0 +1,498 @@
+/*
+ * @file script.c
+ *
+ * @brief Implementation of the autonomous script interpreter.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <script.h>
+#include <lift.h>
+#include <turn.h>
+#include <pto.h>
+#include <puncher.h>
+#include <odometry.h>
+
+#define STEP_LIMIT 16	//most instructions one branch runs in a single update
+#define NONE      -1	//no instruction in progress or no thread
+
+//branch data structure
+struct{
+	int pc;				//address of the next instruction, NONE for a free branch
+	int parent;			//branch waiting for this one to end, NONE for the main branch
+	int children;		//parallel branches this one is waiting for
+	int op;				//blocking instruction in progress
+	unsigned long start;//time the instruction began
+	int arg[3];			//arguments of the instruction in progress
+	int left;			//left drive sensor when a drive began
+	int right;			//right drive sensor when a drive began
+} typedef Thread;
+
+static const unsigned char* code;	//script being run
+static int codeSize;				//size of the script in bytes
+static Thread threads[SCRIPT_THREADS];	//branches of the script
+static bool aborted;				//flag for a script stopped part way
+
+/*
+ * Read an 8 bit argument and move past it.
+ *
+ * @param pc The address of the argument.
+ * @return The argument.
+ */
+static int read8(int* pc){
+	return *pc < codeSize ? code[(*pc)++] : 0;
+}
+
+/*
+ * Read a 16 bit little endian argument and move past it.
+ *
+ * @param pc The address of the argument.
+ * @return The signed argument.
+ */
+static int read16(int* pc){
+	int low = read8(pc);
+	return (short)(low | read8(pc) << 8);
+}
+
+/*
+ * Retrieve the sensor an OP_UNTIL instruction refers to.
+ *
+ * @param id The sensor number from scriptops.h.
+ * @return The robot's sensor, or NULL if it does not exist.
+ */
+static Sensor* sensorFor(int id){
+	switch(id){
+	case SENSOR_WHEEL_ENCODER:
+		return &Robot.wheelEncoder;
+	case SENSOR_PUNCHER_ENCODER:
+		return &Robot.puncherEncoder;
+	case SENSOR_WHEEL_DETECTOR:
+		return &Robot.wheelDetector;
+	case SENSOR_PUNCHER_DETECTOR:
+		return &Robot.puncherDetector;
+	case SENSOR_LIFT:
+		return &Robot.liftSensor;
+	case SENSOR_LEFT_DRIVE:
+		return &Robot.leftDriveSensor;
+	case SENSOR_RIGHT_DRIVE:
+		return &Robot.rightDriveSensor;
+	case SENSOR_TURN:
+		return &Robot.turnSensor;
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Retrieve if the robot has both drive sensors set up.
+ *
+ * @return If drive distances can be measured.
+ */
+static bool hasDriveSensors(){
+	return sensor_size(&Robot.leftDriveSensor) > 0 && sensor_size(&Robot.rightDriveSensor) > 0;
+}
+
+/*
+ * Check a block of a script before it runs. Every instruction must be
+ * whole and known, and the robot must have what it drives or reads:
+ * the drive sensors, the turn and lift controllers, the sensors waited
+ * on and the digital ports set up as outputs.
+ *
+ * @param pc The address of the block's first instruction.
+ * @param end The address past the last byte the block may use.
+ * @return The most branches the block runs at once, its own included, or NONE if it cannot run.
+ */
+static int check(int pc, int end){
+
+	int most = 0;	//most branches one parallel instruction of the block runs at once
+
+	while(pc < end){
+		int op = code[pc++];	//next instruction
+
+		//the arguments run past the block
+		int size = op == OP_DRIVE || op == OP_UNTIL ? 4 : op == OP_PARALLEL ? 1 : op == OP_END ? 0 : 2;
+		if(pc + size > end)
+			return NONE;
+
+		switch(op){
+
+		//end of the block
+		case OP_END:
+			return 1 + most;
+
+		case OP_DRIVE:
+			if(!hasDriveSensors())
+				return NONE;
+			break;
+
+		case OP_TURN:
+			if(!turn_isRunning())
+				return NONE;
+			break;
+
+		case OP_LIFT:
+			if(!lift_isRunning())
+				return NONE;
+			break;
+
+		case OP_INTAKE:
+		case OP_PTO:
+		case OP_WAIT:
+			break;
+
+		case OP_UNTIL:{
+			Sensor* sensor = sensorFor(code[pc]);
+			if(sensor == NULL || sensor_size(sensor) == 0 || code[pc + 1] > CMP_EQUAL)
+				return NONE;
+			break;
+		}
+
+		case OP_OUTPUT:{
+			int pin = code[pc];
+			if(pin < DGTL_1 || pin > DGTL_12 || (digital_getOutputs() & DGTL_MASK(pin)) == 0)
+				return NONE;
+			break;
+		}
+
+		//each branch on its own, the branches all run at once
+		case OP_PARALLEL:{
+			int count = code[pc];
+			int address = pc + 1 + count * 2;	//first branch
+			int branches = 0;					//branches the instruction runs at once, nested ones included
+
+			if(address > end)
+				return NONE;
+
+			for(int i = 0; i < count; i++){
+				int length = code[pc + 1 + i * 2] | code[pc + 2 + i * 2] << 8;
+				int need = address + length <= end ? check(address, address + length) : NONE;
+				if(need == NONE)
+					return NONE;
+				branches += need;
+				address += length;
+			}
+
+			if(branches > most)
+				most = branches;
+			pc = address;
+			continue;
+		}
+
+		//not an instruction
+		default:
+			return NONE;
+		}
+
+		pc += size;
+	}
+
+	return NONE;	//no end
+}
+
+/*
+ * Check if the blocking instruction of a branch has finished.
+ *
+ * @param t The branch being checked.
+ * @return If the branch can move to its next instruction.
+ */
+static bool isDone(Thread* t){
+	switch(t->op){
+
+	//drive until the average wheel travel reaches the distance
+	case OP_DRIVE:{
+		int ticks = (sensor_read(&Robot.leftDriveSensor) - t->left + sensor_read(&Robot.rightDriveSensor) - t->right) / 2;
+		return abs(ticks) * ODOM_UM_PER_TICK / 1000 >= abs(t->arg[0]);
+	}
+
+	case OP_TURN:
+		return turn_isSettled();
+
+	case OP_LIFT:
+		return lift_atTarget();
+
+	case OP_WAIT:
+		return millis() - t->start >= (unsigned long)t->arg[0];
+
+	//compare the sensor against the value
+	case OP_UNTIL:{
+		int value = sensor_read(sensorFor(t->arg[0]));
+		if(t->arg[1] == CMP_LESS)
+			return value < t->arg[2];
+		else if(t->arg[1] == CMP_GREATER)
+			return value > t->arg[2];
+		return value == t->arg[2];
+	}
+
+	default:
+		return true;
+	}
+}
+
+/*
+ * Clean up after a blocking instruction has finished.
+ *
+ * @param t The branch whose instruction finished.
+ */
+static void finish(Thread* t){
+
+	//stop the drive
+	if(t->op == OP_DRIVE || t->op == OP_TURN){
+		if(turn_getMode() != TURN_OFF)
+			turn_stop();
+		else
+			robot_stop();
+	}
+
+	t->op = NONE;
+}
+
+/*
+ * Start a new branch.
+ *
+ * @param pc The address of the branch's first instruction.
+ * @param parent The branch waiting for it.
+ * @return If there was room for the branch.
+ */
+static bool spawn(int pc, int parent){
+
+	//find a free branch
+	for(int i = 0; i < SCRIPT_THREADS; i++)
+		if(threads[i].pc == NONE){
+			threads[i].pc = pc;
+			threads[i].parent = parent;
+			threads[i].children = 0;
+			threads[i].op = NONE;
+			return true;
+		}
+
+	return false;
+}
+
+/*
+ * Run a branch until it reaches an instruction that has to
+ * wait for the robot.
+ *
+ * @param index The index of the branch.
+ */
+static void step(int index){
+
+	Thread* t = &threads[index];	//branch being run
+
+	for(int n = 0; n < STEP_LIMIT; n++){
+
+		//waiting for parallel branches
+		if(t->children > 0)
+			return;
+
+		//waiting for the robot
+		if(t->op != NONE){
+			if(!isDone(t))
+				return;
+			finish(t);
+		}
+
+		int op = read8(&t->pc);	//next instruction
+		t->start = millis();
+
+		switch(op){
+
+		//drive straight for a distance
+		case OP_DRIVE:{
+			t->arg[0] = read16(&t->pc);
+			int velocity = t->arg[0] < 0 ? -read16(&t->pc) : read16(&t->pc);
+			t->left = sensor_read(&Robot.leftDriveSensor);
+			t->right = sensor_read(&Robot.rightDriveSensor);
+			if(turn_assistEnabled())
+				turn_holdFix(turn_getHeadingFix(), velocity);
+			else
+				robot_setDrive(velocity);
+			t->op = op;
+			break;
+		}
+
+		//turn in place
+		case OP_TURN:
+			turn_toAngle(read16(&t->pc));
+			t->op = op;
+			break;
+
+		//move the lift
+		case OP_LIFT:
+			lift_setTarget(read16(&t->pc));
+			t->op = op;
+			break;
+
+		case OP_INTAKE:
+			motorSystem_set(&Robot.intake, read16(&t->pc));
+			break;
+
+		//drive the PTO motors as they are, without the PTO task
+		case OP_PTO:
+			puncher_stop();
+			pto_stop();
+			motorSystem_set(&Robot.PTO, read16(&t->pc));
+			break;
+
+		case OP_WAIT:
+			t->arg[0] = read16(&t->pc);
+			t->op = op;
+			break;
+
+		//wait for a sensor
+		case OP_UNTIL:
+			t->arg[0] = read8(&t->pc);
+			t->arg[1] = read8(&t->pc);
+			t->arg[2] = read16(&t->pc);
+			t->op = op;
+			break;
+
+		//set a digital output, never a port set up as an input
+		case OP_OUTPUT:{
+			unsigned int mask = DGTL_MASK(read8(&t->pc)) & digital_getOutputs();
+			digital_write(mask, read8(&t->pc) ? mask : 0);
+			break;
+		}
+
+		//start the branches and continue after them once they all end, stop if they do not fit
+		case OP_PARALLEL:{
+			int count = read8(&t->pc);
+			int address = t->pc + count * 2;
+			for(int i = 0; i < count; i++){
+				int length = read16(&t->pc);
+				if(!spawn(address, index)){
+					aborted = true;
+					return;
+				}
+				t->children++;
+				address += length;
+			}
+			t->pc = address;
+			break;
+		}
+
+		//end of a branch, wake the branch waiting on it
+		default:
+			if(t->parent != NONE)
+				threads[t->parent].children--;
+			t->pc = NONE;
+			return;
+		}
+	}
+}
+
+/*
+ * Run a compiled script until it ends. The whole script is checked
+ * first, and is refused without moving the robot if it is not valid,
+ * needs hardware or a controller the robot does not have, or runs
+ * more than SCRIPT_THREADS branches at once. A script that still runs
+ * out of branches is stopped there with the drive stopped.
+ *
+ * @param script The bytecode, starting with the script header.
+ * @param size The size of the bytecode in bytes.
+ * @return If the script was accepted and ran.
+ */
+bool script_run(const unsigned char* script, int size){
+
+	//not a script this interpreter understands
+	if(size < SCRIPT_HEADER || script[0] != SCRIPT_MAGIC0 || script[1] != SCRIPT_MAGIC1 || script[2] != SCRIPT_VERSION)
+		return false;
+
+	code = script;
+	codeSize = size;
+
+	//not a script this robot can run
+	int need = check(SCRIPT_HEADER, size);
+	if(need == NONE || need > SCRIPT_THREADS)
+		return false;
+
+	//only the main branch is running
+	for(int i = 0; i < SCRIPT_THREADS; i++)
+		threads[i].pc = NONE;
+	spawn(SCRIPT_HEADER, NONE);
+	aborted = false;
+
+	unsigned long wakeTime = millis();	//time of the last update
+
+	//step every branch until the main branch ends
+	while(threads[0].pc != NONE && !aborted){
+		for(int i = 0; i < SCRIPT_THREADS && !aborted; i++)
+			if(threads[i].pc != NONE)
+				step(i);
+		taskDelayUntil(&wakeTime, SCRIPT_PERIOD);
+	}
+
+	//leave the drive stopped
+	if(turn_getMode() != TURN_OFF)
+		turn_stop();
+	robot_stop();
+	return true;
+}
+
+/*
+ * Load a compiled script from a file and run it. Files larger than
+ * SCRIPT_SIZE are refused rather than cut short.
+ *
+ * @param name The name of the file.
+ * @return If the file held a script that was accepted and ran.
+ */
+bool script_runFile(const char* name){
+
+	static unsigned char buffer[SCRIPT_SIZE + 1];	//loaded script, with a byte to spot a larger file
+	FILE* file = fopen(name, "r");					//script file
+
+	//no script saved
+	if(file == NULL)
+		return false;
+
+	int size = fread(buffer, 1, SCRIPT_SIZE + 1, file);
+	fclose(file);
+
+	//too large to load whole
+	if(size > SCRIPT_SIZE)
+		return false;
+
+	return script_run(buffer, size);
+}
+
+/*
+ * Run the script for the selected alliance and position.
+ *
+ * @return If a valid script was found and ran.
+ */
+bool script_runSlot(){
+
+	//skills challenge autonomous
+	if(robot_getSkills())
+		return script_runFile("sk.aut");
+
+	//red alliance autonomous at starting position 1
+	else if(robot_getAlliance() == RED_ALLIANCE && robot_getStartPos() == POS_1)
+		return script_runFile("r1.aut");
+
+	//red alliance autonomous at starting position 2
+	else if(robot_getAlliance() == RED_ALLIANCE && robot_getStartPos() == POS_2)
+		return script_runFile("r2.aut");
+
+	//blue alliance autonomous at starting position 1
+	else if(robot_getAlliance() == BLUE_ALLIANCE && robot_getStartPos() == POS_1)
+		return script_runFile("b1.aut");
+
+	//blue alliance autonomous at starting position 2
+	else if(robot_getAlliance() == BLUE_ALLIANCE && robot_getStartPos() == POS_2)
+		return script_runFile("b2.aut");
+
+	return false;
+}
@@ -0,0 +1,413 @@
+/*
+ * @file telemetry.c
+ *
+ * @brief Implementation of the binary telemetry stream.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <main.h>
+#include <telemetry.h>
+#include <odometry.h>
+#include <budget.h>
+#include <pto.h>
+#include <puncher.h>
+#include <trace.h>
+#include <monitor.h>
+
+static TaskHandle telemetryTask = NULL;	//handle of the telemetry sending task
+static FILE* telemetryPort = NULL;			//port the frames are sent out of
+
+//ring buffer, only the driver control loop moves head and only the sending task moves tail
+static TelemetrySample ring[TELEM_RING];
+static volatile unsigned int head = 0;		//samples ever written
+static volatile unsigned int tail = 0;		//samples ever sent
+static volatile unsigned long dropped = 0;	//samples dropped with the ring full
+
+//channel sampling
+static int decimation[TELEM_CHANNELS] = {1, 1, 1, 2, 25, 1, 5, 5};	//loops between samples of each channel
+static int countdown[TELEM_CHANNELS];							//loops until each channel is sampled next
+
+//driver control loop timing
+static unsigned long lastLoop = 0;		//time in us the last loop was sampled
+static unsigned long loopPeriod = 0;	//time in us between the last two loops
+static unsigned long loopTime = 0;		//time in us userControl() took in the last loop
+
+static const char* names[TELEM_CHANNELS] = {"motors", "flywheel", "puncher", "pose", "battery", "loop", "current", "budget"};
+static const char* columns[TELEM_CHANNELS] = {
+	"m1 m2 m3 m4 m5 m6 m7 m8 m9 m10",
+	"setSpeed velocity state",
+	"angle puncherLine wheelLine state",
+	"x y heading",
+	"main backup",
+	"period userControl",
+	"i1 i2 i3 i4 i5 i6 i7 i8 i9 i10",
+	"bank1 bank2 motor low mid high"
+};
+
+/*
+ * Read the values of a channel.
+ *
+ * @param channel The channel.
+ * @param values The values, TELEM_MAX_VALUES of them.
+ * @return The number of values read.
+ */
+static int readChannel(int channel, int* values){
+
+	Pose pose;
+
+	switch(channel){
+	case TELEM_MOTORS:
+		for(int i = 0; i < 10; i++)
+			values[i] = motorGet(i + 1);
+		return 10;
+	case TELEM_FLYWHEEL:
+		values[0] = wheelSetSpeed;
+		values[1] = pto_getVelocity();
+		values[2] = pto_getState();
+		return 3;
+	case TELEM_PUNCHER:
+		values[0] = puncher_getAngle();
+		values[1] = sensor_read(&Robot.puncherDetector);
+		values[2] = sensor_read(&Robot.wheelDetector);
+		values[3] = puncher_getState();
+		return 4;
+	case TELEM_POSE:
+		if(!odom_isRunning())
+			return 0;
+		odom_getPose(&pose);
+		values[0] = pose.x;
+		values[1] = pose.y;
+		values[2] = FIX_TO_DEG(pose.heading);
+		return 3;
+	case TELEM_BATTERY:
+		values[0] = powerLevelMain();
+		values[1] = powerLevelBackup();
+		return 2;
+	case TELEM_CURRENT:
+		for(int i = 0; i < 10; i++)
+			values[i] = budget_getCurrent(i + 1) * 1000;
+		return 10;
+	case TELEM_BUDGET:
+		values[0] = budget_getBankHeat(0) * 1000;
+		values[1] = budget_getBankHeat(1) * 1000;
+		values[2] = 0;
+		values[3] = values[4] = values[5] = 1000;
+		for(int i = 1; i <= 10; i++){
+			int heat = budget_getMotorHeat(i) * 1000;
+			int scale = budget_getScale(i) * 1000;
+			values[2] = heat > values[2] ? heat : values[2];
+			if(scale < values[3 + budget_getPriority(i)])
+				values[3 + budget_getPriority(i)] = scale;
+		}
+		return 6;
+	default:
+		values[0] = loopPeriod;
+		values[1] = loopTime;
+		return 2;
+	}
+}
+
+/*
+ * COBS encode a payload so it holds no zero bytes.
+ *
+ * @param payload The payload.
+ * @param size The size of the payload in bytes.
+ * @param out The encoded bytes, size + size / 254 + 1 of them.
+ * @return The number of encoded bytes.
+ */
+static int cobsEncode(const unsigned char* payload, int size, unsigned char* out){
+
+	int code = 0;				//position of the current code byte
+	int length = 1;				//bytes written
+	unsigned char run = 1;		//current code, one more than the bytes it covers
+
+	for(int i = 0; i < size; i++){
+		if(payload[i] == 0){
+			out[code] = run;
+			code = length++;
+			run = 1;
+			continue;
+		}
+
+		out[length++] = payload[i];
+		if(++run == 0xFF){
+			out[code] = run;
+			code = length++;
+			run = 1;
+		}
+	}
+
+	out[code] = run;
+	return length;
+}
+
+/*
+ * Decode COBS encoded bytes.
+ *
+ * @param in The encoded bytes, without the zero ending the frame.
+ * @param size The number of encoded bytes.
+ * @param payload The payload.
+ * @param max The largest payload in bytes.
+ * @return The size of the payload, -1 if the bytes are not valid.
+ */
+static int cobsDecode(const unsigned char* in, int size, unsigned char* payload, int max){
+
+	int length = 0;	//bytes decoded
+
+	for(int i = 0; i < size;){
+		int code = in[i++];
+		if(code == 0)
+			return -1;
+
+		for(int j = 1; j < code; j++){
+			if(i >= size || length >= max)
+				return -1;
+			payload[length++] = in[i++];
+		}
+
+		//a short code stands for a zero, except at the end
+		if(code < 0xFF && i < size){
+			if(length >= max)
+				return -1;
+			payload[length++] = 0;
+		}
+	}
+
+	return length;
+}
+
+/*
+ * Start sending telemetry out of a port. The port is opened at
+ * TELEM_BAUD if it is a UART.
+ *
+ * @param port uart1, uart2 or stdout.
+ */
+void telemetry_init(FILE* port){
+
+	if(telemetry_isRunning())
+		return;
+
+	if(port == uart1 || port == uart2)
+		usartInit(port, TELEM_BAUD, SERIAL_8N1);
+	telemetryPort = port;
+
+	telemetryTask = taskCreate(telemetry_task, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_DEFAULT - 1);
+}
+
+/*
+ * Retrieve if telemetry is being sent.
+ *
+ * @return True if the telemetry task has been started.
+ */
+bool telemetry_isRunning(){
+	return telemetryTask != NULL;
+}
+
+/*
+ * Set how often a channel is sampled.
+ *
+ * @param channel The channel.
+ * @param loops The number of driver control loops between samples, 0 to stop sampling it.
+ */
+void telemetry_setDecimation(int channel, int loops){
+
+	if(channel < 0 || channel >= TELEM_CHANNELS || loops < 0)
+		return;
+
+	decimation[channel] = loops;
+	countdown[channel] = 0;
+}
+
+/*
+ * Retrieve how often a channel is sampled.
+ *
+ * @param channel The channel.
+ * @return The number of driver control loops between samples, 0 if it is not sampled.
+ */
+int telemetry_getDecimation(int channel){
+	return channel >= 0 && channel < TELEM_CHANNELS ? decimation[channel] : 0;
+}
+
+/*
+ * Sample the channels due this driver control loop into the ring
+ * buffer. Called once per loop after userControl().
+ *
+ * @param time The time userControl() took in us.
+ */
+void telemetry_sample(unsigned long time){
+
+	if(!telemetry_isRunning())
+		return;
+
+	unsigned long now = micros();	//time the loop ended
+	loopPeriod = lastLoop == 0 ? 0 : now - lastLoop;
+	loopTime = time;
+	lastLoop = now;
+
+	for(int i = 0; i < TELEM_CHANNELS; i++){
+
+		//not due this loop
+		if(decimation[i] == 0 || countdown[i]-- > 0)
+			continue;
+		countdown[i] = decimation[i] - 1;
+
+		//ring full, never wait on the sending task
+		if(head - tail >= TELEM_RING){
+			dropped++;
+			continue;
+		}
+
+		TelemetrySample* s = &ring[head % TELEM_RING];
+		s->channel = i;
+		s->time = millis();
+		s->count = readChannel(i, s->values);
+		if(s->count == 0)
+			continue;
+
+		__sync_synchronize();	//the sample is complete before the sending task can see it
+		head++;
+	}
+}
+
+/*
+ * Retrieve the samples dropped because the ring buffer was full.
+ *
+ * @return The number of dropped samples.
+ */
+unsigned long telemetry_getDropped(){
+	return dropped;
+}
+
+/*
+ * Retrieve the name of a channel.
+ *
+ * @param channel The channel.
+ * @return The name, NULL if there is no such channel.
+ */
+const char* telemetry_getName(int channel){
+	return channel >= 0 && channel < TELEM_CHANNELS ? names[channel] : NULL;
+}
+
+/*
+ * Retrieve the names of a channel's values.
+ *
+ * @param channel The channel.
+ * @return The names separated by spaces, NULL if there is no such channel.
+ */
+const char* telemetry_getColumns(int channel){
+	return channel >= 0 && channel < TELEM_CHANNELS ? columns[channel] : NULL;
+}
+
+/*
+ * Frame a sample for sending.
+ *
+ * @param sample The sample.
+ * @param frame The frame, TELEM_FRAME_SIZE bytes.
+ * @return The size of the frame in bytes, including the zero ending it.
+ */
+int telemetry_encode(const TelemetrySample* sample, unsigned char* frame){
+
+	unsigned char payload[TELEM_PAYLOAD_SIZE];	//unencoded frame
+	int size = 0;								//bytes in the payload
+	unsigned char sum = 0;						//sum of the payload's bytes
+
+	payload[size++] = sample->channel;
+	payload[size++] = sample->sequence;
+	for(int i = 0; i < 4; i++)
+		payload[size++] = sample->time >> (8 * i);
+	for(int v = 0; v < sample->count && v < TELEM_MAX_VALUES; v++)
+		for(int i = 0; i < 4; i++)
+			payload[size++] = (unsigned int) sample->values[v] >> (8 * i);
+
+	for(int i = 0; i < size; i++)
+		sum += payload[i];
+	payload[size++] = -sum;
+
+	int length = cobsEncode(payload, size, frame);
+	frame[length++] = 0;
+	return length;
+}
+
+/*
+ * Unframe a received sample.
+ *
+ * @param frame The frame, without the zero ending it.
+ * @param size The size of the frame in bytes.
+ * @param sample The sample.
+ * @return True if the frame held a valid sample.
+ */
+bool telemetry_decode(const unsigned char* frame, int size, TelemetrySample* sample){
+
+	unsigned char payload[TELEM_PAYLOAD_SIZE];	//decoded frame
+	int length = cobsDecode(frame, size, payload, TELEM_PAYLOAD_SIZE);
+
+	//channel, sequence, time and checksum, then whole values
+	if(length < 7 || (length - 7) % 4 != 0 || payload[0] >= TELEM_CHANNELS)
+		return false;
+
+	unsigned char sum = 0;	//sum of the payload's bytes
+	for(int i = 0; i < length; i++)
+		sum += payload[i];
+	if(sum != 0)
+		return false;
+
+	sample->channel = payload[0];
+	sample->sequence = payload[1];
+	sample->time = 0;
+	for(int i = 0; i < 4; i++)
+		sample->time |= (unsigned long) payload[2 + i] << (8 * i);
+	sample->count = (length - 7) / 4;
+	for(int v = 0; v < sample->count; v++){
+		unsigned int value = 0;
+		for(int i = 0; i < 4; i++)
+			value |= (unsigned int) payload[6 + 4 * v + i] << (8 * i);
+		sample->values[v] = value;
+	}
+
+	return true;
+}
+
+/*
+ * Telemetry sending task. Sends everything in the ring buffer every
+ * TELEM_PERIOD ms, below the priority of every control task.
+ *
+ * @param ignore Unused task parameter.
+ */
+void telemetry_task(void* ignore){
+
+	unsigned long wakeTime = millis();		//time of the last send
+	unsigned char sequence = 0;				//number of the next frame
+	unsigned char frame[TELEM_FRAME_SIZE];	//frame being sent
+
+	TRACE_TASK("telemetry");
+	int monitorId = monitor_register("telemetry", TASK_DEFAULT_STACK_SIZE);
+
+	while(true){
+		TRACE_BEGIN("telemetry send");
+		while(tail != head){
+			TelemetrySample sample = ring[tail % TELEM_RING];
+			__sync_synchronize();	//the copy is done before the slot can be reused
+			tail++;
+
+			sample.sequence = sequence++;
+			fwrite(frame, 1, telemetry_encode(&sample, frame), telemetryPort);
+		}
+		TRACE_END("telemetry send");
+
+		monitor_delayUntil(monitorId, &wakeTime, TELEM_PERIOD);
+	}
+}
@@ -0,0 +1,173 @@
+/*
+ * @file trace.c
+ *
+ * @brief Implementation of the event trace.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <trace.h>
+#include <monitor.h>
+
+//trace event data structure
+struct{
+	unsigned long time;		//time in us the event was recorded
+	const char* name;		//name of the event
+	unsigned long stack;	//address on the stack of the task that recorded it
+	char type;				//TRACE_ event type
+} typedef TraceEvent;
+
+//named task data structure
+struct{
+	const char* name;		//name of the task
+	unsigned long stack;	//address on the task's stack where it named itself
+	unsigned long start;	//time in us it named itself
+	unsigned long end;		//time in us another task took over its stack, 0 while it runs
+} typedef TraceTask;
+
+static TaskHandle traceTask = NULL;			//handle of the trace dumping task
+static TraceEvent events[TRACE_EVENTS];		//ring buffer of events, oldest overwritten first
+static volatile unsigned int next = 0;		//events ever recorded
+static volatile bool frozen = false;		//flag for the ring being dumped
+static TraceTask tasks[TRACE_TASKS];		//tasks that have named themselves
+static int taskCount = 0;					//number of named tasks
+
+/*
+ * Start the task that dumps the trace to the debug terminal each time
+ * the robot is disabled.
+ */
+void trace_init(){
+
+	if(traceTask != NULL)
+		return;
+
+	traceTask = taskCreate(trace_task, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_DEFAULT - 1);
+}
+
+/*
+ * Record an event in the running task. Safe to call from any task.
+ *
+ * @param type TRACE_BEGIN_EVENT, TRACE_END_EVENT or TRACE_INSTANT_EVENT.
+ * @param name The name of the event, a string literal.
+ */
+void trace_event(char type, const char* name){
+
+	volatile char marker;	//lives on the running task's stack
+
+	if(frozen)
+		return;
+
+	TraceEvent* e = &events[__sync_fetch_and_add(&next, 1) % TRACE_EVENTS];
+	e->time = micros();
+	e->name = name;
+	e->stack = (unsigned long) &marker;
+	e->type = type;
+}
+
+/*
+ * Name the running task. Called once at the start of a task, before any
+ * of its trace points, so the stack addresses of its events are below
+ * this one. Tasks name themselves rarely, so this is not made safe for
+ * two tasks starting at once.
+ *
+ * @param name The name of the task, a string literal.
+ */
+void trace_nameTask(const char* name){
+
+	volatile char marker;					//lives on the running task's stack
+	unsigned long stack = (unsigned long) &marker;
+	unsigned long now = micros();			//time the task started
+	TraceTask* slot = NULL;					//entry for the task
+
+	//tasks that ended and left their stack to this one
+	for(int i = 0; i < taskCount; i++){
+		unsigned long distance = tasks[i].stack > stack ? tasks[i].stack - stack : stack - tasks[i].stack;
+		if(tasks[i].end == 0 && distance < TRACE_STACK_SPAN)
+			tasks[i].end = now;
+	}
+
+	//a new entry, or the one of the task that ended first when full
+	if(taskCount < TRACE_TASKS)
+		slot = &tasks[taskCount++];
+	else
+		for(int i = 0; i < TRACE_TASKS; i++)
+			if(tasks[i].end != 0 && (slot == NULL || tasks[i].end < slot->end))
+				slot = &tasks[i];
+	if(slot == NULL)
+		return;
+
+	slot->name = name;
+	slot->stack = stack;
+	slot->start = now;
+	slot->end = 0;
+}
+
+/*
+ * Print the trace, oldest event first. Events are not recorded while it
+ * is printed. The format is read by host/tracejson:
+ *
+ *   trace begin
+ *   task <name> <stack address in hex> <start time> <end time, 0 if running>
+ *   <type> <time in us> <stack address in hex> <name>
+ *   trace end
+ *
+ * @param port The port to print to.
+ */
+void trace_dump(FILE* port){
+
+	frozen = true;
+
+	unsigned int last = next;	//events recorded
+	unsigned int count = last < TRACE_EVENTS ? last : TRACE_EVENTS;
+
+	fprintf(port, "trace begin\n");
+	for(int i = 0; i < taskCount; i++)
+		fprintf(port, "task %s %lx %lu %lu\n", tasks[i].name, tasks[i].stack, tasks[i].start, tasks[i].end);
+	for(unsigned int i = last - count; i != last; i++){
+		TraceEvent* e = &events[i % TRACE_EVENTS];
+		fprintf(port, "%c %lu %lx %s\n", e->type, e->time, e->stack, e->name);
+	}
+	fprintf(port, "trace end\n");
+
+	frozen = false;
+}
+
+/*
+ * Forget every event recorded.
+ */
+void trace_clear(){
+	next = 0;
+}
+
+/*
+ * Trace dumping task. Prints the trace to the debug terminal each time
+ * the robot goes from enabled to disabled, at the end of a match.
+ *
+ * @param ignore Unused task parameter.
+ */
+void trace_task(void* ignore){
+
+	int monitorId = monitor_register("trace", TASK_DEFAULT_STACK_SIZE);
+	bool enabled = false;	//robot's state at the last check
+
+	while(true){
+		if(enabled && !isEnabled())
+			trace_dump(stdout);
+		enabled = isEnabled();
+
+		monitor_delay(monitorId, TRACE_PERIOD);
+	}
+}
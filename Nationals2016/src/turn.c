@@ -0,0 +1,287 @@
+/*
+ * @file turn.c
+ *
+ * @brief Implementation of the gyro turn and heading hold controller.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <turn.h>
+#include <odometry.h>
+#include <trace.h>
+#include <monitor.h>
+
+static TaskHandle turnTask = NULL;		//handle of the turn controller task
+static TurnGains turnGains;				//current controller gains
+static volatile int mode = TURN_OFF;	//current controller mode
+static volatile int target = 0;			//target heading in binary angle units
+static volatile int baseVelocity = 0;	//drive velocity while holding a heading
+static volatile int settledCount = 0;	//consecutive updates spent at the target
+static bool assist = true;				//flag for driver heading assist
+
+/*
+ * Retrieve the robot's heading in binary angle units. Uses the
+ * odometry heading when it is running since it is finer than
+ * the whole degrees the gyro reports.
+ *
+ * @return The cumulative counter clockwise heading.
+ */
+static int readHeading(){
+
+	//odometry blends the wheels with the gyro
+	if(odom_isRunning()){
+		Pose pose;
+		odom_getPose(&pose);
+		return pose.heading;
+	}
+
+	return FIX_DEG(sensor_read(&Robot.turnSensor));
+}
+
+/*
+ * Start the turn controller task. The task is only created
+ * when the turn sensor is a gyro.
+ */
+void turn_init(){
+
+	//the robot has no gyro or the controller is already running
+	if(sensor_size(&Robot.turnSensor) == 0 || sensor_type(&Robot.turnSensor) != GYRO || turn_isRunning())
+		return;
+
+	turnGains.kP = 3.0;			//full output at about 40 degrees of error
+	turnGains.kD = 0.1;			//damp the turn as it approaches the target
+	turnGains.minOutput = 20;	//overcome drive friction near the target
+
+	turnTask = taskCreate(turn_task, TASK_DEFAULT_STACK_SIZE, NULL, TASK_PRIORITY_DEFAULT + 1);
+}
+
+/*
+ * Retrieve if the turn controller task is running.
+ *
+ * @return If the turn controller task is running.
+ */
+bool turn_isRunning(){
+	return turnTask != NULL;
+}
+
+/*
+ * Set the turn controller gains.
+ *
+ * @param gains The new turn controller gains.
+ */
+void turn_setGains(TurnGains gains){
+	turnGains = gains;
+}
+
+/*
+ * Retrieve the turn controller gains.
+ *
+ * @return The current turn controller gains.
+ */
+TurnGains turn_getGains(){
+	return turnGains;
+}
+
+/*
+ * Retrieve the robot's heading.
+ *
+ * @return The cumulative counter clockwise heading in degrees.
+ */
+int turn_getHeading(){
+	return FIX_TO_DEG(readHeading());
+}
+
+/*
+ * Retrieve the robot's heading without rounding it to whole degrees.
+ *
+ * @return The cumulative counter clockwise heading in binary angle units.
+ */
+int turn_getHeadingFix(){
+	return readHeading();
+}
+
+/*
+ * Start turning in place to an absolute heading.
+ *
+ * @param angle The target heading in degrees.
+ */
+void turn_toAngle(int angle){
+	target = FIX_DEG(angle);
+	settledCount = 0;
+	mode = TURN_TO;
+}
+
+/*
+ * Drive at a velocity while holding a heading.
+ *
+ * @param angle The heading to hold in degrees.
+ * @param velocity The base velocity for both sides of the drive.
+ */
+void turn_hold(int angle, int velocity){
+	turn_holdFix(FIX_DEG(angle), velocity);
+}
+
+/*
+ * Drive at a velocity while holding a heading given in binary
+ * angle units, such as one from turn_getHeadingFix().
+ *
+ * @param angle The heading to hold in binary angle units.
+ * @param velocity The base velocity for both sides of the drive.
+ */
+void turn_holdFix(int angle, int velocity){
+	target = angle;
+	baseVelocity = velocity;
+	mode = TURN_HOLD;
+}
+
+/*
+ * Stop the controller driving. The drive is stopped if the
+ * controller was in control of it.
+ */
+void turn_stop(){
+
+	//hand the drive back
+	if(mode != TURN_OFF){
+		mode = TURN_OFF;
+		robot_stop();
+	}
+}
+
+/*
+ * Retrieve the controller mode.
+ *
+ * @return TURN_OFF, TURN_TO or TURN_HOLD.
+ */
+int turn_getMode(){
+	return mode;
+}
+
+/*
+ * Retrieve if a turn has settled on its target.
+ *
+ * @return If the robot is stopped at the target heading.
+ */
+bool turn_isSettled(){
+	return settledCount >= TURN_SETTLE;
+}
+
+/*
+ * Pause the calling task until a turn settles or the timeout
+ * expires.
+ *
+ * @param timeout The longest time in ms to wait.
+ * @return If the turn settled before the timeout.
+ */
+bool turn_waitForSettle(unsigned long timeout){
+
+	//nothing is turning the robot
+	if(!turn_isRunning())
+		return false;
+
+	unsigned long start = millis();	//time the wait began
+
+	//wait for the turn to settle
+	while(!turn_isSettled()){
+		if(millis() - start >= timeout)
+			return false;
+		delay(TURN_PERIOD);
+	}
+
+	return true;
+}
+
+/*
+ * Turn in place to a heading, wait for the turn to settle
+ * and stop the drive.
+ *
+ * @param angle The target heading in degrees.
+ * @param timeout The longest time in ms to wait.
+ * @return If the turn settled before the timeout.
+ */
+bool turn_turnTo(int angle, unsigned long timeout){
+	turn_toAngle(angle);
+	bool settled = turn_waitForSettle(timeout);
+	turn_stop();
+	return settled;
+}
+
+/*
+ * Enable or disable driver heading assist.
+ *
+ * @param enabled The desired state of heading assist.
+ */
+void turn_setAssist(bool enabled){
+	assist = enabled;
+}
+
+/*
+ * Retrieve if driver heading assist can be used.
+ *
+ * @return If heading assist is enabled and the controller is running.
+ */
+bool turn_assistEnabled(){
+	return assist && turn_isRunning();
+}
+
+/*
+ * Turn controller task. Runs every TURN_PERIOD ms and steers
+ * the drive towards the target heading.
+ *
+ * @param ignore Unused task parameter.
+ */
+void turn_task(void* ignore){
+
+	unsigned long wakeTime = millis();	//time of the last update
+	int lastHeading = readHeading();	//heading at the last update
+
+	TRACE_TASK("turn");
+	int monitorId = monitor_register("turn", TASK_DEFAULT_STACK_SIZE);
+
+	while(true){
+		TRACE_BEGIN("turn update");
+		int heading = readHeading();								//current heading
+		int error = target - heading;								//distance from the target
+		int rate = (heading - lastHeading) * (1000 / TURN_PERIOD);	//turn rate per second
+		lastHeading = heading;
+
+		int output = (turnGains.kP * error - turnGains.kD * rate) * 360 / FIX_TURN;	//steering output
+
+		//count updates spent stopped at the target
+		if(abs(error) <= FIX_DEG(TURN_TOLERANCE) && abs(rate) <= FIX_DEG(TURN_RATE)){
+			if(settledCount < TURN_SETTLE)
+				settledCount++;
+		}
+		else
+			settledCount = 0;
+
+		//turn in place
+		if(mode == TURN_TO){
+
+			//push through drive friction until the target is reached
+			if(abs(error) > FIX_DEG(TURN_TOLERANCE) && abs(output) < turnGains.minOutput)
+				output = error > 0 ? turnGains.minOutput : -turnGains.minOutput;
+
+			robot_setDriveSplit(-output, output);
+		}
+
+		//steer while driving
+		else if(mode == TURN_HOLD)
+			robot_setDriveSplit(baseVelocity - output, baseVelocity + output);
+
+		TRACE_END("turn update");
+		monitor_delayUntil(monitorId, &wakeTime, TURN_PERIOD);
+	}
+}
@@ -24,6 +24,10 @@
 #include "main.h"
 #include "NDAPI.h"
 #include "robot.h"
+#include "gains.h"
+#include "pto.h"
+#include "puncher.h"
+
 /**
  * Insert all joystick commands here and any other functions
  * that will be used to control the robot during the Operator
@@ -31,8 +35,8 @@
  * Therefore there is no need to insert a loop or a delay in this method.
  * This is sexy af. Bask in its glory.
  */
-int mode = 0;
 int wheelSetSpeed = 80;
+bool dryFiring = false; //flag for the puncher driven by hand, without its controller
 void userControl(){
 	robot_joyDrive(DRIVER);	//control drive from joystick
 
@@ -45,22 +49,19 @@ void userControl(){
 	bool speedDown = joystickGetDigital(1, 7, JOY_DOWN);
 	bool flywheel = joystickGetDigital(1, 8, JOY_LEFT);
 	bool puncher = joystickGetDigital(1, 8, JOY_LEFT);
+	bool dryFire = puncher && rapidfire; //8L with 8R drives the puncher whether or not a ball is seen
 	bool presetHigh = joystickGetDigital(1, 7, JOY_RIGHT);
 	bool presetLow = joystickGetDigital(1, 7, JOY_LEFT);
 	bool bandIntake = joystickGetDigital(1, 5, JOY_UP);
 	bool bandOuttake = joystickGetDigital(1, 5, JOY_DOWN);
 
-	if(sensor_getValue(Robot.puncherEncoder) >= 360) //checks puncher encoder value
-		sensor_reset(&Robot.puncherEncoder); //resets after each rotation
-
-	int wheelVelocity = sensor_getValue(Robot.wheelEncoder);
-	sensor_reset(&Robot.wheelEncoder);
+	FlywheelGains gains = gains_getFlywheel();	//tuned flywheel parameters
 
 	if(Robot.skills == false)
 	{
 		if(lcd_buttonPressed(Robot.lcd) == 0){
 			lcdPrint(uart2, 1, "setSpeed: %d", wheelSetSpeed);
-			lcdPrint(uart2, 2, "encoderSpeed: %d", sensor_getValue(Robot.wheelEncoder));
+			lcdPrint(uart2, 2, "encoderSpeed: %d", pto_getVelocity());
 		}
 		else if(lcd_buttonPressed(Robot.lcd) != 0){
 			lcdPrint(uart2, 1, "Main: %f", (double)(powerLevelMain()/1000));
@@ -74,53 +75,44 @@ void userControl(){
 
 
 
-	//PTO:
-	if(mode == 0){ 			//if in puncher mode
-		digitalWrite(12, LOW);
-		if(puncher) //manual mode
-			motorSystem_setVelocity(&Robot.PTO, 127);
+	//PTO: the PTO task shifts and spins the flywheel up, rapid fire boosts it
+	if(pto_getState() == PTO_OFF) //take the PTO back after a replay
+		pto_select(pto_isFlywheel());
+	pto_setFlywheel(rapidfire || flywheel ? wheelSetSpeed : 0, rapidfire);
+	if(pto_isFlywheel() && rapidfire){ //rapid fire feeds the flywheel each time it is ready or no ball waits
+		if(pto_isReady() || sensor_read(&Robot.wheelDetector) >= gains.ballThreshold)
+			motorSystem_set(&Robot.intake, 127);
 		else
-			motorSystem_stop(&Robot.PTO); //end manual mode
-	}
-	else if(mode == 1){ //if in flywheel mode
-		digitalWrite(12, HIGH);
-		if(rapidfire){ //rapid fire mode
-			if(wheelVelocity >= 0.518*wheelSetSpeed+30.7){
-				motorSystem_setVelocity(&Robot.intake, 127);
-				motorSystem_setVelocity(&Robot.PTO, wheelSetSpeed);
-			}
-			else if(wheelVelocity < 0.518*wheelSetSpeed+30.7 && sensor_getValue(Robot.wheelDetector) >= 900){
-				motorSystem_setVelocity(&Robot.intake, 127);
-				motorSystem_setVelocity(&Robot.PTO, 127);
-			}
-			else if(wheelVelocity < 0.518*wheelSetSpeed+30.7 && sensor_getValue(Robot.wheelDetector) < 900){
-				motorSystem_stop(&Robot.intake);
-				motorSystem_setVelocity(&Robot.PTO, 127);
-			}
-		}
-		else{
-			motorSystem_stop(&Robot.PTO);
 			motorSystem_stop(&Robot.intake);
-		} //end rapid fire mode
-
-		if(flywheel) //manual fire mode
-			motorSystem_setVelocity(&Robot.PTO, wheelSetSpeed);
-		else
-			motorSystem_stop(&Robot.PTO);
+	}
+	if(!pto_isFlywheel() && dryFire){ //manual override, the puncher turned over as the old 8L did
+		puncher_stop();
+		pto_setPuncher(127);
+		dryFiring = true;
+	}
+	else if(!pto_isFlywheel()){ //puncher kept cocked, fired as each ball seats
+		if(dryFiring) //the controller takes the cycle up from wherever the override left the cam
+			pto_setPuncher(0);
+		dryFiring = false;
+		puncher_start();
+		if(puncher && puncher_hasBall())
+			puncher_fire();
 	}
 	//PTO
 
-	if(intake) //intake operations
-		motorSystem_setVelocity(&Robot.intake, 127);
+	if(pto_isFlywheel() && rapidfire) //rapid fire feeds the flywheel itself
+		;
+	else if(intake) //intake operations
+		motorSystem_set(&Robot.intake, 127);
 	else if(outtake)
-		motorSystem_setVelocity(&Robot.intake, -50);
+		motorSystem_set(&Robot.intake, -50);
 	else
 		motorSystem_stop(&Robot.intake);
 
 	if(bandIntake)
-		motor_setVelocity(&motor10, 127);
+		motor_set(&motor10, 127);
 	else if(bandOuttake)
-		motor_setVelocity(&motor10, -50);
+		motor_set(&motor10, -50);
 	//end of intake operations
 
 	if(speedUp && wheelSetSpeed < 127) //adjustable wheel speed
@@ -130,16 +122,14 @@ void userControl(){
 	//end adjustable wheel speed
 
 	if(presetHigh) //wheel presets
-		wheelSetSpeed = 110;
+		wheelSetSpeed = gains.presetHigh;
 	else if(presetLow)
-		wheelSetSpeed = 80;
+		wheelSetSpeed = gains.presetLow;
 
 	if(flywheelToggle){ //choose between puncher and flywheel
-		mode = 1;
-		motorSystem_setVelocity(&Robot.PTO, 50);
-	}
-	else if(puncherToggle){
-		motorSystem_setVelocity(&Robot.PTO, 30);
-		mode = 0;
+		puncher_stop();
+		pto_select(true);
 	}
+	else if(puncherToggle)
+		pto_select(false);
 }
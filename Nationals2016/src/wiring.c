@@ -0,0 +1,123 @@
+/*
+ * @file wiring.c
+ *
+ * @brief The motors, motor systems and sensors of the wiring tables.
+ *
+ * Copyright (C) 2016  Jordan M. Kieltyka
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <main.h>
+#include <wiring.h>
+
+// ---------------------------------------- Checks ---------------------------------------------
+
+//every motor on a motor port
+#define X(name, p, direction, kind) _Static_assert((p) >= PORT_1 && (p) <= PORT_10, #name " is not on a motor port");
+WIRING_MOTORS(X)
+#undef X
+
+//every sensor on a port of its kind
+#define X(name, type, p1, p2) \
+	_Static_assert(!WIRING_DIGITAL(type) || ((p1) >= DGTL_1 && (p1) <= DGTL_12 && \
+			(WIRING_SIZE(type) == 1 || ((p2) >= DGTL_1 && (p2) <= DGTL_12))), #name " is not on a digital port"); \
+	_Static_assert(!WIRING_ANALOG(type) || ((p1) >= IN_1 && (p1) <= IN_8), #name " is not on an analog port");
+WIRING_SENSORS(X)
+#undef X
+
+//ports used, once as a sum and once as a mask: they differ when a port is used twice
+#define SENSOR_PORTS(type, p1, p2) ((1L << (p1)) + (WIRING_SIZE(type) == 2 ? 1L << (p2) : 0))	//ports of a sensor
+
+enum{
+#define X(name, p, direction, kind) + (1L << (p))
+	motorPortSum = 0 WIRING_MOTORS(X),
+#undef X
+#define X(name, p, direction, kind) | (1L << (p))
+	motorPortMask = 0 WIRING_MOTORS(X),
+#undef X
+#define X(name, type, p1, p2) + (WIRING_DIGITAL(type) ? SENSOR_PORTS(type, p1, p2) : 0)
+	digitalPortSum = (1L << WIRING_PTO_SOLENOID) WIRING_SENSORS(X),
+#undef X
+#define X(name, type, p1, p2) | (WIRING_DIGITAL(type) ? SENSOR_PORTS(type, p1, p2) : 0)
+	digitalPortMask = (1L << WIRING_PTO_SOLENOID) WIRING_SENSORS(X),
+#undef X
+#define X(name, type, p1, p2) + (WIRING_ANALOG(type) ? SENSOR_PORTS(type, p1, p2) : 0)
+	analogPortSum = 0 WIRING_SENSORS(X),
+#undef X
+#define X(name, type, p1, p2) | (WIRING_ANALOG(type) ? SENSOR_PORTS(type, p1, p2) : 0)
+	analogPortMask = 0 WIRING_SENSORS(X)
+#undef X
+};
+
+_Static_assert(motorPortSum == motorPortMask, "two motors are wired to the same port");
+_Static_assert(digitalPortSum == digitalPortMask, "two sensors are wired to the same digital port");
+_Static_assert(analogPortSum == analogPortMask, "two sensors are wired to the same analog port");
+
+// ---------------------------------------- Motors ---------------------------------------------
+
+//port and direction of each motor as constants
+#define X(name, p, direction, kind) WIRING_PORT_##name = (p), WIRING_DIRECTION_##name = (direction),
+enum{ WIRING_MOTORS(X) };
+#undef X
+
+#define WIRED(name) {.port = WIRING_PORT_##name, .velocity = 0, .reversed = WIRING_DIRECTION_##name}	//motor of the table
+
+//motors declared in robot.h
+#define X(name, p, direction, kind) Motor name = WIRED(name);
+WIRING_MOTORS(X)
+#undef X
+
+//motors of each motor system
+#define X(name, slew, priority, ...) static Motor name##Motors[] = {__VA_ARGS__};
+WIRING_SYSTEMS(X)
+#undef X
+
+// ---------------------------------------- Sensors --------------------------------------------
+
+//ports of each sensor
+#define X(name, type, p1, p2) static int name##Ports[2] = {(p1), (p2)};
+WIRING_SENSORS(X)
+#undef X
+
+/*
+ * Point the robot's motor systems and sensors at the wiring tables' data,
+ * stop every motor, set the motors' slew limits, linearization and current
+ * budget priorities and set up the sensors' hardware.
+ */
+void wiring_init(){
+
+	//motors
+#define X(name, p, direction, kind) output_setLinear((p), (kind));
+	WIRING_MOTORS(X)
+#undef X
+
+	//motor systems
+#define X(name, slew, priority, ...) \
+	Robot.name = (MotorSystem){name##Motors, sizeof(name##Motors) / sizeof(Motor), 0}; \
+	motorSystem_stop(&Robot.name); \
+	for(int i = 0; i < motorSystem_size(&Robot.name); i++){ \
+		output_setSlew(motor_port(&Robot.name.motors[i]), (slew)); \
+		budget_setPriority(motor_port(&Robot.name.motors[i]), (priority)); \
+	}
+	WIRING_SYSTEMS(X)
+#undef X
+
+	//sensors
+#define X(name, kind, p1, p2) \
+	Robot.name = (Sensor){.type = (kind), .ports = name##Ports, .size = WIRING_SIZE(kind), .analog = WIRING_ANALOG(kind)}; \
+	sensor_start(&Robot.name, 0);
+	WIRING_SENSORS(X)
+#undef X
+}